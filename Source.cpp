@@ -1,973 +1,2368 @@
-#include <iostream>         // cout, cerr
-#include <cstdlib>          // EXIT_FAILURE
-#include <GL/glew.h>        // GLEW library
-#include <GLFW/glfw3.h>     // GLFW library
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"      // Image loading Utility functions
-
-// GLM Math Header inclusions
-#include <glm/glm.hpp>
-#include <glm/gtx/transform.hpp>
-#include <glm/gtc/type_ptr.hpp>
-
-#include "camera.h" // Camera class
-
-using namespace std; // Standard namespace
-
-/*Shader program Macro*/
-#ifndef GLSL
-#define GLSL(Version, Source) "#version " #Version " core \n" #Source
-#endif
-
-// Unnamed namespace
-namespace
-{
-    float pi = 3.14159265359;
-    float toRadians = (pi / 180);
-
-    const char* const WINDOW_TITLE = "Milestone Six: Lighting a Scene"; // Macro for window title
-
-    // Variables for window width and height
-    const int WINDOW_WIDTH = 800;
-    const int WINDOW_HEIGHT = 600;
-
-    // Stores the GL data relative to a given mesh
-    struct GLMesh
-    {
-        GLuint vao[5];         // Handle for the vertex array object
-        GLuint vbo[5];         // Handle for the vertex buffer object
-        GLuint nVertices[5];    // Number of indices of the mesh
-    };
-
-    // Main GLFW window
-    GLFWwindow* gWindow = nullptr;
-    // Triangle mesh data
-    GLMesh gMesh;
-    // Texture id
-    GLuint gTextureId;
-    GLuint PencilTexture;
-    GLuint paperTexture;
-    GLuint keyboardTexture;
-    GLuint mouseTexture;
-
-    glm::vec2 gUVScale(1.0f, 1.0f);
-    GLint gTexWrapMode = GL_REPEAT;
-
-    // Shader program
-    GLuint gProgramId;
-    GLuint gLampProgramId;
-
-    // camera
-    Camera gCamera(glm::vec3(0.0f, 1.0f, 7.0f));
-    float gLastX = WINDOW_WIDTH / 2.0f;
-    float gLastY = WINDOW_HEIGHT / 2.0f;
-    bool gFirstMouse = true;
-    bool isPerspective = true;
-
-    // timing
-    float gDeltaTime = 0.0f; // time between current frame and last frame
-    float gLastFrame = 0.0f;
-
-    // Light: color, position, object, and scale
-    glm::vec3 gObjectColor(1.f, 0.2f, 0.0f);
-    glm::vec3 gLightColor(1.0f, 1.0f, 1.0f); // white
-    glm::vec3 gLightPosition(-1.0f, 5.0f, 2.0f); // above plane-left
-    glm::vec3 gLightScale(0.8f);
-
-}
-
-/* User-defined Function prototypes to:
- * initialize the program, set the window size,
- * redraw graphics on the window when resized,
- * and render graphics on the screen
- */
-bool UInitialize(int, char* [], GLFWwindow** window);
-void UResizeWindow(GLFWwindow* window, int width, int height);
-void UProcessInput(GLFWwindow* window);
-void UMousePositionCallback(GLFWwindow* window, double xpos, double ypos);
-void UMouseScrollCallback(GLFWwindow* window, double xoffset, double yoffset);
-void UMouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
-void UCreateMesh(GLMesh& mesh);
-void UDestroyMesh(GLMesh& mesh);
-bool UCreateTexture(const char* filename, GLuint& textureId);
-void UDestroyTexture(GLuint textureId);
-void URender();
-bool UCreateShaderProgram(const char* vtxShaderSource, const char* fragShaderSource, GLuint& programId);
-void UDestroyShaderProgram(GLuint programId);
-
-
-/* Vertex Shader Source Code*/
-const GLchar* vertexShaderSource = GLSL(440,
-    layout(location = 0) in vec3 position; // Vertex data
-layout(location = 1) in vec3 normal; // Normal Data
-layout(location = 2) in vec2 textureCoordinate; // Color Data
-
-// Normals, Fragments, and Texture Coordinates
-out vec3 vertexNormal; //Outgoing Normal
-out vec3 vertexFragmentPos; // Outgoing Fragment Positions
-out vec2 vertexTextureCoordinate; // outgoing texture coordinate
-
-//Global variables for the transform matrices
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-
-void main()
-{
-    gl_Position = projection * view * model * vec4(position, 1.0f); // transforms vertices to clip coordinates
-    vertexFragmentPos = vec3(model * vec4(position, 1.0f)); // Gets Fragement / pixel position
-    vertexNormal = mat3(transpose(inverse(model))) * normal; // Get normal vectors
-    vertexTextureCoordinate = textureCoordinate;
-}
-);
-
-
-/* Fragment Shader Source Code*/
-const GLchar* fragmentShaderSource = GLSL(440,
-    in vec3 vertexNormal; // Incoming Normals
-in vec3 vertexFragmentPos; // Incoming Fragment Position
-in vec2 vertexTextureCoordinate; // Incoming Texture Coordinates
-
-out vec4 fragmentColor;
-
-uniform vec3 lightColor;
-uniform vec3 lightPos;
-uniform vec3 viewPosition;
-uniform sampler2D uTexture;
-uniform vec2 uvScale;
-
-void main()
-{
-    //fragmentColor = texture(uTexture, vertexTextureCoordinate); // Sends texture to the GPU for rendering
-    float ambientStrength = 0.5f; // Set ambient or global lighting strength
-    vec3 ambient = ambientStrength * lightColor; // Generate ambient light color
-
-    vec3 norm = normalize(vertexNormal); // Normalizes Vectors to 1
-    vec3 lightDirection = normalize(lightPos - vertexFragmentPos);
-    float impact = max(dot(norm, lightDirection), 0.0); // Calculates diffues
-    vec3 diffuse = impact * lightColor; // Generates diffuse light color
-
-    float specularIntensity = 0.8f; // Set specular light strength
-    float highlightSize = 16.0f; // Set specular highlight size
-    vec3 viewDir = normalize(viewPosition - vertexFragmentPos); // Calculate reflection vector
-    vec3 reflectDir = reflect(-lightDirection, norm); // Calculate reflection vector
-
-    // Calculates specular componet
-    float specularComponent = pow(max(dot(viewDir, reflectDir), 0.0), highlightSize);
-    vec3 specular = specularIntensity * specularComponent * lightColor;
-
-    // Texture holds the color to be used for all three components
-    vec4 textureColor = texture(uTexture, vertexTextureCoordinate * uvScale);
-
-    // Calculates Phong result
-    vec3 phong = (ambient + diffuse + specular) * textureColor.xys;
-
-    fragmentColor = vec4(phong, 1.0); // Send lighting results to GPU
-}
-);
-
-// Lamp Shader Source Code
-const GLchar* lampVertexShaderSource = GLSL(440,
-    layout(location = 0) in vec3 position; // VAP position 0 for vertex position data
-
-// Uniform  Global variables for transform matrices
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-
-void main() {
-    gl_Position = projection * view * model * vec4(position, 1.0f); // Transforms vertices into clip coords
-
-}
-);
-
-// Fragment Shader Source Code
-const GLchar* lampFragmentShaderSource = GLSL(440, out vec4 fragmentColor; // For outgoing lamp color
-
-void main() {
-    fragmentColor = vec4(1.0f); // Set Color to white
-}
-);
-
-// Images are loaded with Y axis going down, but OpenGL's Y axis goes up, so let's flip it
-void flipImageVertically(unsigned char* image, int width, int height, int channels)
-{
-    for (int j = 0; j < height / 2; ++j)
-    {
-        int index1 = j * width * channels;
-        int index2 = (height - 1 - j) * width * channels;
-
-        for (int i = width * channels; i > 0; --i)
-        {
-            unsigned char tmp = image[index1];
-            image[index1] = image[index2];
-            image[index2] = tmp;
-            ++index1;
-            ++index2;
-        }
-    }
-}
-
-
-int main(int argc, char* argv[])
-{
-    if (!UInitialize(argc, argv, &gWindow))
-        return EXIT_FAILURE;
-
-    // Create the mesh
-    UCreateMesh(gMesh); // Calls the function to create the Vertex Buffer Object
-
-    // Create the shader program
-    if (!UCreateShaderProgram(vertexShaderSource, fragmentShaderSource, gProgramId))
-        return EXIT_FAILURE;
-
-
-    glEnable(GL_DEPTH_TEST);
-    const char* pencilfilename = "Pencil.jpg";
-    const char* planefilename = "wood.jpg";
-    const char* paperfilename = "paper.jpg";
-    const char* keyboardfilename = "keyboard.jpg";
-    const char* mousefilename = "mouse.jpg";
-
-    if ((!UCreateTexture(planefilename, gTextureId))) {
-        cout << "Failed to load texture " << planefilename << endl;
-        return EXIT_FAILURE;
-    }
-    if ((!UCreateTexture(pencilfilename, PencilTexture)))
-    {
-        cout << "Failed to load texture " << pencilfilename << endl;
-        return EXIT_FAILURE;
-    }
-    if ((!UCreateTexture(paperfilename, paperTexture))) {
-        cout << "Failed to load texture " << paperfilename << endl;
-        return EXIT_FAILURE;
-    }
-    if ((!UCreateTexture(keyboardfilename, keyboardTexture)))
-    {
-        cout << "Failed to load texture " << keyboardfilename << endl;
-        return EXIT_FAILURE;
-    }
-    if ((!UCreateTexture(mousefilename, mouseTexture)))
-    {
-        cout << "Failed to load texture " << mousefilename << endl;
-        return EXIT_FAILURE;
-    }
-
-    glUseProgram(gProgramId);
-    glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 0);
-
-    // Sets the background color of the window to black (it will be implicitely used by glClear)
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-
-    // render loop
-    // -----------
-    while (!glfwWindowShouldClose(gWindow))
-    {
-        // per-frame timing
-        // --------------------
-        float currentFrame = glfwGetTime();
-        gDeltaTime = currentFrame - gLastFrame;
-        gLastFrame = currentFrame;
-
-        // input
-        // -----
-        UProcessInput(gWindow);
-
-        // Render this frame
-        URender();
-
-        glfwPollEvents();
-    }
-
-    // Release mesh data
-    UDestroyMesh(gMesh);
-
-    // Release texture
-    UDestroyTexture(gTextureId);
-    UDestroyTexture(PencilTexture);
-    UDestroyTexture(paperTexture);
-    UDestroyTexture(keyboardTexture);
-    UDestroyTexture(mouseTexture);
-
-    // Release shader program
-    UDestroyShaderProgram(gProgramId);
-    UDestroyShaderProgram(gLampProgramId);
-
-    exit(EXIT_SUCCESS); // Terminates the program successfully
-}
-
-
-// Initialize GLFW, GLEW, and create a window
-bool UInitialize(int argc, char* argv[], GLFWwindow** window)
-{
-    // GLFW: initialize and configure
-    // ------------------------------
-    glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 4);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-#ifdef __APPLE__
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-#endif
-
-    // GLFW: window creation
-    // ---------------------
-    * window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, WINDOW_TITLE, NULL, NULL);
-    if (*window == NULL)
-    {
-        std::cout << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
-        return false;
-    }
-    glfwMakeContextCurrent(*window);
-    glfwSetFramebufferSizeCallback(*window, UResizeWindow);
-    glfwSetCursorPosCallback(*window, UMousePositionCallback);
-    glfwSetScrollCallback(*window, UMouseScrollCallback);
-    glfwSetMouseButtonCallback(*window, UMouseButtonCallback);
-
-    // tell GLFW to capture our mouse
-    glfwSetInputMode(*window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-
-    // GLEW: initialize
-    // ----------------
-    // Note: if using GLEW version 1.13 or earlier
-    glewExperimental = GL_TRUE;
-    GLenum GlewInitResult = glewInit();
-
-    if (GLEW_OK != GlewInitResult)
-    {
-        std::cerr << glewGetErrorString(GlewInitResult) << std::endl;
-        return false;
-    }
-
-    // Displays GPU OpenGL version
-    cout << "INFO: OpenGL Version: " << glGetString(GL_VERSION) << endl;
-
-    return true;
-}
-
-
-// process all input: query GLFW whether relevant keys are pressed/released this frame and react accordingly
-void UProcessInput(GLFWwindow* window)
-{
-    static const float cameraSpeed = 2.5f;
-
-    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
-        glfwSetWindowShouldClose(window, true);
-
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-        gCamera.ProcessKeyboard(FORWARD, gDeltaTime);
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-        gCamera.ProcessKeyboard(BACKWARD, gDeltaTime);
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-        gCamera.ProcessKeyboard(LEFT, gDeltaTime);
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-        gCamera.ProcessKeyboard(RIGHT, gDeltaTime);
-    if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS)
-        gCamera.ProcessKeyboard(UP, gDeltaTime);
-    if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS)
-        gCamera.ProcessKeyboard(DOWN, gDeltaTime);
-    if (glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS)
-        isPerspective = !isPerspective;
-}
-
-
-// glfw: whenever the window size changed (by OS or user resize) this callback function executes
-void UResizeWindow(GLFWwindow* window, int width, int height)
-{
-    glViewport(0, 0, width, height);
-}
-
-
-// glfw: whenever the mouse moves, this callback is called
-// -------------------------------------------------------
-void UMousePositionCallback(GLFWwindow* window, double xpos, double ypos)
-{
-    if (gFirstMouse)
-    {
-        gLastX = xpos;
-        gLastY = ypos;
-        gFirstMouse = false;
-    }
-
-    float xoffset = xpos - gLastX;
-    float yoffset = gLastY - ypos; // reversed since y-coordinates go from bottom to top
-
-    gLastX = xpos;
-    gLastY = ypos;
-
-    gCamera.ProcessMouseMovement(xoffset, yoffset);
-}
-
-
-// glfw: whenever the mouse scroll wheel scrolls, this callback is called
-// ----------------------------------------------------------------------
-void UMouseScrollCallback(GLFWwindow* window, double xoffset, double yoffset)
-{
-    gCamera.ProcessMouseScroll(yoffset);
-}
-
-// glfw: handle mouse button events
-// --------------------------------
-void UMouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
-{
-    switch (button)
-    {
-    case GLFW_MOUSE_BUTTON_LEFT:
-    {
-        if (action == GLFW_PRESS)
-            cout << "Left mouse button pressed" << endl;
-        else
-            cout << "Left mouse button released" << endl;
-    }
-    break;
-
-    case GLFW_MOUSE_BUTTON_MIDDLE:
-    {
-        if (action == GLFW_PRESS)
-            cout << "Middle mouse button pressed" << endl;
-        else
-            cout << "Middle mouse button released" << endl;
-    }
-    break;
-
-    case GLFW_MOUSE_BUTTON_RIGHT:
-    {
-        if (action == GLFW_PRESS)
-            cout << "Right mouse button pressed" << endl;
-        else
-            cout << "Right mouse button released" << endl;
-    }
-    break;
-
-    default:
-        cout << "Unhandled mouse button event" << endl;
-        break;
-    }
-}
-
-
-// Functioned called to render a frame
-void URender()
-{
-    // Enable z-depth
-    glEnable(GL_DEPTH_TEST);
-
-    // Clear the frame and z buffers
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-    // Set the shader to be used
-    glUseProgram(gProgramId);
-
-    // camera/view transformation
-    glm::mat4 view = gCamera.GetViewMatrix();
-
-    // Creates a perspective projection
-// Creates a projection THEN create perspective or orthographic view
-    glm::mat4 projection;
-    // NOW check if 'isPerspective' and THEN set the perspective
-    if (isPerspective) {
-        projection = glm::perspective(glm::radians(gCamera.Zoom),
-            (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, 0.1f, 100.0f);
-    }
-    else {
-        float scale = 90;
-        projection = glm::ortho((800.0f / scale), -(800.0f / scale), -(600.0f /
-            scale), (600.0f / scale), -2.5f, 6.5f);
-    }
-    //glm::mat4 projection = glm::perspective(glm::radians(gCamera.Zoom),
-    //(GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, 0.1f, 100.0f);
-
-    // Bind textures object 1
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, 0);
-    glBindTexture(GL_TEXTURE_2D, gTextureId);
-
-    // Plane
-    glm::mat4 scale = glm::scale(glm::vec3(1.0f, 1.0f, 1.0f));
-    glm::mat4 rotation = glm::rotate(0.0f, glm::vec3(0.0, 1.0f, 0.0f));
-    glm::mat4 translation = glm::translate(glm::vec3(0.0f, 0.0f, 0.0f));
-    glm::mat4 model = translation * rotation * scale;
-
-    // Retrieves and passes transform matrices to the Shader program
-    GLint modelLoc = glGetUniformLocation(gProgramId, "model");
-    GLint viewLoc = glGetUniformLocation(gProgramId, "view");
-    GLint projLoc = glGetUniformLocation(gProgramId, "projection");
-
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-    glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
-
-    // Reference matrix uniforms from the Cube Shader program for the cub color, light color, light position, and camera position
-    GLint objectColorLoc = glGetUniformLocation(gProgramId, "objectColor");
-    GLint lightColorLoc = glGetUniformLocation(gProgramId, "lightColor");
-    GLint lightPositionLoc = glGetUniformLocation(gProgramId, "lightPos");
-    GLint viewPositionLoc = glGetUniformLocation(gProgramId, "viewPosition");
-
-    // Pass color, light, and camera data to the Cube Shader program's corresponding uniforms
-    glUniform3f(lightColorLoc, gLightColor.r, gLightColor.g, gLightColor.b);
-    glUniform3f(lightPositionLoc, gLightPosition.x, gLightPosition.y, gLightPosition.z);
-    const glm::vec3 cameraPosition = gCamera.Position;
-    glUniform3f(viewPositionLoc, cameraPosition.x, cameraPosition.y, cameraPosition.z);
-
-    GLint UVScaleLoc = glGetUniformLocation(gProgramId, "uvScale");
-    glUniform2fv(UVScaleLoc, 1, glm::value_ptr(gUVScale));
-
-    // Activate the VBOs contained within the mesh's VAO
-    glBindVertexArray(gMesh.vao[0]);
-
-    // bind textures on corresponding texture units
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, gTextureId);
-
-    // Draws the triangles
-    glDrawArrays(GL_TRIANGLES, 0, gMesh.nVertices[0]);
-
-
-    // Pencil object
-    scale = glm::scale(glm::vec3(1.0f, 1.0f, 1.0f));
-    rotation = glm::rotate(0.0f, glm::vec3(0.0, 1.0f, 0.0f));
-    translation = glm::translate(glm::vec3(4.0f, 0.0f, 3.0f));
-    model = translation * rotation * scale;
-    modelLoc = glGetUniformLocation(gProgramId, "model");
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-    //Activate the VBOs
-    glBindVertexArray(gMesh.vao[1]);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, PencilTexture);
-
-    // Draws the triangles
-    glDrawArrays(GL_TRIANGLES, 0, gMesh.nVertices[1]);
-
-   // paper object
-    scale = glm::scale(glm::vec3(1.0f, 1.0f, 1.0f));
-    rotation = glm::rotate(0.0f, glm::vec3(0.0, 1.0f, 0.0f));
-    translation = glm::translate(glm::vec3(-3.5f, 0.0f, -2.5f));
-    model = translation * rotation * scale;
-    modelLoc = glGetUniformLocation(gProgramId, "model");
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-    //Activate the VBOs
-    glBindVertexArray(gMesh.vao[2]);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, paperTexture);
-
-    // Draws the triangles
-    glDrawArrays(GL_TRIANGLES, 0, gMesh.nVertices[2]);
-
-    // Keyboard object
-    scale = glm::scale(glm::vec3(1.0f, 1.0f, 1.0f));
-    rotation = glm::rotate(0.0f, glm::vec3(0.0, 1.0f, 0.0f));
-    translation = glm::translate(glm::vec3(3.5f, 0.0f, -1.5f));
-    model = translation * rotation * scale;
-    modelLoc = glGetUniformLocation(gProgramId, "model");
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-    //Activate the VBOs
-    glBindVertexArray(gMesh.vao[3]);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, keyboardTexture);
-
-    // Draws the triangles
-    glDrawArrays(GL_TRIANGLES, 0, gMesh.nVertices[3]);
-
-    // Mouse object
-    scale = glm::scale(glm::vec3(0.4f, 0.1f, 0.1f));
-    rotation = glm::rotate(0.0f, glm::vec3(0.0f, 1.0f, 0.0f));
-    translation = glm::translate(glm::vec3(-4.0f, 0.0f, 1.0f));
-    model = translation * rotation * scale;
-    modelLoc = glGetUniformLocation(gProgramId, "model");
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-    //Activate the VBOs
-    glBindVertexArray(gMesh.vao[4]);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, mouseTexture);
-
-    // Draws the triangles
-    glDrawArrays(GL_TRIANGLES, 0, gMesh.nVertices[4]);
-
-    // LAMP: draw light
-//----------------
-    glUseProgram(gLampProgramId);
-
-    //Transform the smaller cube used as a visual que for the light source
-    model = glm::translate(gLightPosition) * glm::scale(gLightScale);
-
-    // Reference matrix uniforms from the Lamp Shader program
-    modelLoc = glGetUniformLocation(gLampProgramId, "model");
-    viewLoc = glGetUniformLocation(gLampProgramId, "view");
-    projLoc = glGetUniformLocation(gLampProgramId, "projection");
-
-    // Pass matrix data to the Lamp Shader program's matrix uniforms
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-    glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
-    glDrawArrays(GL_TRIANGLES, 0, gMesh.nVertices[0]);
-
-    // Deactivate the Vertex Array Object
-    glBindVertexArray(0);
-
-    // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
-    glfwSwapBuffers(gWindow);    // Flips the the back buffer with the front buffer every frame.
-}
-
-
-// Implements the UCreateMesh function
-void UCreateMesh(GLMesh& mesh)
-{
-    const float Repeat = 1;
-    // Vertex data
-   GLfloat planeverts[] = {
-        //Plane Vertex 
-        // Vertex Positions   //Normals           //Texture Coordinates
-       -5.5f, -0.1f, -5.0f,  0.0f,  1.0f,  0.0f,  0.0f, 0.0f,
-        5.5f, -0.1f, -5.0f,  0.0f,  1.0f,  0.0f,  Repeat, Repeat,
-        5.5f, -0.1f,  5.0f,  0.0f,  1.0f,  0.0f,  0.0f, Repeat,
-        5.5f, -0.1f,  5.0f,  0.0f,  1.0f,  0.0f,  0.0f, 0.0f,
-       -5.5f, -0.1f,  5.0f,  0.0f,  1.0f,  0.0f,  Repeat, Repeat,
-       -5.0f, -0.1f, -5.0f,  0.0f,  1.0f,  0.0f,  Repeat, 0.0f, 
-};
-
-    GLfloat pencilverts[]{
-        //pencil Body
-        //Pencil Back
-        // Vertex Positions   //Normals           //Texture Coordinates
-        -1.0f,  0.1f, -0.1f,  0.0f, 0.0f, -1.0f,  0.0f, 0.0f,
-         1.0f,  0.1f, -0.1f,  0.0f, 0.0f, -1.0f,  Repeat, 0.0f,
-        -1.0f, -0.1f, -0.1f,  0.0f, 0.0f, -1.0f,  0.0f, 0.0f,
-         1.0f, -0.1f, -0.1f,  0.0f, 0.0f, -1.0f,  0.0f, 0.0f,
-        -1.0f, -0.1f, -0.1f,  0.0f, 0.0f, -1.0f,  0.0f, Repeat,
-         1.0f,  0.1f, -0.1f,  0.0f, 0.0f, -1.0f,  0.0f, 0.0f,
-
-
-         //Pencil Front
-         // Vertex Positions   //Normals          //Texture Coordinates
-         -1.0f,  0.1f,  0.1f,  0.0f, 0.0f, 1.0f,  0.0f, 0.0f,
-          1.0f,  0.1f,  0.1f,  0.0f, 0.0f, 1.0f,  0.0f, Repeat,
-         -1.0f, -0.1f,  0.1f,  0.0f, 0.0f, 1.0f,  Repeat, 0.0f,
-          1.0f, -0.1f,  0.1f,  0.0f, 0.0f, 1.0f,  0.0f, 0.0f,
-         -1.0f, -0.1f,  0.1f,  0.0f, 0.0f, 1.0f,  0.0f, Repeat,
-          1.0f,  0.1f,  0.1f,  0.0f, 0.0f, 1.0f,  Repeat, 0.0f,
-
-          //Pencil Left
-          // Vertex Positions   //Normals          //Texture Coordinates
-         -1.0f,  0.1f,  0.1f,  -1.0f, 0.0f, 0.0f,  0.0f, 0.0f,
-         -1.0f,  0.1f, -0.1f,  -1.0f, 0.0f, 0.0f,  Repeat, Repeat,
-         -1.0f, -0.1f, -0.1f,  -1.0f, 0.0f, 0.0f,  0.0f, Repeat,
-         -1.0f, -0.1f, -0.1f,  -1.0f, 0.0f, 0.0f,  0.0f, 0.0f,
-         -1.0f, -0.1f,  0.1f,  -1.0f, 0.0f, 0.0f,  0.0f, Repeat,
-         -1.0f,  0.1f, -0.1f,  -1.0f, 0.0f, 0.0f,  0.0f, 0.0f,
-
-         //Pencil Bottom
-         // Vertex Positions   //Normals           //Texture Coordinates
-         -1.0f, -0.1f,  0.1f,  0.0f, -1.0f, 0.0f,  0.0f, 0.0f,
-         -1.0f, -0.1f, -0.1f,  0.0f, -1.0f, 0.0f,  0.0f, Repeat,
-          1.0f, -0.1f, -0.1f,  0.0f, -1.0f, 0.0f,  Repeat, Repeat,
-          1.0f, -0.1f,  0.1f,  0.0f, -1.0f, 0.0f,  0.0f, 0.0f,
-         -1.0f, -0.1f,  0.1f,  0.0f, -1.0f, 0.0f,  Repeat, 0.0f,
-          1.0f, -0.1f, -0.1f,  0.0f, -1.0f, 0.0f,  0.0f, 0.0f,
-
-          //Pencil Top
-          // Vertex Positions  //Normals          //Texture Coordinates
-         -1.0f,  0.1f,  0.1f,  0.0f, 1.0f, 0.0f,  0.0f, 0.0f,
-         -1.0f,  0.1f, -0.1f,  0.0f, 1.0f, 0.0f,  Repeat, 0.0f,
-          1.0f,  0.1f, -0.1f,  0.0f, 1.0f, 0.0f,  0.0f, Repeat,
-          1.0f,  0.1f,  0.1f,  0.0f, 1.0f, 0.0f,  0.0f, 0.0f,
-         -1.0f,  0.1f,  0.1f,  0.0f, 1.0f, 0.0f,  0.0f, Repeat,
-          1.0f,  0.1f, -0.1f,  0.0f, 1.0f, 0.0f,  Repeat, Repeat,
-
-          //Pencil Tip
-          //Tip Front
-          // Vertex Positions  //Normals          //Texture Coordinates
-          1.0f,  0.1f,  0.1f,  0.0f, 0.0f, 1.0f,  0.0f, 0.0f,
-          1.5f,  0.0f,  0.0f,  0.0f, 0.0f, 1.0f,  Repeat, 0.0f,
-          1.0f, -0.1f,  0.1f,  0.0f, 0.0f, 1.0f,  0.0f, Repeat,
-
-          //Tip Back
-          // Vertex Positions  //Normals           //Texture Coordinates
-          1.0f,  0.1f, -0.1f,  0.0f, 0.0f, -1.0f,  0.0f, 0.0f,
-          1.5f,  0.0f,  0.0f,  0.0f, 0.0f, -1.0f,  0.0f, Repeat,
-          1.0f, -0.1f, -0.1f,  0.0f, 0.0f, -1.0f,  Repeat, 0.0f,
-
-          //Tip Top
-          // Vertex Positions  //Normals          //Texture Coordinates
-          1.0f,  0.1f,  0.1f,  0.0f, 1.0f, 0.0f,  0.0f, 0.0f,
-          1.0f,  0.1f, -0.1f,  0.0f, 1.0f, 0.0f,  Repeat, Repeat,
-          1.5f,  0.0f,  0.0f,  0.0f, 1.0f, 0.0f,  Repeat, 0.0f,
-
-          //Tip Bottom
-          // Vertex Positions  //Normals           //Texture Coordinates
-          1.0f, -0.1f,  0.1f,  -1.0f, 0.0f, 0.0f,  0.0f, 0.0f,
-          1.0f, -0.1f, -0.1f,  -1.0f, 0.0f, 0.0f,  Repeat, Repeat,
-          1.5f,  0.0f,  0.0f,  -1.0f, 0.0f, 0.0f,  0.0f, Repeat,
-    };
-
-    GLfloat paperverts[] = {
-        //Plane Vertex 
-        // Vertex Positions   //Normals           //Texture Coordinates
-        -2.0f,  0.0f, -2.0f,  0.0f, 1.0f, 0.0f,   0.0f, 0.0f,
-         2.0f,  0.0f, -2.0f,  0.0f, 1.0f, 0.0f,   Repeat, Repeat,
-         2.0f,  0.0f,  2.0f,  0.0f, 1.0f, 0.0f,   0.0f, Repeat,
-         2.0f,  0.0f,  2.0f,  0.0f, 1.0f, 0.0f,   0.0f, 0.0f,
-        -2.0f,  0.0f,  2.0f,  0.0f, 1.0f, 0.0f,   Repeat, Repeat,
-        -2.0f,  0.0f, -2.0f,  0.0f, 1.0f, 0.0f,   Repeat, 0.0f,
-    };
-
-    GLfloat keyboardverts[] = {
-        //Plane Vertex 
-        // Vertex Positions   //Normals           //Texture Coordinates
-        -1.5f,  0.0f, -3.0f,  0.0f, 1.0f, 0.0f,   0.0f, 0.0f,
-         1.5f,  0.0f, -3.0f,  0.0f, 1.0f, 0.0f,   Repeat, Repeat,
-         1.5f,  0.0f,  3.0f,  0.0f, 1.0f, 0.0f,   0.0f, Repeat,
-         1.5f,  0.0f,  3.0f,  0.0f, 1.0f, 0.0f,   0.0f, 0.0f,
-        -1.5f,  0.0f,  3.0f,  0.0f, 1.0f, 0.0f,   Repeat, Repeat,
-        -1.0f,  0.0f, -3.0f,  0.0f, 1.0f, 0.0f,   Repeat, 0.0f,
-    };
-
-    GLfloat mouseverts[] = {
-        // Mouse Verts
-        // Vertex Positions   //Normals            //Texture Coordinates
-        // Base
-        -0.5f,  0.0f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f,  0.0f,  
-         0.5f,  0.0f, -0.5f,  0.0f,  1.0f,  0.0f,  Repeat, 0.0f,
-         0.5f,  0.0f,  0.5f,  0.0f,  1.0f,  0.0f,  Repeat, Repeat,
-        -0.5f,  0.0f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f,  Repeat,
-        -0.5f,  0.0f,  0.5f,  0.0f,  1.0f,  0.0f,  0.0f,  0.0f,
-         0.5f,  0.0f,  0.5f,  0.0f,  1.0f,  0.0f,  Repeat,  Repeat,
-
-        /* // Top
-        -0.5f,  1.0f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f,  0.0f,
-         0.5f,  1.0f, -0.5f,  0.0f, -1.0f,  0.0f,  Repeat, 0.0f,
-         0.5f,  1.0f,  0.5f,  0.0f, -1.0f,  0.0f,  Repeat,  Repeat,
-        -0.5f,  1.0f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f,  0.0f,
-        -0.5f,  1.0f,  0.5f,  0.0f, -1.0f,  0.0f,  0.0f,  Repeat,
-         0.5f,  1.0f,  0.5f,  0.0f, -1.0f,  0.0f,  Repeat,  Repeat,
-
-         // Side 1
-        -0.5f,  0.0f, -0.5f,  0.0f,  0.0f,  1.0f,  0.0f,  0.0f,
-         0.5f,  0.0f, -0.5f,  0.0f,  0.0f,  1.0f,  Repeat,  0.0f,
-         0.5f,  1.0f, -0.5f,  0.0f,  0.0f,  1.0f,  Repeat,  Repeat,
-        -0.5f,  0.0f, -0.5f,  0.0f,  0.0f,  1.0f,  0.0f,  0.0f,
-        -0.5f,  1.0f, -0.5f,  0.0f,  0.0f,  1.0f,  0.0f,  Repeat,
-         0.5f,  1.0f, -0.5f,  0.0f,  0.0f,  1.0f,  Repeat,  Repeat,
-
-         // Side 2
-        -0.5f,  1.0f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f,  0.0f,
-        -0.5f,  0.0f, -0.5f,  1.0f,  0.0f,  0.0f,  Repeat, 0.0f,
-        -0.5f,  0.0f,  0.5f,  1.0f,  0.0f,  0.0f,  Repeat, Repeat,
-        -0.5f,  1.0f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 0.0f,
-        -0.5f,  1.0f,  0.5f,  1.0f,  0.0f,  0.0f,  0.0f, Repeat,
-        -0.5f,  0.0f,  0.5f,  1.0f,  0.0f,  0.0f,  Repeat, Repeat,
-
-        // Side 3
-        0.5f,  0.0f, -0.5f,  -1.0f,  0.0f,  0.0f,  Repeat, Repeat,
-        0.5f,  1.0f, -0.5f,  -1.0f,  0.0f,  0.0f,  Repeat,  0.0f,
-        0.5f,  1.0f,  0.5f,  -1.0f,  0.0f,  0.0f,  0.0f,  0.0f,
-        0.5f,  0.0f, -0.5f,  -1.0f,  0.0f,  0.0f,  Repeat, Repeat,
-        0.5f,  0.0f,  0.5f,  -1.0f,  0.0f,  0.0f,  0.0f, Repeat,
-        0.5f,  1.0f,  0.5f,  -1.0f,  0.0f,  0.0f,  0.0f,  0.0f,
-
-        // Side 4
-        -0.5f,  0.0f,  0.5f,  0.0f,  0.0f, -1.0f,  0.0f,  0.0f,
-         0.5f,  0.0f,  0.5f,  0.0f,  0.0f, -1.0f,  Repeat,  0.0f,
-         0.5f,  1.0f,  0.5f,  0.0f,  0.0f, -1.0f,  Repeat, Repeat,
-        -0.5f,  0.0f,  0.5f,  0.0f,  0.0f, -1.0f,  0.0f,  0.0f,
-        -0.5f,  1.0f,  0.5f,  0.0f,  0.0f, -1.0f,  0.0f,  Repeat,
-         0.5f,  1.0f,  0.5f,  0.0f,  0.0f, -1.0f,  Repeat,  Repeat,*/
-    };
-    
-
-    const GLuint floatsPerVertex = 3;
-    const GLuint floatsPerNormal = 3;
-    const GLuint floatsPerUV = 2;
-
-    // Strides between vertex coordinates
-    GLint stride = sizeof(float) * (floatsPerVertex + floatsPerNormal + floatsPerUV);
-
-    mesh.nVertices[0] = sizeof(planeverts) / (sizeof(planeverts[0]) *
-        (floatsPerVertex + floatsPerNormal + floatsPerUV));
-    mesh.nVertices[1] = sizeof(pencilverts) / (sizeof(pencilverts[0]) *
-        (floatsPerVertex + floatsPerNormal + floatsPerUV));
-    mesh.nVertices[2] = sizeof(paperverts) / (sizeof(paperverts[0]) *
-        (floatsPerVertex + floatsPerNormal + floatsPerUV));
-    mesh.nVertices[3] = sizeof(keyboardverts) / (sizeof(keyboardverts[0]) *
-        (floatsPerVertex + floatsPerNormal + floatsPerUV));
-    mesh.nVertices[4] = sizeof(mouseverts) / (sizeof(mouseverts[0]) *
-        (floatsPerVertex + floatsPerNormal + floatsPerUV));
-
-    // Plane Mesh
-    glGenVertexArrays(1, &mesh.vao[0]); // we can also generate multiple VAOs or buffers at the same time
-    glGenBuffers(1, &mesh.vbo[0]);
-    glBindVertexArray(mesh.vao[0]);
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo[0]); // Activates the buffer
-    glBufferData(GL_ARRAY_BUFFER, sizeof(planeverts), planeverts, GL_STATIC_DRAW); // Sends vertex or coordinate data
-    glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, 0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (char*)(sizeof(float) * floatsPerVertex));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * (floatsPerVertex + floatsPerNormal)));
-    glEnableVertexAttribArray(2);
-
-    // Pencil Mesh
-    glGenVertexArrays(1, &mesh.vao[1]); // we can also generate multiple VAOs or buffers at the same time
-    glGenBuffers(1, &mesh.vbo[1]);
-    glBindVertexArray(mesh.vao[1]);
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo[1]); // Activates the buffer
-    glBufferData(GL_ARRAY_BUFFER, sizeof(pencilverts), pencilverts, GL_STATIC_DRAW); // Sends vertex or coordinate data
-    glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, 0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (char*)(sizeof(float) * floatsPerVertex));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * (floatsPerVertex + floatsPerNormal)));
-    glEnableVertexAttribArray(2);
-
-    // Paper Mesh
-    glGenVertexArrays(1, &mesh.vao[2]); // we can also generate multiple VAOs or buffers at the same time
-    glGenBuffers(1, &mesh.vbo[2]);
-    glBindVertexArray(mesh.vao[2]);
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo[2]); // Activates the buffer
-    glBufferData(GL_ARRAY_BUFFER, sizeof(paperverts), paperverts, GL_STATIC_DRAW); // Sends vertex or coordinate data
-    glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, 0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (char*)(sizeof(float)* floatsPerVertex));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float)* (floatsPerVertex + floatsPerNormal)));
-    glEnableVertexAttribArray(2);
-
-    // Keyboard Mesh
-    glGenVertexArrays(1, &mesh.vao[3]); // we can also generate multiple VAOs or buffers at the same time
-    glGenBuffers(1, &mesh.vbo[3]);
-    glBindVertexArray(mesh.vao[3]);
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo[3]); // Activates the buffer
-    glBufferData(GL_ARRAY_BUFFER, sizeof(keyboardverts), keyboardverts, GL_STATIC_DRAW); // Sends vertex or coordinate data
-    glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, 0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (char*)(sizeof(float)* floatsPerVertex));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float)* (floatsPerVertex + floatsPerNormal)));
-    glEnableVertexAttribArray(2);
-
-    // Mouse Mesh
-    glGenVertexArrays(1, &mesh.vao[4]); // we can also generate multiple VAOs or buffers at the same time
-    glGenBuffers(1, &mesh.vbo[4]);
-    glBindVertexArray(mesh.vao[4]);
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo[4]); // Activates the buffer
-    glBufferData(GL_ARRAY_BUFFER, sizeof(mouseverts), keyboardverts, GL_STATIC_DRAW); // Sends vertex or coordinate data
-    glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, 0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (char*)(sizeof(float)* floatsPerVertex));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float)* (floatsPerVertex + floatsPerNormal)));
-    glEnableVertexAttribArray(2);
-}
-
-
-void UDestroyMesh(GLMesh& mesh)
-{
-    glDeleteVertexArrays(5, mesh.vao);
-    glDeleteBuffers(5, mesh.vbo);
-}
-
-
-/*Generate and load the texture*/
-bool UCreateTexture(const char* filename, GLuint& textureId)
-{
-    int width, height, channels;
-    unsigned char* image = stbi_load(filename, &width, &height, &channels, 0);
-    if (image) {
-        flipImageVertically(image, width, height, channels);
-        glGenTextures(1, &textureId);
-        glBindTexture(GL_TEXTURE_2D, textureId);
-        // set the texture wrapping parameters
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        // set texture filtering parameters
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        if (channels == 3)
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB,
-                GL_UNSIGNED_BYTE, image);
-        else if (channels == 4)
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0,
-                GL_RGBA,
-                GL_UNSIGNED_BYTE, image);
-        else {
-            cout << "Not implemented to handle image with " << channels << " channels" << endl;
-            return false;
-        }
-        glGenerateMipmap(GL_TEXTURE_2D);
-        stbi_image_free(image);
-        glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
-        return true;
-    }
-    return false; // Error loading the image
-}
-
-
-void UDestroyTexture(GLuint textureId) {
-    glGenTextures(1, &textureId);
-}
-
-
-// Implements the UCreateShaders function
-bool UCreateShaderProgram(const char* vtxShaderSource, const char*
-    fragShaderSource, GLuint& programId)
-{
-    // Compilation and linkage error reporting
-    int success = 0;
-    char infoLog[512];
-    // Create a Shader program object.
-    programId = glCreateProgram();
-    // Create the vertex and fragment shader objects
-    GLuint vertexShaderId = glCreateShader(GL_VERTEX_SHADER);
-    GLuint fragmentShaderId = glCreateShader(GL_FRAGMENT_SHADER);
-    // Retrive the shader source
-    glShaderSource(vertexShaderId, 1, &vtxShaderSource, NULL);
-    glShaderSource(fragmentShaderId, 1, &fragShaderSource, NULL);
-    // Compile the vertex shader, and print compilation errors (if any)
-    glCompileShader(vertexShaderId); // compile the vertex shader
-    // check for shader compile errors
-    glGetShaderiv(vertexShaderId, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        glGetShaderInfoLog(vertexShaderId, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog
-            << std::endl;
-        return false;
-    }
-    glCompileShader(fragmentShaderId); // compile the fragment shader
-    // check for shader compile errors
-    glGetShaderiv(fragmentShaderId, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        glGetShaderInfoLog(fragmentShaderId, sizeof(infoLog), NULL, infoLog);
-        std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog
-            << std::endl;
-        return false;
-    }
-    // Attached compiled shaders to the shader program
-    glAttachShader(programId, vertexShaderId);
-    glAttachShader(programId, fragmentShaderId);
-    glLinkProgram(programId); // links the shader program
-    // check for linking errors
-    glGetProgramiv(programId, GL_LINK_STATUS, &success);
-    if (!success)
-    {
-        glGetProgramInfoLog(programId, sizeof(infoLog), NULL, infoLog);
-        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog <<
-            std::endl;
-        return false;
-    }
-    glUseProgram(programId); // Uses the shader program
-    return true;
-}
-
-
-void UDestroyShaderProgram(GLuint programId)
-{
-    glDeleteProgram(programId);
-}
+#include <iostream>         // cout, cerr
+#include <cstdlib>          // EXIT_FAILURE, atof
+#include <chrono>           // steady_clock for headless frame timing
+#include <cstdio>           // snprintf, sscanf
+#include <cstring>          // strcmp
+#include <cmath>            // ceil, sqrt
+#include <algorithm>        // min, max, partial_sort
+#include <memory>           // unique_ptr
+#include <vector>
+#include <GL/glew.h>        // GLEW library
+#include <GLFW/glfw3.h>     // GLFW library
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"      // Image loading Utility functions
+
+// GLM Math Header inclusions
+#include <glm/glm.hpp>
+#include <glm/gtx/transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "camera.h" // Camera class
+#include "headless.h" // Offscreen EGL context, frame timer and image dump
+#include "shader.h" // Reflected ShaderProgram and typed Uniform handles
+#include "meshbuffer.h" // Shared vertex/index buffer with per-mesh ranges
+#include "vertexformat.h" // Float and quantized vertex layouts
+#include "drawlist.h" // Per-draw SSBO and multi-draw-indirect submission
+#include "scenegraph.h" // Node hierarchy with cached world matrices
+#include "transformbatch.h" // SoA/SIMD world, MVP and normal matrix kernels
+#include "bvh.h" // Bounding boxes, frustum planes and the object BVH
+#include "threadpool.h" // Worker threads for parallel CPU work
+#include "occlusion.h" // Software depth buffer for occlusion culling
+#include "meshgen.h" // Procedural pencil, mouse and keyboard generators
+#include "lod.h" // Level-of-detail selection by projected size
+#include "texturestream.h" // Texture uploads through a persistently mapped staging ring
+#include "texturearray.h" // Texture array and skyline-packed atlas
+#include "assetpack.h" // Memory-mapped pack of ready-to-upload textures and meshes
+#include "programcache.h" // On-disk cache of linked program binaries
+#include "shaderpermutation.h" // Shader variants specialized by feature flags
+#include "lightcluster.h" // Point lights binned into view frustum clusters
+#include "gbuffer.h" // Albedo, normal and depth targets of the deferred path
+
+using namespace std; // Standard namespace
+
+/*Shader program Macro*/
+#ifndef GLSL
+#define GLSL(Version, Source) "#version " #Version " core \n" #Source
+#endif
+
+/*Shader program Macro for sources that need an extension enabled before any code*/
+#ifndef GLSL_EXT
+#define GLSL_EXT(Version, Extension, Source) "#version " #Version " core \n#extension " #Extension " : require \n" #Source
+#endif
+
+// Unnamed namespace
+namespace
+{
+    float pi = 3.14159265359;
+    float toRadians = (pi / 180);
+
+    const char* const WINDOW_TITLE = "Milestone Six: Lighting a Scene"; // Macro for window title
+
+    // Variables for window width and height
+    const int WINDOW_WIDTH = 800;
+    const int WINDOW_HEIGHT = 600;
+
+    // Meshes and textures of the desk scene
+    enum SceneMesh { MESH_PLANE, MESH_PENCIL, MESH_PAPER, MESH_KEYBOARD, MESH_MOUSE, MESH_COUNT };
+    enum SceneTexture { TEXTURE_WOOD, TEXTURE_PENCIL, TEXTURE_PAPER, TEXTURE_KEYBOARD, TEXTURE_MOUSE, TEXTURE_COUNT };
+    // Texture each mesh is drawn with
+    const SceneTexture MESH_TEXTURES[MESH_COUNT] = { TEXTURE_WOOD, TEXTURE_PENCIL, TEXTURE_PAPER, TEXTURE_KEYBOARD, TEXTURE_MOUSE };
+    // Image file of each SceneTexture
+    const char* const TEXTURE_FILES[TEXTURE_COUNT] = { "wood.jpg", "Pencil.jpg", "paper.jpg", "keyboard.jpg", "mouse.jpg" };
+    // Generated meshes come in MAX_MESH_LODS levels of detail, finest first. An object draws level i while its
+    // projected size is at least LOD_PIXEL_SIZES[i] pixels, and switches only LOD_HYSTERESIS past a threshold.
+    const int MAX_MESH_LODS = 3;
+    const float LOD_PIXEL_SIZES[MAX_MESH_LODS - 1] = { 120.0f, 30.0f };
+    const float LOD_HYSTERESIS = 0.2f;
+
+    // Stores the GL data relative to the scene's meshes
+    struct GLMesh
+    {
+        MeshBuffer buffers[VERTEX_FORMAT_COUNT];    // One VAO, vertex buffer and index buffer per vertex format
+        MeshRange ranges[MESH_COUNT][MAX_MESH_LODS];    // Where each level of each mesh lives; .format selects the buffer
+        int lodCounts[MESH_COUNT] = {};                 // Levels generated per mesh, 1 for the hand-typed ones
+    };
+
+    // Size of the framebuffer being rendered to (window or offscreen target)
+    int gFramebufferWidth = WINDOW_WIDTH;
+    int gFramebufferHeight = WINDOW_HEIGHT;
+
+    // Main GLFW window
+    GLFWwindow* gWindow = nullptr;
+    // Headless mode: no window, URender() draws into an offscreen framebuffer
+    HeadlessOptions gHeadlessOptions;
+    HeadlessContext gHeadless;
+    // Every flag parsed outside HeadlessOptions; anything else on the command line is reported and rejected
+    const CommandLineFlag COMMAND_LINE_FLAGS[] =
+    {
+        { "--bench-transforms", true }, { "--bench-vertices", true }, { "--vertex-tolerance", true }, { "--desks", true },
+        { "--no-cull", false }, { "--no-occlusion", false }, { "--threads", true }, { "--no-lod", false },
+        { "--texture-compression", true }, { "--mip-filter", true }, { "--premultiply-alpha", false },
+        { "--texture-layout", true }, { "--texture-layer-size", true }, { "--program-cache", true },
+        { "--no-program-cache", false }, { "--lights", true }, { "--no-specular", false }, { "--renderer", true },
+        { "--point-lights", true }, { "--light-clusters", true }, { "--build-pack", true }, { "--pack", true },
+    };
+    // Triangle mesh data
+    GLMesh gMesh;
+    // Every SceneTexture is a layer of one texture array, resampled to a common layer size (--texture-layer-size N),
+    // and the shader picks the layer per instance; --texture-layout atlas packs them at their own size into one
+    // uncompressed atlas instead. Either way a single texture stays bound for the whole run.
+    enum TextureLayout { TEXTURE_LAYOUT_ARRAY, TEXTURE_LAYOUT_ATLAS };
+    TextureLayout gTextureLayout = TEXTURE_LAYOUT_ARRAY;
+    int gTextureLayerSize = 1024;
+    const int TEXTURE_ATLAS_WIDTH = 4096;
+    const int TEXTURE_ATLAS_HEIGHT = 4096;
+    const GLint TEXTURE_ARRAY_UNIT = 0;
+    const GLint TEXTURE_ATLAS_UNIT = 1;
+    const GLint GBUFFER_FIRST_UNIT = 2; // albedo, normal and depth on units 2 to 4 in the deferred lighting pass
+    TextureArray gTextureArray;
+    TextureAtlas gTextureAtlas;
+    // Texture files stream in while the scene renders; until a texture arrives its bit in gTexturesReady is clear
+    // and the shader shades its objects mid-grey
+    const size_t TEXTURE_STAGING_BYTES = 32 * 1024 * 1024;
+    TextureStreamer gTextureStreamer;
+    int gTexturesReady = 0;
+    // Textures are uploaded block compressed from cache files built on first use (--texture-compression none|bc1|bc7)
+    TextureCompression gTextureCompression = TEXTURE_COMPRESSION_BC7;
+    // Mip levels are filtered on the CPU in linear light (--mip-filter box|kaiser|lanczos)
+    MipFilter gMipFilter = MIP_FILTER_KAISER;
+    // The scene's JPEGs are opaque; textures with alpha can be premultiplied in linear light (--premultiply-alpha)
+    bool gPremultiplyAlpha = false;
+    // Textures and meshes load from a memory-mapped asset pack when one is given (--pack FILE); --build-pack FILE
+    // writes one from the loose files with the current compression and mip filter, then exits
+    AssetPack gAssetPack;
+    const char* gBuildPackPath = nullptr;
+    // Vertex and index counts of one MeshBuffer stored in an asset pack
+    struct PackedMeshBuffer
+    {
+        uint32_t vertexCount;
+        uint32_t indexType;
+    };
+    // Linked programs are saved with glGetProgramBinary and loaded on the next start instead of compiling
+    // (--program-cache DIR, --no-program-cache)
+    ProgramCache gProgramCache;
+    const char* gProgramCachePath = "programcache";
+    double gProgramBuildMilliseconds = 0.0;
+    // Object transforms; world matrices are only recomputed for nodes that moved
+    SceneGraph gSceneGraph;
+    // One drawable object: a scene graph node drawn with a mesh
+    struct SceneObject
+    {
+        SceneGraph::NodeId node;
+        SceneMesh mesh;
+        int lod;    // level drawn, kept between frames for the hysteresis
+    };
+    std::vector<SceneObject> gObjects;
+    // World space boxes of gObjects and the BVH over them, refit whenever the scene graph moves
+    std::vector<BoundingBox> gObjectBounds;
+    ObjectBVH gObjectBVH;
+    // Indices into gObjects that passed view-frustum culling for gCulledViewProjection
+    std::vector<uint32_t> gVisibleObjects;
+    glm::mat4 gCulledViewProjection(0.0f);
+    bool gCullingEnabled = true; // off with --no-cull
+    struct CullingStats
+    {
+        size_t visible = 0;
+        size_t boxTests = 0;
+        size_t culls = 0;       // how often the visible set was recomputed
+        double milliseconds = 0.0;
+    };
+    CullingStats gCullingStats;
+    // Objects that passed the frustum are also tested against a small CPU depth buffer filled with the
+    // nearest large occluders (off with --no-occlusion); only planes and keyboards are solid enough to hide things
+    const bool MESH_OCCLUDERS[MESH_COUNT] = { true, false, false, true, false };
+    const size_t MAX_OCCLUDERS = 64;
+    const int OCCLUSION_BUFFER_WIDTH = 256; // height follows the framebuffer aspect ratio
+    OccluderMesh gOccluderMeshes[MESH_COUNT];
+    OcclusionBuffer gOcclusionBuffer;
+    bool gOcclusionEnabled = true;
+    struct OcclusionStats
+    {
+        size_t occluders = 0;
+        size_t triangles = 0;
+        size_t tested = 0;
+        size_t occluded = 0;
+        double milliseconds = 0.0;
+    };
+    OcclusionStats gOcclusionStats;
+    // Workers shared by the CPU-side passes (--threads N sets the worker count, 0 runs everything on the main thread)
+    std::unique_ptr<ThreadPool> gThreadPool;
+    // Level-of-detail selection for the visible objects (off with --no-lod, every object then draws its finest level)
+    bool gLodEnabled = true;
+    struct LodStats
+    {
+        size_t objects[MAX_MESH_LODS] = {}; // visible objects per level
+        size_t switches = 0;                // level changes so far
+    };
+    LodStats gLodStats;
+    // Extra desks laid out behind the authored one (--desks N)
+    int gDeskCount = 0;
+    // Instances drawn by the vertex throughput benchmark (--bench-vertices N), 0 runs the scene
+    int gVertexBenchmarkInstances = 0;
+    // Per-instance model matrix and texture index, submitted with one multi-draw-indirect call per vertex format;
+    // rebuilt only when the scene graph or the camera changed
+    DrawList gDrawLists[VERTEX_FORMAT_COUNT];
+    // Largest error a mesh may pick up from the packed vertex format (--vertex-tolerance)
+    VertexTolerance gVertexTolerance;
+    const GLuint DRAW_DATA_BINDING = 1; // must match layout(binding = 1) of DrawBuffer
+    const GLuint INSTANCE_DATA_BINDING = 2; // must match layout(binding = 2) of InstanceBuffer
+
+    glm::vec2 gUVScale(1.0f, 1.0f);
+    GLint gTexWrapMode = GL_REPEAT;
+
+    // Uniform handles resolved once after linking, so URender() does no name lookups
+    struct PhongUniforms
+    {
+        Uniform<int> uTextureArray;
+        Uniform<int> uTextureAtlas;
+        Uniform<glm::vec4> uAtlasRegions;
+        Uniform<int> uTexturesReady;
+        Uniform<glm::vec4> uBaseColor;
+        Uniform<int> uGBufferAlbedo;
+        Uniform<int> uGBufferNormal;
+        Uniform<int> uGBufferDepth;
+        Uniform<glm::mat4> uInverseViewProjection;
+    };
+    // Every draw uses a variant of the one shader source, specialized by feature flags (shaderpermutation.h) and
+    // compiled the first time the scene needs it
+    struct ShaderVariant
+    {
+        ShaderPermutation permutation;
+        ShaderProgram program;
+        PhongUniforms uniforms;
+        int texturesReady = -1;     // uTexturesReady last written to this program
+    };
+    ShaderPermutationCache<ShaderVariant> gShaderVariants;
+    bool gSpecularEnabled = true; // off with --no-specular
+
+    // Per-frame camera and light data, std140 layout of the FrameData block shared by every program
+    const GLuint FRAME_UNIFORM_BINDING = 0; // must match layout(binding = 0) in the shaders
+    struct FrameUniforms
+    {
+        glm::mat4 view;
+        glm::mat4 projection;
+        glm::mat4 viewProjection;
+        glm::vec4 cameraPosition;   // xyz used
+        glm::vec4 lightColors[MAX_SHADER_LIGHTS];       // rgb used
+        glm::vec4 lightPositions[MAX_SHADER_LIGHTS];    // xyz used
+        glm::vec4 uvScale;          // xy used
+        glm::uvec4 clusterGrid;     // xyz clusters per axis, w 1 for exponential depth slices
+        glm::vec4 clusterSlicing;   // xy tiles per pixel, zw view depth to slice scale and bias
+    };
+    UniformBuffer<FrameUniforms> gFrameUniforms;
+
+    // camera
+    Camera gCamera(glm::vec3(0.0f, 1.0f, 7.0f));
+    float gLastX = WINDOW_WIDTH / 2.0f;
+    float gLastY = WINDOW_HEIGHT / 2.0f;
+    bool gFirstMouse = true;
+    bool isPerspective = true;
+
+    // timing
+    float gDeltaTime = 0.0f; // time between current frame and last frame
+    float gLastFrame = 0.0f;
+
+    // Light: color, position, object, and scale
+    glm::vec3 gObjectColor(1.f, 0.2f, 0.0f);
+    glm::vec3 gLightColor(1.0f, 1.0f, 1.0f); // white
+    glm::vec3 gLightPosition(-1.0f, 5.0f, 2.0f); // above plane-left
+    glm::vec3 gLightScale(0.8f);
+    // Dimmer fill lights after the key light above, --lights N uses the first N - 1 of them
+    const glm::vec3 FILL_LIGHT_POSITIONS[MAX_SHADER_LIGHTS - 1] = {
+        glm::vec3(4.0f, 3.0f, -3.0f), glm::vec3(-4.0f, 2.5f, -3.0f), glm::vec3(3.0f, 2.0f, 4.0f) };
+    const glm::vec3 FILL_LIGHT_COLORS[MAX_SHADER_LIGHTS - 1] = {
+        glm::vec3(0.2f, 0.15f, 0.1f), glm::vec3(0.1f, 0.12f, 0.2f), glm::vec3(0.12f, 0.12f, 0.12f) };
+    const float FILL_LAMP_SCALE = 0.25f; // of gLightScale
+    int gLightCount = 1;
+    // One unlit plane marks each light, drawn from a list of its own that only changes with the lights
+    DrawList gLampDrawList;
+    // Ceiling and desk lamps over the office floor (--point-lights N), lit through the clusters they reach
+    // (--light-clusters XxYxZ); none by default
+    int gPointLightCount = 0;
+    int gLightClusterGrid[3] = { 16, 9, 24 };
+    LightClusters gLightClusters;
+    glm::mat4 gClusteredView(0.0f);
+    glm::mat4 gClusteredProjection(0.0f);
+    const GLuint POINT_LIGHT_BINDING = 3; // must match layout(binding = 3) of PointLightBuffer
+    const GLuint CLUSTER_RANGE_BINDING = 4; // must match layout(binding = 4) of ClusterRangeBuffer
+    const GLuint CLUSTER_INDEX_BINDING = 5; // must match layout(binding = 5) of ClusterIndexBuffer
+    // Forward shading lights every fragment as it is drawn; deferred shading draws the surfaces into a G-buffer
+    // and lights each pixel once in a full-screen pass (--renderer, R switches while running)
+    enum Renderer { RENDERER_FORWARD, RENDERER_DEFERRED };
+    Renderer gRenderer = RENDERER_FORWARD;
+    GBuffer gGBuffer;
+    GLuint gFullscreenVao = 0; // no attributes, the full-screen triangle comes from gl_VertexID
+    // Render times (URender up to glFinish, without swap or vsync) since the renderer last switched, reported
+    // when R switches it
+    FrameTimer gRendererTimer;
+
+}
+
+/* User-defined Function prototypes to:
+ * initialize the program, set the window size,
+ * redraw graphics on the window when resized,
+ * and render graphics on the screen
+ */
+bool UInitialize(int, char* [], GLFWwindow** window);
+bool UInitializeHeadless();
+const char* UFindArgument(int argc, char* argv[], const char* name);
+bool UHasArgument(int argc, char* argv[], const char* name);
+void URunHeadless();
+void URunTransformBenchmark(int objectCount);
+bool URunVertexBenchmark(int instanceCount);
+void UResizeWindow(GLFWwindow* window, int width, int height);
+void UProcessInput(GLFWwindow* window);
+void UMousePositionCallback(GLFWwindow* window, double xpos, double ypos);
+void UMouseScrollCallback(GLFWwindow* window, double xoffset, double yoffset);
+void UMouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
+void UCreateMesh(GLMesh& mesh);
+void UAddMesh(GLMesh& mesh, int meshIndex, int lod, const char* name, const GLfloat* vertices, GLuint vertexCount);
+bool ULoadMeshFromPack(GLMesh& mesh);
+bool UBuildAssetPack(const char* path);
+SceneGraph::NodeId UCreateDesk(const glm::vec3& position);
+void UCreateScene(int deskCount);
+void UUpdateObjectBounds();
+void UCullObjects(const glm::mat4& viewProjection);
+void UOcclusionCull(const glm::mat4& viewProjection);
+void USelectLods(const glm::mat4& view, const glm::mat4& projection);
+void UBuildDrawLists();
+void UDestroyMesh(GLMesh& mesh);
+bool UCreateTextureStorage();
+void UApplyStreamedTextures(bool wait);
+void URender();
+bool UCreateShaderProgram(const char* vtxShaderSource, const char* fragShaderSource, ShaderProgram& program);
+bool UCompileShaderProgram(const char* vtxShaderSource, const char* fragShaderSource, GLuint programId);
+void UDestroyShaderProgram(ShaderProgram& program);
+bool UCreateShaderVariant(const ShaderPermutation& permutation, ShaderVariant& variant);
+ShaderPermutation USceneShaderPermutation(VertexFormat format);
+ShaderPermutation ULampShaderPermutation(VertexFormat format);
+bool UPrepareShaderVariants();
+ShaderVariant* UUseShaderVariant(const ShaderPermutation& permutation);
+void UBuildLampDrawList();
+void UCreatePointLights(int count, int deskCount);
+ShaderPermutation URendererPermutation(const ShaderPermutation& forward);
+ShaderPermutation UDeferredLightingPermutation();
+void USwitchRenderer();
+
+
+/* Vertex Shader Source Code*/
+const GLchar* vertexShaderSource = GLSL_EXT(440, GL_ARB_shader_draw_parameters,
+    layout(location = 0) in vec3 position; // Vertex data, relative to the mesh bounds when packed
+layout(location = 1) in vec4 normal; // Normal Data, xy holds the octahedral normal when packed
+layout(location = 2) in vec2 textureCoordinate; // Color Data
+
+// Normals, Fragments, and Texture Coordinates
+out vec3 vertexNormal; //Outgoing Normal
+out vec3 vertexFragmentPos; // Outgoing Fragment Positions
+out vec2 vertexTextureCoordinate; // outgoing texture coordinate
+flat out uint vertexTextureIndex; // outgoing texture selection for the draw
+
+// Per-frame camera and light data shared by every variant
+layout(std140, binding = 0) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+    vec4 lightColors[MAX_LIGHTS];       // rgb used
+    vec4 lightPositions[MAX_LIGHTS];    // xyz used
+    vec4 uvScale;
+    uvec4 clusterGrid;      // xyz clusters per axis, w 1 for exponential depth slices
+    vec4 clusterSlicing;    // xy tiles per pixel, zw view depth to slice scale and bias
+};
+
+// Per-draw data, one entry per indirect command
+struct DrawData
+{
+    vec4 positionOffset;
+    vec4 positionScale;
+};
+layout(std430, binding = 1) readonly buffer DrawBuffer
+{
+    DrawData draws[];
+};
+
+// Per-instance data, each command's instances start at its baseInstance
+struct InstanceData
+{
+    mat4 model;
+    mat3 normalMatrix; // transpose(inverse(mat3(model))), computed once per object on the CPU
+    uint textureIndex;
+};
+layout(std430, binding = 2) readonly buffer InstanceBuffer
+{
+    InstanceData instances[];
+};
+
+// Octahedral normal decode, matches OctDecode in vertexformat.h
+vec3 OctDecode(vec2 e)
+{
+    vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+void main()
+{
+    uint instance = gl_BaseInstanceARB + gl_InstanceID;
+    mat4 model = instances[instance].model; // Model matrix of the instance being processed
+    vec3 localPosition = draws[gl_DrawIDARB].positionOffset.xyz + position * draws[gl_DrawIDARB].positionScale.xyz;
+    gl_Position = viewProjection * model * vec4(localPosition, 1.0f); // transforms vertices to clip coordinates
+    vertexFragmentPos = vec3(model * vec4(localPosition, 1.0f)); // Gets Fragement / pixel position
+    vertexNormal = vec3(0.0);
+    if (LIGHT_COUNT > 0) // unlit variants need no normal
+    {
+        vec3 localNormal = PACKED_VERTICES != 0 ? OctDecode(normal.xy) : normal.xyz;
+        if (INVERSE_NORMALS != 0)
+            vertexNormal = mat3(transpose(inverse(model))) * localNormal; // Get normal vectors
+        else
+            vertexNormal = instances[instance].normalMatrix * localNormal;
+    }
+    vertexTextureCoordinate = textureCoordinate;
+    vertexTextureIndex = instances[instance].textureIndex;
+}
+);
+
+
+/* Fragment Shader Source Code*/
+const GLchar* fragmentShaderSource = GLSL(440,
+    in vec3 vertexNormal; // Incoming Normals
+in vec3 vertexFragmentPos; // Incoming Fragment Position
+in vec2 vertexTextureCoordinate; // Incoming Texture Coordinates
+flat in uint vertexTextureIndex; // Incoming texture selection, constant across a draw
+
+layout(location = 0) out vec4 fragmentColor; // Lit color, or the albedo in the G-buffer pass
+layout(location = 1) out vec4 fragmentNormal; // G-buffer pass only: xyz normal, w 1 when lit
+
+layout(std140, binding = 0) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+    vec4 lightColors[MAX_LIGHTS];       // rgb used
+    vec4 lightPositions[MAX_LIGHTS];    // xyz used
+    vec4 uvScale;
+    uvec4 clusterGrid;      // xyz clusters per axis, w 1 for exponential depth slices
+    vec4 clusterSlicing;    // xy tiles per pixel, zw view depth to slice scale and bias
+};
+
+uniform sampler2DArray uTextureArray; // One layer per SceneTexture
+uniform sampler2D uTextureAtlas; // Every SceneTexture in its own region, when textureLayout is 1
+uniform vec4 uAtlasRegions[5]; // Per SceneTexture: xy region offset, zw region size, in atlas coordinates
+uniform int uTexturesReady; // Bit per SceneTexture that finished streaming
+uniform vec4 uBaseColor; // Surface color of untextured variants
+uniform sampler2D uGBufferAlbedo; // Deferred lighting pass inputs, see gbuffer.h
+uniform sampler2D uGBufferNormal;
+uniform sampler2D uGBufferDepth;
+uniform mat4 uInverseViewProjection; // Rebuilds the world position from the G-buffer depth
+
+// Point lights and each cluster's share of them (lightcluster.h), read by clustered variants only
+struct PointLight
+{
+    vec4 positionRadius; // xyz position, w the distance where the light fades out
+    vec4 color;
+};
+layout(std430, binding = 3) readonly buffer PointLightBuffer
+{
+    PointLight pointLights[];
+};
+layout(std430, binding = 4) readonly buffer ClusterRangeBuffer
+{
+    uvec2 clusterRanges[]; // offset into clusterLightIndices, count
+};
+layout(std430, binding = 5) readonly buffer ClusterIndexBuffer
+{
+    uint clusterLightIndices[];
+};
+
+// Diffuse and, in specular variants, the highlight one light adds
+vec3 Shade(vec3 norm, vec3 viewDir, vec3 lightDirection, vec3 lightColor)
+{
+    float impact = max(dot(norm, lightDirection), 0.0); // Calculates diffues
+    vec3 lighting = impact * lightColor; // Generates diffuse light color
+
+    if (SPECULAR != 0)
+    {
+        float specularIntensity = 0.8f; // Set specular light strength
+        float highlightSize = 16.0f; // Set specular highlight size
+        vec3 reflectDir = reflect(-lightDirection, norm); // Calculate reflection vector
+
+        // Calculates specular componet
+        float specularComponent = pow(max(dot(viewDir, reflectDir), 0.0), highlightSize);
+        lighting += specularIntensity * specularComponent * lightColor;
+    }
+    return lighting;
+}
+
+void main()
+{
+    // Surface to light: albedo, normal and world position from the vertex inputs, or from the G-buffer in the
+    // deferred lighting pass
+    vec3 albedo;
+    vec3 norm = vec3(0.0);
+    vec3 position = vertexFragmentPos;
+    bool lit = LIGHT_COUNT > 0;
+    if (DEFERRED_LIGHTING != 0)
+    {
+        ivec2 pixel = ivec2(gl_FragCoord.xy);
+        vec4 normalLit = texelFetch(uGBufferNormal, pixel, 0);
+        albedo = texelFetch(uGBufferAlbedo, pixel, 0).rgb;
+        norm = normalLit.xyz;
+        lit = lit && normalLit.w != 0.0; // unlit lamps and the background keep their color
+        vec3 ndc = vec3(gl_FragCoord.xy / vec2(textureSize(uGBufferDepth, 0)), texelFetch(uGBufferDepth, pixel, 0).r) * 2.0 - 1.0;
+        vec4 world = uInverseViewProjection * vec4(ndc, 1.0);
+        position = world.xyz / world.w;
+    }
+    else
+    {
+        // Texture holds the color to be used for all three components; mid-grey while it is still streaming.
+        // Gradients come from the unwrapped coordinate, so the atlas wrap adds no seam
+        vec4 textureColor = uBaseColor;
+        if (TEXTURED != 0)
+        {
+            vec2 uv = vertexTextureCoordinate * uvScale.xy;
+            vec2 uvDx = dFdx(uv);
+            vec2 uvDy = dFdy(uv);
+            textureColor = vec4(128.0 / 255.0);
+            if ((uTexturesReady & (1 << vertexTextureIndex)) != 0)
+            {
+                if (TEXTURE_ATLAS != 0)
+                {
+                    vec4 region = uAtlasRegions[vertexTextureIndex];
+                    textureColor = textureGrad(uTextureAtlas, region.xy + fract(uv) * region.zw, uvDx * region.zw, uvDy * region.zw);
+                }
+                else
+                    textureColor = textureGrad(uTextureArray, vec3(uv, float(vertexTextureIndex)), uvDx, uvDy);
+            }
+        }
+        albedo = textureColor.xyz;
+        if (LIGHT_COUNT > 0)
+            norm = normalize(vertexNormal); // Normalizes Vectors to 1
+    }
+
+    // The geometry pass of the deferred path stores the surface and leaves lighting to the full-screen pass
+    if (GBUFFER != 0)
+    {
+        fragmentColor = vec4(albedo, 1.0);
+        fragmentNormal = vec4(norm, LIGHT_COUNT > 0 ? 1.0 : 0.0);
+        return;
+    }
+
+    // Unlit variants (the lamps) show the surface color as is
+    vec3 lighting = vec3(1.0);
+    if (lit)
+    {
+        float ambientStrength = 0.5f; // Set ambient or global lighting strength
+        lighting = ambientStrength * lightColors[0].rgb; // Generate ambient light color from the key light
+
+        vec3 viewDir = normalize(cameraPosition.xyz - position); // Calculate view vector
+        for (int light = 0; light < LIGHT_COUNT; ++light)
+        {
+            vec3 lightDirection = normalize(lightPositions[light].xyz - position);
+            lighting += Shade(norm, viewDir, lightDirection, lightColors[light].rgb);
+        }
+
+        if (CLUSTERED_LIGHTS != 0)
+        {
+            // Cluster of the fragment: screen tile from the pixel, depth slice from the view depth
+            float depth = -(view * vec4(position, 1.0)).z;
+            float slice = (clusterGrid.w != 0u ? log(depth) : depth) * clusterSlicing.z + clusterSlicing.w;
+            uvec3 cluster = uvec3(clamp(vec3(gl_FragCoord.xy * clusterSlicing.xy, slice), vec3(0.0), vec3(clusterGrid.xyz) - 1.0));
+            uvec2 range = clusterRanges[cluster.x + clusterGrid.x * (cluster.y + clusterGrid.y * cluster.z)];
+            for (uint i = 0u; i < range.y; ++i)
+            {
+                PointLight light = pointLights[clusterLightIndices[range.x + i]];
+                vec3 toLight = light.positionRadius.xyz - position;
+                float distance = length(toLight);
+                // Falls to zero at the radius, so no light reaches past the clusters it was assigned to
+                float falloff = clamp(1.0 - pow(distance / light.positionRadius.w, 4.0), 0.0, 1.0);
+                float attenuation = falloff * falloff / (1.0 + distance * distance);
+                lighting += attenuation * Shade(norm, viewDir, toLight / max(distance, 0.0001), light.color.rgb);
+            }
+        }
+    }
+
+    // Calculates Phong result
+    fragmentColor = vec4(lighting * albedo, 1.0); // Send lighting results to GPU
+}
+);
+
+
+/* Deferred lighting pass: one triangle covering the screen, paired with the DEFERRED_LIGHTING fragment variant.
+   Writes the scene vertex shader's outputs too, so both stages link the same way */
+const GLchar* fullscreenVertexShaderSource = GLSL(440,
+    out vec3 vertexNormal;
+out vec3 vertexFragmentPos;
+out vec2 vertexTextureCoordinate;
+flat out uint vertexTextureIndex;
+
+void main()
+{
+    // corners (-1, -1), (3, -1) and (-1, 3) from the vertex index, no vertex buffer needed
+    vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+    vertexNormal = vec3(0.0);
+    vertexFragmentPos = vec3(0.0);
+    vertexTextureCoordinate = vec2(0.0);
+    vertexTextureIndex = 0u;
+}
+);
+
+int main(int argc, char* argv[])
+{
+    // CPU microbenchmark, needs no window or GL context
+    const char* benchmarkObjects = UFindArgument(argc, argv, "--bench-transforms");
+    if (benchmarkObjects)
+    {
+        URunTransformBenchmark(atoi(benchmarkObjects));
+        return EXIT_SUCCESS;
+    }
+
+    if (!UInitialize(argc, argv, &gWindow))
+        return EXIT_FAILURE;
+
+    // Image files decode on the worker threads while the meshes and shaders are built here
+    if (gTextureStreamer.Create(*gThreadPool, TEXTURE_STAGING_BYTES))
+        cout << "INFO: Streaming textures through a " << TEXTURE_STAGING_BYTES / (1024 * 1024) << " MB staging ring" << endl;
+    else
+        cout << "INFO: Streaming textures from client memory" << endl;
+    cout << "INFO: Uncompressed textures upload as " << (gTextureStreamer.UploadLayout() == IMAGE_LAYOUT_BGRA ? "BGRA" : "RGBA") << endl;
+    bool compressionSupported = gTextureCompression == TEXTURE_COMPRESSION_NONE
+        || (gTextureCompression == TEXTURE_COMPRESSION_BC1 && GLEW_EXT_texture_compression_s3tc)
+        || (gTextureCompression == TEXTURE_COMPRESSION_BC7 && (GLEW_VERSION_4_2 || GLEW_ARB_texture_compression_bptc));
+    if (!compressionSupported)
+    {
+        cout << "INFO: " << TextureCompressionName(gTextureCompression) << " textures are not supported, uploading them uncompressed" << endl;
+        gTextureCompression = TEXTURE_COMPRESSION_NONE;
+    }
+    if (!UCreateTextureStorage())
+        return EXIT_FAILURE;
+    gTextureStreamer.SetCompression(gTextureCompression);
+    gTextureStreamer.SetMipFilter(gMipFilter);
+    gTextureStreamer.SetPremultiplyAlpha(gPremultiplyAlpha);
+    if (gBuildPackPath)
+        return UBuildAssetPack(gBuildPackPath) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+    // The scene is submitted with one multi-draw-indirect call that indexes per-draw data by gl_DrawIDARB
+    // and per-instance data by gl_BaseInstanceARB + gl_InstanceID
+    if (!GLEW_VERSION_4_3 || !(GLEW_VERSION_4_6 || GLEW_ARB_shader_draw_parameters))
+    {
+        cout << "OpenGL 4.3 and GL_ARB_shader_draw_parameters are required" << endl;
+        return EXIT_FAILURE;
+    }
+
+    // GPU vertex benchmark, run before any texture starts decoding on the workers
+    if (gVertexBenchmarkInstances > 0)
+        return URunVertexBenchmark(gVertexBenchmarkInstances) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+    // Textures the pack holds as requested upload straight from its mapping, the others stream from their files
+    for (int i = 0; i < TEXTURE_COUNT; ++i)
+    {
+        size_t size;
+        const unsigned char* levels = gAssetPack.Find(std::string("texture/") + TEXTURE_FILES[i], size);
+        if (!levels || !gTextureStreamer.RequestMapped(i, TEXTURE_FILES[i], levels, size))
+            gTextureStreamer.Request(i, TEXTURE_FILES[i]);
+    }
+
+    // Create the mesh
+    UCreateMesh(gMesh); // Calls the function to create the Vertex Buffer Object
+
+    if (gProgramCachePath && !gProgramCache.Create(gProgramCachePath))
+        cout << "INFO: The driver cannot save program binaries, compiling every shader" << endl;
+
+    // One uniform buffer feeds the camera and light data to every shader variant
+    gFrameUniforms.Create(FRAME_UNIFORM_BINDING);
+
+    // Compile the shader variants the scene's meshes and lamps draw with
+    if (!UPrepareShaderVariants())
+        return EXIT_FAILURE;
+
+    if (gProgramCache.IsEnabled())
+    {
+        cout << "INFO: Shader programs ready in " << gProgramBuildMilliseconds << " ms, " << gProgramCache.Loaded()
+            << " from the program cache, " << gProgramCache.Stored() << " compiled and cached";
+        if (gProgramCache.Rejected() > 0)
+            cout << " (" << gProgramCache.Rejected() << " stale binaries rejected)";
+        cout << endl;
+    }
+
+    glEnable(GL_DEPTH_TEST);
+
+    // The array or atlas stays bound for the whole run, the shader picks a texture per instance; streamed
+    // textures only flip their bit in uTexturesReady
+    glActiveTexture(GL_TEXTURE0 + TEXTURE_ARRAY_UNIT);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, gTextureArray.Texture());
+    glActiveTexture(GL_TEXTURE0 + TEXTURE_ATLAS_UNIT);
+    glBindTexture(GL_TEXTURE_2D, gTextureAtlas.Texture());
+    glActiveTexture(GL_TEXTURE0);
+
+    for (int format = 0; format < VERTEX_FORMAT_COUNT; ++format)
+        gDrawLists[format].Create(DRAW_DATA_BINDING, INSTANCE_DATA_BINDING);
+    gLampDrawList.Create(DRAW_DATA_BINDING, INSTANCE_DATA_BINDING);
+    UCreateScene(gDeskCount);
+    UBuildLampDrawList();
+    if (gPointLightCount > 0)
+    {
+        gLightClusters.Create(gLightClusterGrid[0], gLightClusterGrid[1], gLightClusterGrid[2],
+            POINT_LIGHT_BINDING, CLUSTER_RANGE_BINDING, CLUSTER_INDEX_BINDING);
+        UCreatePointLights(gPointLightCount, gDeskCount);
+    }
+    glGenVertexArrays(1, &gFullscreenVao);
+    cout << "INFO: Renderer: " << (gRenderer == RENDERER_DEFERRED ? "deferred" : "forward") << " shading" << endl;
+
+    // Sets the background color of the window to black (it will be implicitely used by glClear)
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+
+    // render loop
+    // -----------
+    // Headless frames are compared between runs, so they start with every texture in place
+    if (gHeadlessOptions.enabled)
+    {
+        UApplyStreamedTextures(true);
+        URunHeadless();
+    }
+
+    while (!gHeadlessOptions.enabled && !glfwWindowShouldClose(gWindow))
+    {
+        // per-frame timing
+        // --------------------
+        float currentFrame = glfwGetTime();
+        gDeltaTime = currentFrame - gLastFrame;
+        gLastFrame = currentFrame;
+
+        // input
+        // -----
+        UProcessInput(gWindow);
+
+        // Mark whatever textures finished streaming since the last frame as ready
+        UApplyStreamedTextures(false);
+
+        // Render this frame, timed up to glFinish so the renderers compare without swap and vsync pacing
+        auto start = std::chrono::steady_clock::now();
+        URender();
+        glFinish();
+        gRendererTimer.Add(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+        // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
+        glfwSwapBuffers(gWindow);    // Flips the the back buffer with the front buffer every frame.
+        glfwPollEvents();
+    }
+
+    // Release mesh data
+    UDestroyMesh(gMesh);
+
+    // Release texture
+    gTextureStreamer.Destroy();
+    gTextureArray.Destroy();
+    gTextureAtlas.Destroy();
+    for (int format = 0; format < VERTEX_FORMAT_COUNT; ++format)
+        gDrawLists[format].Destroy();
+    gLampDrawList.Destroy();
+    gLightClusters.Destroy();
+    gGBuffer.Destroy();
+    glDeleteVertexArrays(1, &gFullscreenVao);
+
+    // Release shader program
+    gShaderVariants.Destroy();
+    gFrameUniforms.Destroy();
+
+    if (gHeadlessOptions.enabled)
+        gHeadless.Destroy();
+
+    exit(EXIT_SUCCESS); // Terminates the program successfully
+}
+
+
+// Initialize GLFW, GLEW, and create a window
+bool UInitialize(int argc, char* argv[], GLFWwindow** window)
+{
+    if (!gHeadlessOptions.Parse(argc, argv, COMMAND_LINE_FLAGS, sizeof(COMMAND_LINE_FLAGS) / sizeof(COMMAND_LINE_FLAGS[0])))
+        return false;
+
+    const char* tolerance = UFindArgument(argc, argv, "--vertex-tolerance");
+    if (tolerance)
+        gVertexTolerance.position = (float)atof(tolerance);
+    const char* desks = UFindArgument(argc, argv, "--desks");
+    if (desks)
+        gDeskCount = atoi(desks);
+    gCullingEnabled = !UHasArgument(argc, argv, "--no-cull");
+    gOcclusionEnabled = gCullingEnabled && !UHasArgument(argc, argv, "--no-occlusion");
+    const char* threads = UFindArgument(argc, argv, "--threads");
+    gThreadPool.reset(new ThreadPool(threads ? atoi(threads) : -1));
+    gLodEnabled = !UHasArgument(argc, argv, "--no-lod");
+    const char* compression = UFindArgument(argc, argv, "--texture-compression");
+    if (compression)
+    {
+        if (strcmp(compression, "none") == 0)
+            gTextureCompression = TEXTURE_COMPRESSION_NONE;
+        else if (strcmp(compression, "bc1") == 0)
+            gTextureCompression = TEXTURE_COMPRESSION_BC1;
+        else if (strcmp(compression, "bc7") == 0)
+            gTextureCompression = TEXTURE_COMPRESSION_BC7;
+        else
+        {
+            cout << "Unknown texture compression " << compression << " (expected none, bc1 or bc7)" << endl;
+            return false;
+        }
+    }
+    const char* mipFilter = UFindArgument(argc, argv, "--mip-filter");
+    if (mipFilter)
+    {
+        if (strcmp(mipFilter, "box") == 0)
+            gMipFilter = MIP_FILTER_BOX;
+        else if (strcmp(mipFilter, "kaiser") == 0)
+            gMipFilter = MIP_FILTER_KAISER;
+        else if (strcmp(mipFilter, "lanczos") == 0)
+            gMipFilter = MIP_FILTER_LANCZOS;
+        else
+        {
+            cout << "Unknown mip filter " << mipFilter << " (expected box, kaiser or lanczos)" << endl;
+            return false;
+        }
+    }
+    gPremultiplyAlpha = UHasArgument(argc, argv, "--premultiply-alpha");
+    const char* textureLayout = UFindArgument(argc, argv, "--texture-layout");
+    if (textureLayout)
+    {
+        if (strcmp(textureLayout, "array") == 0)
+            gTextureLayout = TEXTURE_LAYOUT_ARRAY;
+        else if (strcmp(textureLayout, "atlas") == 0)
+            gTextureLayout = TEXTURE_LAYOUT_ATLAS;
+        else
+        {
+            cout << "Unknown texture layout " << textureLayout << " (expected array or atlas)" << endl;
+            return false;
+        }
+    }
+    const char* layerSize = UFindArgument(argc, argv, "--texture-layer-size");
+    if (layerSize)
+        gTextureLayerSize = std::max(1, atoi(layerSize));
+    const char* programCache = UFindArgument(argc, argv, "--program-cache");
+    if (programCache)
+        gProgramCachePath = programCache;
+    if (UHasArgument(argc, argv, "--no-program-cache"))
+        gProgramCachePath = nullptr;
+    const char* lights = UFindArgument(argc, argv, "--lights");
+    if (lights)
+    {
+        gLightCount = atoi(lights);
+        if (gLightCount < 1 || gLightCount > MAX_SHADER_LIGHTS)
+        {
+            cout << "Unknown light count " << lights << " (expected 1 to " << MAX_SHADER_LIGHTS << ")" << endl;
+            return false;
+        }
+    }
+    if (UHasArgument(argc, argv, "--no-specular"))
+        gSpecularEnabled = false;
+    const char* renderer = UFindArgument(argc, argv, "--renderer");
+    if (renderer)
+    {
+        if (strcmp(renderer, "forward") == 0)
+            gRenderer = RENDERER_FORWARD;
+        else if (strcmp(renderer, "deferred") == 0)
+            gRenderer = RENDERER_DEFERRED;
+        else
+        {
+            cout << "Unknown renderer " << renderer << " (expected forward or deferred)" << endl;
+            return false;
+        }
+    }
+    const char* pointLights = UFindArgument(argc, argv, "--point-lights");
+    if (pointLights)
+        gPointLightCount = std::max(0, atoi(pointLights));
+    const char* lightClusters = UFindArgument(argc, argv, "--light-clusters");
+    if (lightClusters && (sscanf(lightClusters, "%dx%dx%d", &gLightClusterGrid[0], &gLightClusterGrid[1], &gLightClusterGrid[2]) != 3
+        || gLightClusterGrid[0] < 1 || gLightClusterGrid[1] < 1 || gLightClusterGrid[2] < 1))
+    {
+        cout << "Unknown light cluster grid " << lightClusters << " (expected XxYxZ, e.g. 16x9x24)" << endl;
+        return false;
+    }
+    const char* vertexBenchmark = UFindArgument(argc, argv, "--bench-vertices");
+    if (vertexBenchmark)
+    {
+        // needs a context but no window
+        gVertexBenchmarkInstances = std::max(1, atoi(vertexBenchmark));
+        gHeadlessOptions.enabled = true;
+    }
+    gBuildPackPath = UFindArgument(argc, argv, "--build-pack");
+    const char* pack = UFindArgument(argc, argv, "--pack");
+    if (pack && !gBuildPackPath)
+    {
+        if (gAssetPack.Open(pack))
+            cout << "INFO: Asset pack " << pack << ": " << gAssetPack.EntryCount() << " entries, " << gAssetPack.FileSize() / 1024 << " KB mapped" << endl;
+        else
+            cout << "Failed to open asset pack " << pack << ", loading the loose files" << endl;
+    }
+    if (gHeadlessOptions.enabled)
+        return UInitializeHeadless();
+
+    // GLFW: initialize and configure
+    // ------------------------------
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 4);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+    // GLFW: window creation
+    // ---------------------
+    * window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, WINDOW_TITLE, NULL, NULL);
+    if (*window == NULL)
+    {
+        std::cout << "Failed to create GLFW window" << std::endl;
+        glfwTerminate();
+        return false;
+    }
+    glfwMakeContextCurrent(*window);
+    glfwSetFramebufferSizeCallback(*window, UResizeWindow);
+    glfwSetCursorPosCallback(*window, UMousePositionCallback);
+    glfwSetScrollCallback(*window, UMouseScrollCallback);
+    glfwSetMouseButtonCallback(*window, UMouseButtonCallback);
+
+    // tell GLFW to capture our mouse
+    glfwSetInputMode(*window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+    // GLEW: initialize
+    // ----------------
+    // Note: if using GLEW version 1.13 or earlier
+    glewExperimental = GL_TRUE;
+    GLenum GlewInitResult = glewInit();
+
+    if (GLEW_OK != GlewInitResult)
+    {
+        std::cerr << glewGetErrorString(GlewInitResult) << std::endl;
+        return false;
+    }
+
+    // Displays GPU OpenGL version
+    cout << "INFO: OpenGL Version: " << glGetString(GL_VERSION) << endl;
+
+    return true;
+}
+
+
+// Returns the value following a "--name value" command line argument, or nullptr
+const char* UFindArgument(int argc, char* argv[], const char* name)
+{
+    for (int i = 1; i + 1 < argc; ++i)
+    {
+        if (strcmp(argv[i], name) == 0)
+            return argv[i + 1];
+    }
+    return nullptr;
+}
+
+
+// True when a flag without value was given on the command line
+bool UHasArgument(int argc, char* argv[], const char* name)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], name) == 0)
+            return true;
+    }
+    return false;
+}
+
+
+// Create a window-less EGL context and an offscreen framebuffer of the requested size
+bool UInitializeHeadless()
+{
+    if (!gHeadless.CreateContext())
+        return false;
+
+    glewExperimental = GL_TRUE;
+    GLenum GlewInitResult = glewInit();
+
+    // GLEW builds without EGL support still load every entry point, they only fail to find a GLX display
+    if (GLEW_OK != GlewInitResult && GLEW_ERROR_NO_GLX_DISPLAY != GlewInitResult)
+    {
+        std::cerr << glewGetErrorString(GlewInitResult) << std::endl;
+        return false;
+    }
+
+    if (!gHeadless.CreateFramebuffer(gHeadlessOptions.width, gHeadlessOptions.height))
+        return false;
+
+    gFramebufferWidth = gHeadlessOptions.width;
+    gFramebufferHeight = gHeadlessOptions.height;
+
+    cout << "INFO: OpenGL Version: " << glGetString(GL_VERSION) << endl;
+    cout << "INFO: OpenGL Renderer: " << glGetString(GL_RENDERER) << endl;
+    cout << "INFO: Headless " << gFramebufferWidth << "x" << gFramebufferHeight
+        << ", " << gHeadlessOptions.frames << " frames" << endl;
+
+    return true;
+}
+
+
+// Render a fixed number of frames offscreen, timing each one and optionally dumping images
+void URunHeadless()
+{
+    FrameTimer timer;
+    // fixed timestep so runs are reproducible
+    gDeltaTime = 1.0f / 60.0f;
+
+    for (int frame = 0; frame < gHeadlessOptions.frames; ++frame)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        URender();
+        // wait for the (software) rasterizer so the sample covers the whole frame
+        glFinish();
+
+        auto end = std::chrono::steady_clock::now();
+        timer.Add(std::chrono::duration<double, std::milli>(end - start).count());
+
+        if (gHeadlessOptions.ShouldDump(frame))
+        {
+            char filename[512];
+            snprintf(filename, sizeof(filename), "%s_%04d.ppm", gHeadlessOptions.dumpPrefix.c_str(), frame);
+            if (gHeadless.SaveFramebuffer(filename))
+                cout << "INFO: wrote " << filename << endl;
+        }
+    }
+
+    timer.Report(cout);
+    cout << "INFO: culling: " << gCullingStats.visible << " of " << gObjects.size() << " objects visible, "
+        << gCullingStats.boxTests << " box tests, " << gCullingStats.culls << " culling passes, "
+        << gCullingStats.milliseconds << " ms total" << (gCullingEnabled ? "" : " (disabled)") << endl;
+    if (gOcclusionEnabled)
+        cout << "INFO: occlusion: " << gOcclusionStats.occluded << " of " << gOcclusionStats.tested << " objects occluded by "
+            << gOcclusionStats.occluders << " occluders (" << gOcclusionStats.triangles << " triangles), "
+            << gOcclusionBuffer.Width() << "x" << gOcclusionBuffer.Height() << " buffer, "
+            << gThreadPool->ThreadCount() << " threads, " << gOcclusionStats.milliseconds << " ms total" << endl;
+    cout << "INFO: LOD:";
+    for (int lod = 0; lod < MAX_MESH_LODS; ++lod)
+        cout << (lod ? ", " : " ") << gLodStats.objects[lod] << " objects at level " << lod;
+    cout << ", " << gLodStats.switches << " switches" << (gLodEnabled ? "" : " (disabled)") << endl;
+    if (gLightClusters.LightCount() > 0)
+    {
+        const LightClusterStats& stats = gLightClusters.Stats();
+        glm::uvec4 grid = gLightClusters.Grid();
+        cout << "INFO: light clusters: " << gLightClusters.LightCount() << " point lights in " << grid.x << "x" << grid.y << "x" << grid.z
+            << " clusters, " << stats.occupied << " clusters lit, " << (stats.occupied ? (double)stats.references / stats.occupied : 0.0)
+            << " lights per lit cluster (" << stats.maxPerCluster << " at most), " << stats.passes << " assignment passes, "
+            << gThreadPool->ThreadCount() << " threads, " << stats.milliseconds << " ms total" << endl;
+    }
+}
+
+
+// Runs work a few times and returns the fastest run in milliseconds
+template <typename Work>
+double UBestOf(int repetitions, Work work)
+{
+    double best = 1e30;
+    for (int i = 0; i < repetitions; ++i)
+    {
+        auto start = std::chrono::steady_clock::now();
+        work();
+        auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    return best;
+}
+
+
+// Times world, MVP and normal matrices for objectCount objects: per-object glm calls against the batch kernels
+void URunTransformBenchmark(int objectCount)
+{
+    const int repetitions = 20;
+    size_t count = objectCount > 0 ? (size_t)objectCount : 1;
+
+    // random but reproducible transforms, each object below one of a few parents
+    TransformSoA trs;
+    trs.Resize(count);
+    std::vector<glm::mat4> parents(count);
+    unsigned int seed = 12345u;
+    auto random = [&seed](float low, float high)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return low + (high - low) * (float)(seed >> 8) / 16777216.0f;
+    };
+    glm::mat4 parentPool[16];
+    for (glm::mat4& parent : parentPool)
+        parent = glm::translate(glm::vec3(random(-50.0f, 50.0f), 0.0f, random(-50.0f, 50.0f)))
+            * glm::rotate(random(0.0f, 6.28f), glm::vec3(0.0f, 1.0f, 0.0f));
+    for (size_t i = 0; i < count; ++i)
+    {
+        glm::quat rotation = glm::angleAxis(random(0.0f, 6.28f), glm::normalize(glm::vec3(random(-1.0f, 1.0f), 1.0f, random(-1.0f, 1.0f))));
+        trs.Set(i, glm::vec3(random(-5.0f, 5.0f), random(0.0f, 2.0f), random(-5.0f, 5.0f)), rotation,
+            glm::vec3(random(0.5f, 2.0f), random(0.5f, 2.0f), random(0.5f, 2.0f)));
+        parents[i] = parentPool[i % 16];
+    }
+    glm::mat4 viewProjection = glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, 0.1f, 100.0f)
+        * glm::lookAt(glm::vec3(0.0f, 5.0f, 20.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+    std::vector<glm::mat4> local(count), world(count), mvp(count);
+    std::vector<glm::mat4> referenceWorld(count), referenceMvp(count);
+    std::vector<glm::mat3> referenceNormals(count);
+    std::vector<NormalMatrix> normals(count);
+
+    // what URender used to do for every object
+    double glmTime = UBestOf(repetitions, [&]()
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            glm::mat4 model = glm::translate(trs.Position(i)) * glm::mat4_cast(trs.Rotation(i)) * glm::scale(trs.Scale(i));
+            referenceWorld[i] = parents[i] * model;
+            referenceMvp[i] = viewProjection * referenceWorld[i];
+            referenceNormals[i] = glm::transpose(glm::inverse(glm::mat3(referenceWorld[i])));
+        }
+    });
+
+    double scalarTime = UBestOf(repetitions, [&]()
+    {
+        ComposeLocalMatricesScalar(trs, 0, count, local.data());
+        MultiplyMatricesScalar(parents.data(), local.data(), world.data(), count);
+        PremultiplyMatricesScalar(viewProjection, world.data(), mvp.data(), count);
+        ComputeNormalMatricesScalar(world.data(), normals.data(), count);
+    });
+
+    double batchTime = UBestOf(repetitions, [&]()
+    {
+        ComposeLocalMatrices(trs, 0, count, local.data());
+        MultiplyMatrices(parents.data(), local.data(), world.data(), count);
+        PremultiplyMatrices(viewProjection, world.data(), mvp.data(), count);
+        ComputeNormalMatrices(world.data(), normals.data(), count);
+    });
+
+    // the batch results must match the glm path
+    float worldError = 0.0f, mvpError = 0.0f, normalError = 0.0f;
+    for (size_t i = 0; i < count; ++i)
+    {
+        for (int c = 0; c < 4; ++c)
+        {
+            for (int r = 0; r < 4; ++r)
+            {
+                worldError = std::max(worldError, fabsf(world[i][c][r] - referenceWorld[i][c][r]));
+                mvpError = std::max(mvpError, fabsf(mvp[i][c][r] - referenceMvp[i][c][r]));
+                if (c < 3 && r < 3)
+                    normalError = std::max(normalError, fabsf(normals[i].columns[c][r] - referenceNormals[i][c][r]));
+            }
+        }
+    }
+
+    cout << "INFO: Transform benchmark, " << count << " objects (world, MVP and normal matrix each), best of " << repetitions << endl;
+    cout << "INFO:   glm per object: " << glmTime << " ms (" << glmTime * 1e6 / count << " ns/object)" << endl;
+    cout << "INFO:   scalar batch:   " << scalarTime << " ms (" << scalarTime * 1e6 / count << " ns/object)" << endl;
+    cout << "INFO:   " << SimdInstructionSet() << " batch: " << batchTime << " ms (" << batchTime * 1e6 / count
+        << " ns/object), " << glmTime / batchTime << "x faster than glm" << endl;
+    cout << "INFO:   max difference to glm: world " << worldError << ", MVP " << mvpError << ", normal " << normalError << endl;
+}
+
+
+// Times the scene's vertex shader on a high-poly mesh drawn instanceCount times: with the normal matrix inverted
+// per vertex, as the shader used to, and read from the instance data. Triangles land in a small viewport so
+// rasterization and fragment shading stay out of the measurement.
+bool URunVertexBenchmark(int instanceCount)
+{
+    const int repetitions = 10;
+    const int viewportSize = 64;
+    GLuint count = (GLuint)std::max(instanceCount, 1);
+
+    // the mouse shell at a far finer tessellation than any of its LODs, welded and optimized like them
+    std::vector<float> soup = GenerateMouse(256, 256);
+    MeshBuffer buffer(VERTEX_FORMAT_FLOAT);
+    MeshRange range = buffer.Add(soup.data(), (GLuint)(soup.size() / MeshBuffer::FloatsPerEntry));
+    buffer.Upload();
+
+    // a square grid of rotated, non-uniformly scaled copies in front of the camera
+    int columns = (int)ceilf(sqrtf((float)count));
+    std::vector<InstanceData> instances(count);
+    for (GLuint i = 0; i < count; ++i)
+    {
+        float x = (float)(i % columns) - 0.5f * (columns - 1), y = (float)(i / columns) - 0.5f * (columns - 1);
+        instances[i].model = glm::translate(glm::vec3(x, y, 0.0f)) * glm::rotate(0.7f * i, glm::vec3(0.3f, 1.0f, 0.2f))
+            * glm::scale(glm::vec3(0.8f, 0.5f + 0.1f * (i % 4), 0.6f));
+        ComputeNormalMatrices(&instances[i].model, &instances[i].normal, 1);
+        instances[i].textureIndex = 0;
+        instances[i].padding[0] = instances[i].padding[1] = instances[i].padding[2] = 0;
+    }
+    DrawList list;
+    list.Create(DRAW_DATA_BINDING, INSTANCE_DATA_BINDING);
+    list.AddInstances(range, instances.data(), count);
+    list.Upload();
+
+    FrameUniforms frame = {};
+    frame.view = glm::lookAt(glm::vec3(0.0f, 0.0f, 1.5f * columns), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    frame.projection = glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 100.0f * columns);
+    frame.viewProjection = frame.projection * frame.view;
+    frame.cameraPosition = glm::vec4(0.0f, 0.0f, 1.5f * columns, 1.0f);
+    frame.lightColors[0] = glm::vec4(gLightColor, 1.0f);
+    frame.lightPositions[0] = glm::vec4(gLightPosition, 1.0f);
+    frame.uvScale = glm::vec4(1.0f);
+    gFrameUniforms.Create(FRAME_UNIFORM_BINDING);
+    gFrameUniforms.Update(frame);
+
+    glEnable(GL_DEPTH_TEST);
+    glViewport(0, 0, viewportSize, viewportSize);
+    buffer.Bind();
+
+    // the scene's float-vertex variant, untextured so no texture has to be loaded
+    const char* names[2] = { "inverse per vertex:        ", "normal matrix per instance:" };
+    ShaderPermutation permutations[2] = {
+        ShaderPermutation(SHADER_FEATURE_SPECULAR | SHADER_FEATURE_INVERSE_NORMALS, 1),
+        ShaderPermutation(SHADER_FEATURE_SPECULAR, 1) };
+    double times[2] = {};
+    bool built = true;
+    for (int i = 0; i < 2 && built; ++i)
+    {
+        ShaderVariant variant;
+        built = UCreateShaderVariant(permutations[i], variant);
+        if (!built)
+            break;
+        variant.program.Use();
+        // the first repetition also pays for the driver's shader JIT, best of keeps it out
+        times[i] = UBestOf(repetitions, [&]()
+        {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            list.Submit(buffer.IndexType);
+            glFinish();
+        });
+        UDestroyShaderProgram(variant.program);
+    }
+
+    if (built)
+    {
+        double vertices = (double)range.vertexCount * count;
+        cout << "INFO: Vertex benchmark, " << count << " instances of a " << range.vertexCount << " vertex, "
+            << range.indexCount / 3 << " triangle mesh, " << viewportSize << "x" << viewportSize << " viewport, best of "
+            << repetitions << endl;
+        for (int i = 0; i < 2; ++i)
+            cout << "INFO:   " << names[i] << " " << times[i] << " ms (" << vertices / (times[i] * 1e3) << " M vertices/s)" << endl;
+        cout << "INFO:   " << times[0] / times[1] << "x the vertex throughput" << endl;
+    }
+
+    list.Destroy();
+    buffer.Destroy();
+    gFrameUniforms.Destroy();
+    gHeadless.Destroy();
+    return built;
+}
+
+
+// process all input: query GLFW whether relevant keys are pressed/released this frame and react accordingly
+void UProcessInput(GLFWwindow* window)
+{
+    static const float cameraSpeed = 2.5f;
+
+    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+        glfwSetWindowShouldClose(window, true);
+
+    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+        gCamera.ProcessKeyboard(FORWARD, gDeltaTime);
+    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+        gCamera.ProcessKeyboard(BACKWARD, gDeltaTime);
+    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+        gCamera.ProcessKeyboard(LEFT, gDeltaTime);
+    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+        gCamera.ProcessKeyboard(RIGHT, gDeltaTime);
+    if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS)
+        gCamera.ProcessKeyboard(UP, gDeltaTime);
+    if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS)
+        gCamera.ProcessKeyboard(DOWN, gDeltaTime);
+    if (glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS)
+        isPerspective = !isPerspective;
+
+    // R switches between forward and deferred shading, once per press
+    static bool rendererKeyDown = false;
+    bool rendererKey = glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS;
+    if (rendererKey && !rendererKeyDown)
+        USwitchRenderer();
+    rendererKeyDown = rendererKey;
+}
+
+
+// glfw: whenever the window size changed (by OS or user resize) this callback function executes
+void UResizeWindow(GLFWwindow* window, int width, int height)
+{
+    gFramebufferWidth = width;
+    gFramebufferHeight = height;
+    glViewport(0, 0, width, height);
+}
+
+
+// glfw: whenever the mouse moves, this callback is called
+// -------------------------------------------------------
+void UMousePositionCallback(GLFWwindow* window, double xpos, double ypos)
+{
+    if (gFirstMouse)
+    {
+        gLastX = xpos;
+        gLastY = ypos;
+        gFirstMouse = false;
+    }
+
+    float xoffset = xpos - gLastX;
+    float yoffset = gLastY - ypos; // reversed since y-coordinates go from bottom to top
+
+    gLastX = xpos;
+    gLastY = ypos;
+
+    gCamera.ProcessMouseMovement(xoffset, yoffset);
+}
+
+
+// glfw: whenever the mouse scroll wheel scrolls, this callback is called
+// ----------------------------------------------------------------------
+void UMouseScrollCallback(GLFWwindow* window, double xoffset, double yoffset)
+{
+    gCamera.ProcessMouseScroll(yoffset);
+}
+
+// glfw: handle mouse button events
+// --------------------------------
+void UMouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
+{
+    switch (button)
+    {
+    case GLFW_MOUSE_BUTTON_LEFT:
+    {
+        if (action == GLFW_PRESS)
+            cout << "Left mouse button pressed" << endl;
+        else
+            cout << "Left mouse button released" << endl;
+    }
+    break;
+
+    case GLFW_MOUSE_BUTTON_MIDDLE:
+    {
+        if (action == GLFW_PRESS)
+            cout << "Middle mouse button pressed" << endl;
+        else
+            cout << "Middle mouse button released" << endl;
+    }
+    break;
+
+    case GLFW_MOUSE_BUTTON_RIGHT:
+    {
+        if (action == GLFW_PRESS)
+            cout << "Right mouse button pressed" << endl;
+        else
+            cout << "Right mouse button released" << endl;
+    }
+    break;
+
+    default:
+        cout << "Unhandled mouse button event" << endl;
+        break;
+    }
+}
+
+
+// Functioned called to render a frame
+void URender()
+{
+    // Enable z-depth
+    glEnable(GL_DEPTH_TEST);
+
+    // Clear the frame and z buffers
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // camera/view transformation
+    glm::mat4 view = gCamera.GetViewMatrix();
+
+    // Creates a perspective projection
+// Creates a projection THEN create perspective or orthographic view
+    glm::mat4 projection;
+    // NOW check if 'isPerspective' and THEN set the perspective
+    if (isPerspective) {
+        projection = glm::perspective(glm::radians(gCamera.Zoom),
+            (GLfloat)gFramebufferWidth / (GLfloat)gFramebufferHeight, 0.1f, 100.0f);
+    }
+    else {
+        float scale = 90;
+        projection = glm::ortho((800.0f / scale), -(800.0f / scale), -(600.0f /
+            scale), (600.0f / scale), -2.5f, 6.5f);
+    }
+    //glm::mat4 projection = glm::perspective(glm::radians(gCamera.Zoom),
+    //(GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, 0.1f, 100.0f);
+
+    // Upload camera, light and uv data once for every program that reads FrameData
+    FrameUniforms frame;
+    frame.view = view;
+    frame.projection = projection;
+    frame.viewProjection = projection * view;
+    frame.cameraPosition = glm::vec4(gCamera.Position, 1.0f);
+    for (int light = 0; light < MAX_SHADER_LIGHTS; ++light)
+    {
+        frame.lightColors[light] = glm::vec4(0.0f);
+        frame.lightPositions[light] = glm::vec4(0.0f);
+    }
+    frame.lightColors[0] = glm::vec4(gLightColor, 1.0f);
+    frame.lightPositions[0] = glm::vec4(gLightPosition, 1.0f);
+    for (int light = 1; light < gLightCount; ++light)
+    {
+        frame.lightColors[light] = glm::vec4(FILL_LIGHT_COLORS[light - 1], 1.0f);
+        frame.lightPositions[light] = glm::vec4(FILL_LIGHT_POSITIONS[light - 1], 1.0f);
+    }
+    frame.uvScale = glm::vec4(gUVScale.x, gUVScale.y, 0.0f, 0.0f);
+
+    // Point lights are binned again only when the camera moved; they do not move themselves
+    if (gLightClusters.LightCount() > 0)
+    {
+        if (view != gClusteredView || projection != gClusteredProjection)
+        {
+            gLightClusters.Assign(view, projection, gThreadPool.get());
+            gClusteredView = view;
+            gClusteredProjection = projection;
+        }
+        gLightClusters.Bind();
+    }
+    frame.clusterGrid = gLightClusters.Grid();
+    frame.clusterSlicing = gLightClusters.Slicing(gFramebufferWidth, gFramebufferHeight);
+    gFrameUniforms.Update(frame);
+
+    // World matrices, object bounds and the draw lists built from the visible objects only change when a node
+    // or the camera moved; a static view does no matrix math, culling or uploads here.
+    // The texture array stays bound.
+    bool sceneMoved = gSceneGraph.Update() > 0;
+    if (sceneMoved)
+        UUpdateObjectBounds();
+    if (sceneMoved || frame.viewProjection != gCulledViewProjection)
+    {
+        UCullObjects(frame.viewProjection);
+        USelectLods(view, projection);
+        UBuildDrawLists();
+    }
+
+    // The deferred path draws the same lists into the G-buffer first and lights them afterwards
+    if (gRenderer == RENDERER_DEFERRED && !gGBuffer.Resize(gFramebufferWidth, gFramebufferHeight))
+    {
+        cout << "INFO: Switching to forward shading" << endl;
+        gRenderer = RENDERER_FORWARD;
+    }
+    if (gRenderer == RENDERER_DEFERRED)
+        gGBuffer.BeginGeometryPass();
+
+    // Activate each format's shared VAO and draw all of its objects with a single call, in the variant
+    // that decodes that format
+    for (int format = 0; format < VERTEX_FORMAT_COUNT; ++format)
+    {
+        if (gDrawLists[format].Commands.empty() || !UUseShaderVariant(URendererPermutation(USceneShaderPermutation((VertexFormat)format))))
+            continue;
+        gMesh.buffers[format].Bind();
+        gDrawLists[format].Submit(gMesh.buffers[format].IndexType);
+    }
+
+    // LAMP: draw light
+//----------------
+    // Unlit, untextured variant; the lamps' quantization box comes from the draw list like any other mesh
+    VertexFormat lampFormat = gMesh.ranges[MESH_PLANE][0].format;
+    if (UUseShaderVariant(URendererPermutation(ULampShaderPermutation(lampFormat))))
+    {
+        gMesh.buffers[lampFormat].Bind();
+        gLampDrawList.Submit(gMesh.buffers[lampFormat].IndexType);
+    }
+
+    // Deferred lighting: one full-screen triangle lights every pixel of the G-buffer once, whatever the overdraw
+    if (gRenderer == RENDERER_DEFERRED)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, gHeadlessOptions.enabled ? gHeadless.Fbo : 0);
+        ShaderVariant* lighting = UUseShaderVariant(UDeferredLightingPermutation());
+        if (lighting)
+        {
+            lighting->uniforms.uInverseViewProjection.Set(glm::inverse(frame.viewProjection));
+            gGBuffer.BindTextures(GBUFFER_FIRST_UNIT);
+            glDisable(GL_DEPTH_TEST);
+            glBindVertexArray(gFullscreenVao);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+            glEnable(GL_DEPTH_TEST);
+        }
+    }
+
+    // Deactivate the Vertex Array Object
+    glBindVertexArray(0);
+}
+
+
+// Implements the UCreateMesh function
+void UCreateMesh(GLMesh& mesh)
+{
+    for (int format = 0; format < VERTEX_FORMAT_COUNT; ++format)
+        mesh.buffers[format].Format = (VertexFormat)format;
+    if (gAssetPack.IsOpen() && ULoadMeshFromPack(mesh))
+        return;
+
+    const float Repeat = 1;
+    // Vertex data
+   GLfloat planeverts[] = {
+        //Plane Vertex 
+        // Vertex Positions   //Normals           //Texture Coordinates
+       -5.5f, -0.1f, -5.0f,  0.0f,  1.0f,  0.0f,  0.0f, 0.0f,
+        5.5f, -0.1f, -5.0f,  0.0f,  1.0f,  0.0f,  Repeat, Repeat,
+        5.5f, -0.1f,  5.0f,  0.0f,  1.0f,  0.0f,  0.0f, Repeat,
+        5.5f, -0.1f,  5.0f,  0.0f,  1.0f,  0.0f,  0.0f, 0.0f,
+       -5.5f, -0.1f,  5.0f,  0.0f,  1.0f,  0.0f,  Repeat, Repeat,
+       -5.0f, -0.1f, -5.0f,  0.0f,  1.0f,  0.0f,  Repeat, 0.0f, 
+};
+
+    GLfloat paperverts[] = {
+        //Plane Vertex 
+        // Vertex Positions   //Normals           //Texture Coordinates
+        -2.0f,  0.0f, -2.0f,  0.0f, 1.0f, 0.0f,   0.0f, 0.0f,
+         2.0f,  0.0f, -2.0f,  0.0f, 1.0f, 0.0f,   Repeat, Repeat,
+         2.0f,  0.0f,  2.0f,  0.0f, 1.0f, 0.0f,   0.0f, Repeat,
+         2.0f,  0.0f,  2.0f,  0.0f, 1.0f, 0.0f,   0.0f, 0.0f,
+        -2.0f,  0.0f,  2.0f,  0.0f, 1.0f, 0.0f,   Repeat, Repeat,
+        -2.0f,  0.0f, -2.0f,  0.0f, 1.0f, 0.0f,   Repeat, 0.0f,
+    };
+
+    const GLuint floatsPerEntry = MeshBuffer::FloatsPerEntry;
+
+    // Suballocate every mesh into the shared buffers, welding duplicated corners into indexed meshes
+    // and reordering them for vertex cache, overdraw and fetch locality
+    UAddMesh(mesh, MESH_PLANE, 0, "plane", planeverts, sizeof(planeverts) / (sizeof(planeverts[0]) * floatsPerEntry));
+    UAddMesh(mesh, MESH_PAPER, 0, "paper", paperverts, sizeof(paperverts) / (sizeof(paperverts[0]) * floatsPerEntry));
+
+    // The props are generated once per level of detail, finest first: a round pencil that turns hexagonal
+    // far away, a rounded mouse shell and a keyboard slab whose bevel flattens into a plain box
+    const int pencilSides[MAX_MESH_LODS] = { 24, 12, 6 };
+    const int mouseSegments[MAX_MESH_LODS] = { 32, 12, 6 };
+    const int mouseRings[MAX_MESH_LODS] = { 8, 3, 1 };
+    const int keyboardBevels[MAX_MESH_LODS] = { 4, 1, 0 };
+    for (int lod = 0; lod < MAX_MESH_LODS; ++lod)
+    {
+        std::vector<GLfloat> pencil = GeneratePencil(pencilSides[lod], pencilSides[lod] > 6);
+        std::vector<GLfloat> keyboard = GenerateKeyboard(keyboardBevels[lod]);
+        std::vector<GLfloat> mouse = GenerateMouse(mouseSegments[lod], mouseRings[lod]);
+        UAddMesh(mesh, MESH_PENCIL, lod, "pencil", pencil.data(), (GLuint)(pencil.size() / floatsPerEntry));
+        UAddMesh(mesh, MESH_KEYBOARD, lod, "keyboard", keyboard.data(), (GLuint)(keyboard.size() / floatsPerEntry));
+        UAddMesh(mesh, MESH_MOUSE, lod, "mouse", mouse.data(), (GLuint)(mouse.size() / floatsPerEntry));
+    }
+
+    // One VAO, vertex buffer and index buffer per vertex format in use
+    for (int format = 0; format < VERTEX_FORMAT_COUNT; ++format)
+    {
+        MeshBuffer& buffer = mesh.buffers[format];
+        if (buffer.IsEmpty())
+            continue;
+        buffer.Upload();
+        cout << "INFO: Scene geometry (" << (format == VERTEX_FORMAT_PACKED ? "packed" : "float") << "): "
+            << buffer.VertexCount << " vertices, " << buffer.VertexData.size() << " bytes, "
+            << (buffer.IndexType == GL_UNSIGNED_SHORT ? 16 : 32) << "-bit indices" << endl;
+    }
+}
+
+
+// Welds and optimizes one triangle soup, then stores it as level lod of a mesh in the buffer of the smallest
+// format within tolerance
+void UAddMesh(GLMesh& mesh, int meshIndex, int lod, const char* name, const GLfloat* vertices, GLuint vertexCount)
+{
+    IndexedMesh indexed = WeldVertices(vertices, vertexCount, MeshBuffer::FloatsPerEntry);
+    MeshOptimizationStats stats;
+    OptimizeMesh(indexed, MeshBuffer::FloatsPerVertex, &stats);
+
+    QuantizationError error;
+    VertexFormat format = ChooseVertexFormat(indexed.vertices.data(), indexed.VertexCount(), gVertexTolerance, &error);
+    mesh.ranges[meshIndex][lod] = mesh.buffers[format].Add(indexed);
+    mesh.lodCounts[meshIndex] = std::max(mesh.lodCounts[meshIndex], lod + 1);
+
+    // occluders keep their welded positions on the CPU for the occlusion buffer. Only the finest level lies
+    // inside what is drawn at every distance (the keyboard's plain box is wider than its bevelled slab), so a
+    // coarser one could hide objects that are visible along its edges
+    if (MESH_OCCLUDERS[meshIndex] && lod == 0)
+    {
+        OccluderMesh& occluder = gOccluderMeshes[meshIndex];
+        occluder.positions.resize(indexed.VertexCount());
+        for (size_t v = 0; v < occluder.positions.size(); ++v)
+        {
+            const GLfloat* vertex = &indexed.vertices[v * indexed.floatsPerVertex];
+            occluder.positions[v] = glm::vec3(vertex[0], vertex[1], vertex[2]);
+        }
+        occluder.indices.assign(indexed.indices.begin(), indexed.indices.end());
+    }
+
+    cout << "INFO: Mesh " << name << " LOD " << lod << ": " << indexed.indices.size() / 3 << " triangles, ACMR " << stats.before.acmr << " -> " << stats.after.acmr
+        << ", ATVR " << stats.before.atvr << " -> " << stats.after.atvr
+        << ", " << stats.clusters << " clusters" << (stats.overdrawApplied ? " (overdraw sorted)" : "")
+        << ", " << (format == VERTEX_FORMAT_PACKED ? "packed" : "float")
+        << " (error pos " << error.position << " normal " << error.normal << " deg uv " << error.uv << ")" << endl;
+}
+
+
+// Uploads the meshes straight from the asset pack's mapping and copies out the occluders; false when the pack
+// holds no complete scene geometry or any of it is out of range, before anything was created
+bool ULoadMeshFromPack(GLMesh& mesh)
+{
+    size_t rangesSize = 0, lodsSize = 0;
+    const unsigned char* ranges = gAssetPack.Find("mesh/ranges", rangesSize);
+    const unsigned char* lods = gAssetPack.Find("mesh/lods", lodsSize);
+    if (!ranges || rangesSize != sizeof(mesh.ranges) || !lods || lodsSize != sizeof(mesh.lodCounts))
+        return false;
+
+    struct BufferEntries
+    {
+        const unsigned char* vertices = nullptr;
+        const unsigned char* indices = nullptr;
+        size_t vertexBytes = 0, indexBytes = 0;
+        size_t indexSize = 0;
+        PackedMeshBuffer counts = {};
+    };
+    BufferEntries entries[VERTEX_FORMAT_COUNT];
+    for (int format = 0; format < VERTEX_FORMAT_COUNT; ++format)
+    {
+        std::string prefix = std::string("mesh/") + (format == VERTEX_FORMAT_PACKED ? "packed" : "float");
+        size_t countsSize;
+        const unsigned char* counts = gAssetPack.Find(prefix + "/counts", countsSize);
+        if (!counts)
+            continue; // no mesh in this format
+        BufferEntries& entry = entries[format];
+        entry.vertices = gAssetPack.Find(prefix + "/vertices", entry.vertexBytes);
+        entry.indices = gAssetPack.Find(prefix + "/indices", entry.indexBytes);
+        if (countsSize != sizeof(entry.counts) || !entry.vertices || !entry.indices)
+            return false;
+        memcpy(&entry.counts, counts, sizeof(entry.counts));
+        if (entry.vertexBytes != (size_t)entry.counts.vertexCount * VertexStride((VertexFormat)format)
+            || (entry.counts.indexType != GL_UNSIGNED_SHORT && entry.counts.indexType != GL_UNSIGNED_INT))
+            return false;
+        entry.indexSize = entry.counts.indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+        if (entry.indexBytes % entry.indexSize != 0)
+            return false;
+    }
+
+    // the pack is trusted no further than its sizes: every level drawn must lie inside a buffer that was found,
+    // and every index it holds must stay inside its own vertices
+    MeshRange packedRanges[MESH_COUNT][MAX_MESH_LODS];
+    int packedLodCounts[MESH_COUNT];
+    memcpy(packedRanges, ranges, sizeof(packedRanges));
+    memcpy(packedLodCounts, lods, sizeof(packedLodCounts));
+    for (int i = 0; i < MESH_COUNT; ++i)
+    {
+        if (packedLodCounts[i] < 1 || packedLodCounts[i] > MAX_MESH_LODS)
+            return false;
+        for (int lod = 0; lod < packedLodCounts[i]; ++lod)
+        {
+            const MeshRange& range = packedRanges[i][lod];
+            if ((unsigned)range.format >= VERTEX_FORMAT_COUNT || !entries[range.format].vertices)
+                return false;
+            const BufferEntries& entry = entries[range.format];
+            if ((uint64_t)range.firstIndex + range.indexCount > entry.indexBytes / entry.indexSize || range.indexCount % 3 != 0
+                || range.baseVertex < 0 || (uint64_t)range.baseVertex + range.vertexCount > entry.counts.vertexCount)
+                return false;
+            for (GLuint index = range.firstIndex; index < range.firstIndex + range.indexCount; ++index)
+            {
+                uint32_t vertex = 0;
+                if (entry.indexSize == sizeof(GLushort))
+                {
+                    GLushort shortIndex;
+                    memcpy(&shortIndex, entry.indices + (size_t)index * sizeof(GLushort), sizeof(shortIndex));
+                    vertex = shortIndex;
+                }
+                else
+                    memcpy(&vertex, entry.indices + (size_t)index * sizeof(GLuint), sizeof(vertex));
+                if (vertex >= range.vertexCount)
+                    return false;
+            }
+        }
+    }
+
+    // the occlusion buffer rasterizes on the CPU, so occluders are the one thing copied out of the mapping
+    OccluderMesh occluders[MESH_COUNT];
+    for (int i = 0; i < MESH_COUNT; ++i)
+    {
+        size_t positionsSize = 0, indicesSize = 0;
+        const unsigned char* positions = gAssetPack.Find("occluder/" + std::to_string(i) + "/positions", positionsSize);
+        const unsigned char* indices = gAssetPack.Find("occluder/" + std::to_string(i) + "/indices", indicesSize);
+        if (!positions || !indices)
+            continue;
+        if (positionsSize % sizeof(glm::vec3) != 0 || indicesSize % (3 * sizeof(uint32_t)) != 0)
+            return false;
+        OccluderMesh& occluder = occluders[i];
+        occluder.positions.resize(positionsSize / sizeof(glm::vec3));
+        memcpy(occluder.positions.data(), positions, occluder.positions.size() * sizeof(glm::vec3));
+        occluder.indices.resize(indicesSize / sizeof(uint32_t));
+        memcpy(occluder.indices.data(), indices, occluder.indices.size() * sizeof(uint32_t));
+        for (uint32_t index : occluder.indices)
+        {
+            if (index >= occluder.positions.size())
+                return false;
+        }
+    }
+
+    memcpy(mesh.ranges, packedRanges, sizeof(mesh.ranges));
+    memcpy(mesh.lodCounts, packedLodCounts, sizeof(mesh.lodCounts));
+    for (int format = 0; format < VERTEX_FORMAT_COUNT; ++format)
+    {
+        const BufferEntries& entry = entries[format];
+        if (!entry.vertices)
+            continue;
+        MeshBuffer& buffer = mesh.buffers[format];
+        buffer.VertexCount = entry.counts.vertexCount;
+        buffer.Upload(entry.vertices, entry.vertexBytes, entry.indices, entry.indexBytes, entry.counts.indexType);
+        cout << "INFO: Scene geometry (" << (format == VERTEX_FORMAT_PACKED ? "packed" : "float") << ") from pack: "
+            << buffer.VertexCount << " vertices, " << entry.vertexBytes << " bytes, "
+            << (buffer.IndexType == GL_UNSIGNED_SHORT ? 16 : 32) << "-bit indices" << endl;
+    }
+    for (int i = 0; i < MESH_COUNT; ++i)
+    {
+        if (!occluders[i].indices.empty())
+            gOccluderMeshes[i] = std::move(occluders[i]);
+    }
+    return true;
+}
+
+
+// Writes every texture, as this run would upload it, and the scene geometry into one asset pack (--build-pack FILE)
+bool UBuildAssetPack(const char* path)
+{
+    AssetPackWriter writer;
+    for (int i = 0; i < TEXTURE_COUNT; ++i)
+    {
+        TextureLevels levels;
+        if (!gTextureStreamer.LoadLevels(TEXTURE_FILES[i], levels))
+        {
+            cout << "Failed to load texture " << TEXTURE_FILES[i] << endl;
+            return false;
+        }
+        std::vector<unsigned char> bytes;
+        SerializeTextureLevels(levels, 0, bytes);
+        writer.Add(std::string("texture/") + TEXTURE_FILES[i], bytes.data(), bytes.size());
+    }
+
+    UCreateMesh(gMesh);
+    writer.Add("mesh/ranges", gMesh.ranges, sizeof(gMesh.ranges));
+    writer.Add("mesh/lods", gMesh.lodCounts, sizeof(gMesh.lodCounts));
+    for (int format = 0; format < VERTEX_FORMAT_COUNT; ++format)
+    {
+        const MeshBuffer& buffer = gMesh.buffers[format];
+        if (buffer.IsEmpty())
+            continue;
+        std::string prefix = std::string("mesh/") + (format == VERTEX_FORMAT_PACKED ? "packed" : "float");
+        std::vector<unsigned char> indices;
+        PackedMeshBuffer counts = { buffer.VertexCount, buffer.EncodeIndices(indices) };
+        writer.Add(prefix + "/counts", &counts, sizeof(counts));
+        writer.Add(prefix + "/vertices", buffer.VertexData.data(), buffer.VertexData.size());
+        writer.Add(prefix + "/indices", indices.data(), indices.size());
+    }
+    for (int i = 0; i < MESH_COUNT; ++i)
+    {
+        const OccluderMesh& occluder = gOccluderMeshes[i];
+        if (occluder.indices.empty())
+            continue;
+        writer.Add("occluder/" + std::to_string(i) + "/positions", occluder.positions.data(), occluder.positions.size() * sizeof(glm::vec3));
+        writer.Add("occluder/" + std::to_string(i) + "/indices", occluder.indices.data(), occluder.indices.size() * sizeof(uint32_t));
+    }
+    UDestroyMesh(gMesh);
+
+    if (!writer.Write(path))
+    {
+        cout << "Failed to write asset pack " << path << endl;
+        return false;
+    }
+    cout << "INFO: Wrote asset pack " << path << " (" << writer.PayloadCount() << " entries, "
+        << TextureCompressionName(gTextureCompression) << " textures, " << MipFilterName(gMipFilter) << " mips)" << endl;
+    return true;
+}
+
+
+// Creates one desk: the plane is the root, the other objects are placed relative to it
+SceneGraph::NodeId UCreateDesk(const glm::vec3& position)
+{
+    SceneGraph::NodeId plane = gSceneGraph.CreateNode(SceneGraph::InvalidNode, position);
+    SceneGraph::NodeId paper = gSceneGraph.CreateNode(plane, glm::vec3(-3.5f, 0.0f, -2.5f));
+    // the pencil belongs to the paper, so moving the paper carries it along
+    SceneGraph::NodeId pencil = gSceneGraph.CreateNode(paper, glm::vec3(7.5f, 0.0f, 5.5f));
+    SceneGraph::NodeId keyboard = gSceneGraph.CreateNode(plane, glm::vec3(3.5f, 0.0f, -1.5f));
+    SceneGraph::NodeId mouse = gSceneGraph.CreateNode(plane, glm::vec3(-4.0f, 0.0f, 1.0f), glm::quat(), glm::vec3(0.4f, 0.1f, 0.1f));
+
+    gObjects.push_back({ plane, MESH_PLANE, 0 });
+    gObjects.push_back({ paper, MESH_PAPER, 0 });
+    gObjects.push_back({ pencil, MESH_PENCIL, 0 });
+    gObjects.push_back({ keyboard, MESH_KEYBOARD, 0 });
+    gObjects.push_back({ mouse, MESH_MOUSE, 0 });
+    return plane;
+}
+
+
+// Builds the scene graph: the authored desk plus deskCount copies in a grid behind it (--desks N)
+void UCreateScene(int deskCount)
+{
+    UCreateDesk(glm::vec3(0.0f));
+
+    const float deskSpacingX = 12.0f; // the desk plane is 11 x 10 units
+    const float deskSpacingZ = 11.0f;
+    int columns = deskCount > 0 ? (int)ceil(sqrt((double)deskCount)) : 1;
+    for (int d = 0; d < deskCount; ++d)
+    {
+        int column = d % columns;
+        int row = d / columns + 1;
+        UCreateDesk(glm::vec3((column - (columns - 1) * 0.5f) * deskSpacingX, 0.0f, -row * deskSpacingZ));
+    }
+
+    if (deskCount > 0)
+        cout << "INFO: Office floor: " << deskCount + 1 << " desks, " << gObjects.size() << " objects in "
+            << MESH_COUNT << " instanced draws" << endl;
+}
+
+
+// Recomputes the world boxes of every object and fits the BVH to them; builds it when objects were added
+void UUpdateObjectBounds()
+{
+    gObjectBounds.resize(gObjects.size());
+    for (size_t i = 0; i < gObjects.size(); ++i)
+    {
+        const MeshRange& range = gMesh.ranges[gObjects[i].mesh][0];
+        BoundingBox local;
+        local.minimum = glm::vec3(range.boundsMinimum[0], range.boundsMinimum[1], range.boundsMinimum[2]);
+        local.maximum = glm::vec3(range.boundsMaximum[0], range.boundsMaximum[1], range.boundsMaximum[2]);
+        gObjectBounds[i] = TransformBox(local, gSceneGraph.World(gObjects[i].node));
+    }
+
+    if (gObjectBVH.ObjectCount() != gObjects.size())
+        gObjectBVH.Build(gObjectBounds);
+    else
+        gObjectBVH.Refit(gObjectBounds);
+}
+
+
+// Collects the objects inside the view frustum into gVisibleObjects
+void UCullObjects(const glm::mat4& viewProjection)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    gVisibleObjects.clear();
+    gCullingStats.boxTests = 0;
+    if (gCullingEnabled)
+        gCullingStats.boxTests = gObjectBVH.Cull(Frustum::FromMatrix(viewProjection), gObjectBounds, gVisibleObjects);
+    else
+    {
+        for (uint32_t i = 0; i < (uint32_t)gObjects.size(); ++i)
+            gVisibleObjects.push_back(i);
+    }
+    gCulledViewProjection = viewProjection;
+
+    auto end = std::chrono::steady_clock::now();
+    gCullingStats.milliseconds += std::chrono::duration<double, std::milli>(end - start).count();
+    ++gCullingStats.culls;
+
+    if (gOcclusionEnabled)
+        UOcclusionCull(viewProjection);
+    gCullingStats.visible = gVisibleObjects.size();
+}
+
+
+// Removes the objects of gVisibleObjects hidden behind the nearest occluders
+void UOcclusionCull(const glm::mat4& viewProjection)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    // follow the framebuffer aspect ratio, Resize() rounds up to whole tiles
+    int height = OCCLUSION_BUFFER_WIDTH * gFramebufferHeight / std::max(1, gFramebufferWidth);
+    height = std::max(1, (height + OcclusionBuffer::TileHeight - 1) / OcclusionBuffer::TileHeight) * OcclusionBuffer::TileHeight;
+    if (gOcclusionBuffer.Width() != OCCLUSION_BUFFER_WIDTH || gOcclusionBuffer.Height() != height)
+        gOcclusionBuffer.Resize(OCCLUSION_BUFFER_WIDTH, height);
+
+    // the occluders closest to the camera hide the most
+    std::vector<std::pair<float, uint32_t>> candidates;
+    for (uint32_t object : gVisibleObjects)
+    {
+        if (MESH_OCCLUDERS[gObjects[object].mesh])
+            candidates.push_back({ glm::length(gObjectBounds[object].Center() - gCamera.Position), object });
+    }
+    size_t occluderCount = std::min(candidates.size(), MAX_OCCLUDERS);
+    std::partial_sort(candidates.begin(), candidates.begin() + occluderCount, candidates.end());
+    std::vector<OccluderInstance> occluders(occluderCount);
+    for (size_t i = 0; i < occluderCount; ++i)
+    {
+        const SceneObject& object = gObjects[candidates[i].second];
+        occluders[i] = { &gOccluderMeshes[object.mesh], gSceneGraph.World(object.node) };
+    }
+    gOcclusionBuffer.Render(occluders, viewProjection, *gThreadPool);
+
+    std::vector<uint8_t> visible(gVisibleObjects.size());
+    gThreadPool->ParallelFor(gVisibleObjects.size(), [&](size_t begin, size_t end, unsigned)
+    {
+        for (size_t i = begin; i < end; ++i)
+            visible[i] = gOcclusionBuffer.IsVisible(gObjectBounds[gVisibleObjects[i]]) ? 1 : 0;
+    });
+    size_t kept = 0;
+    for (size_t i = 0; i < gVisibleObjects.size(); ++i)
+    {
+        if (visible[i])
+            gVisibleObjects[kept++] = gVisibleObjects[i];
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    gOcclusionStats.occluders = occluderCount;
+    gOcclusionStats.triangles = gOcclusionBuffer.TriangleCount();
+    gOcclusionStats.tested = gVisibleObjects.size();
+    gOcclusionStats.occluded = gVisibleObjects.size() - kept;
+    gOcclusionStats.milliseconds += std::chrono::duration<double, std::milli>(end - start).count();
+    gVisibleObjects.resize(kept);
+}
+
+
+// Picks the level of detail of every visible object from its projected size
+void USelectLods(const glm::mat4& view, const glm::mat4& projection)
+{
+    for (int lod = 0; lod < MAX_MESH_LODS; ++lod)
+        gLodStats.objects[lod] = 0;
+
+    for (uint32_t index : gVisibleObjects)
+    {
+        SceneObject& object = gObjects[index];
+        int lodCount = gLodEnabled ? gMesh.lodCounts[object.mesh] : 1;
+        int lod = 0;
+        if (lodCount > 1)
+        {
+            float size = ProjectedSize(gObjectBounds[index], view, projection, gFramebufferHeight);
+            lod = SelectLod(object.lod, size, LOD_PIXEL_SIZES, lodCount, LOD_HYSTERESIS);
+        }
+        if (lod != object.lod)
+        {
+            object.lod = lod;
+            ++gLodStats.switches;
+        }
+        ++gLodStats.objects[lod];
+    }
+}
+
+
+// Rebuilds the draw lists from the visible objects, one instanced draw per mesh and level of detail
+void UBuildDrawLists()
+{
+    for (int format = 0; format < VERTEX_FORMAT_COUNT; ++format)
+        gDrawLists[format].Clear();
+
+    // bucket the visible objects by mesh and level of detail, keeping their order
+    std::vector<InstanceData> instances[MESH_COUNT][MAX_MESH_LODS];
+    for (uint32_t index : gVisibleObjects)
+    {
+        const SceneObject& object = gObjects[index];
+        InstanceData instance;
+        instance.model = gSceneGraph.World(object.node);
+        instance.normal = gSceneGraph.Normal(object.node);
+        instance.textureIndex = MESH_TEXTURES[object.mesh];
+        instance.padding[0] = instance.padding[1] = instance.padding[2] = 0;
+        instances[object.mesh][object.lod].push_back(instance);
+    }
+
+    for (int i = 0; i < MESH_COUNT; ++i)
+    {
+        for (int lod = 0; lod < gMesh.lodCounts[i]; ++lod)
+        {
+            if (instances[i][lod].empty())
+                continue;
+            const MeshRange& range = gMesh.ranges[i][lod];
+            gDrawLists[range.format].AddInstances(range, instances[i][lod].data(), (GLuint)instances[i][lod].size());
+        }
+    }
+
+    for (int format = 0; format < VERTEX_FORMAT_COUNT; ++format)
+        gDrawLists[format].Upload();
+}
+
+
+void UDestroyMesh(GLMesh& mesh)
+{
+    for (int format = 0; format < VERTEX_FORMAT_COUNT; ++format)
+        mesh.buffers[format].Destroy();
+}
+
+
+/*Generate and load the texture*/
+// Creates the texture array, or the atlas when layers are not wanted or the array cannot hold every texture,
+// and points the streamer at it
+bool UCreateTextureStorage()
+{
+    GLint maxSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+    if (gTextureLayout == TEXTURE_LAYOUT_ARRAY)
+    {
+        if (gTextureLayerSize > maxSize)
+        {
+            cout << "INFO: Texture layers are at most " << maxSize << "x" << maxSize << " here, clamping --texture-layer-size "
+                << gTextureLayerSize << endl;
+            gTextureLayerSize = maxSize;
+        }
+        if (gTextureArray.Create(gTextureCompression, gTextureLayerSize, gTextureLayerSize, TEXTURE_COUNT))
+        {
+            gTextureStreamer.SetArray(&gTextureArray);
+            cout << "INFO: Textures are " << gTextureLayerSize << "x" << gTextureLayerSize << " layers of one texture array" << endl;
+            return true;
+        }
+        cout << "INFO: Failed to create a texture array of " << TEXTURE_COUNT << " " << gTextureLayerSize << "x" << gTextureLayerSize
+            << " layers, packing textures into an atlas" << endl;
+        gTextureLayout = TEXTURE_LAYOUT_ATLAS;
+    }
+
+    if (maxSize < TEXTURE_ATLAS_WIDTH)
+    {
+        cout << "Failed to create a " << TEXTURE_ATLAS_WIDTH << "x" << TEXTURE_ATLAS_HEIGHT << " texture atlas" << endl;
+        return false;
+    }
+    if (gTextureCompression != TEXTURE_COMPRESSION_NONE)
+    {
+        cout << "INFO: The texture atlas is uncompressed, uploading textures uncompressed" << endl;
+        gTextureCompression = TEXTURE_COMPRESSION_NONE;
+    }
+    gTextureAtlas.Create(TEXTURE_ATLAS_WIDTH, TEXTURE_ATLAS_HEIGHT, TEXTURE_COUNT);
+    gTextureStreamer.SetAtlas(&gTextureAtlas);
+    cout << "INFO: Textures are packed into a " << TEXTURE_ATLAS_WIDTH << "x" << TEXTURE_ATLAS_HEIGHT << " atlas" << endl;
+    return true;
+}
+
+
+// Marks the textures that finished streaming as ready in gTexturesReady; binds nothing, the shader variants
+// pick the bits up the next time they are used. wait first streams everything still queued
+void UApplyStreamedTextures(bool wait)
+{
+    if (gTextureStreamer.Idle())
+        return;
+
+    std::vector<StreamedTexture> finished;
+    if (wait)
+        gTextureStreamer.Finish(finished);
+    else
+        gTextureStreamer.Update(finished);
+    for (const StreamedTexture& streamed : finished)
+    {
+        if (streamed.texture)
+            gTexturesReady |= 1 << streamed.slot; // failures were reported, their objects stay grey
+    }
+    // the variants pick up gTexturesReady and the atlas regions the next time they are used
+
+    if (gTextureStreamer.Idle())
+        cout << "INFO: Streamed " << gTextureStreamer.TexturesStreamed() << " textures (" << gTextureStreamer.TexturesStaged()
+            << " through the staging ring), " << gTextureStreamer.BytesStreamed() / (1024 * 1024) << " MB, longest update "
+            << gTextureStreamer.LongestUpdateMilliseconds() << " ms" << endl;
+    if (gTextureStreamer.Idle() && gTextureLayout == TEXTURE_LAYOUT_ATLAS)
+        cout << "INFO: Texture atlas " << (int)(gTextureAtlas.Occupancy() * 100.0f + 0.5f) << "% occupied" << endl;
+    if (gTextureStreamer.Idle() && gTextureCompression != TEXTURE_COMPRESSION_NONE)
+        cout << "INFO: " << TextureCompressionName(gTextureCompression) << " textures: " << gTextureStreamer.TexturesFromCache()
+            << " read from cache, " << gTextureStreamer.TexturesEncoded() << " encoded" << endl;
+    if (gTextureStreamer.Idle() && gAssetPack.IsOpen())
+        cout << "INFO: " << gTextureStreamer.TexturesMapped() << " textures uploaded from the asset pack mapping" << endl;
+}
+
+
+// Implements the UCreateShaders function
+bool UCreateShaderProgram(const char* vtxShaderSource, const char*
+    fragShaderSource, ShaderProgram& program)
+{
+    auto start = std::chrono::steady_clock::now();
+    // Create a Shader program object.
+    GLuint programId = glCreateProgram();
+    program.Id = programId;
+
+    // A binary saved by an earlier run skips compiling and linking; a stale one leaves the program unlinked
+    uint64_t cacheKey = gProgramCache.Key({ vtxShaderSource, fragShaderSource });
+    if (!gProgramCache.Load(cacheKey, programId))
+    {
+        if (!UCompileShaderProgram(vtxShaderSource, fragShaderSource, programId))
+            return false;
+        if (gProgramCache.IsEnabled() && !gProgramCache.Store(cacheKey, programId))
+            cout << "Failed to save the program binary to " << gProgramCachePath << endl;
+    }
+
+    // Record every active uniform and attribute once, instead of looking them up each frame
+    program.Reflect();
+
+    glUseProgram(programId); // Uses the shader program
+    auto end = std::chrono::steady_clock::now();
+    gProgramBuildMilliseconds += std::chrono::duration<double, std::milli>(end - start).count();
+    return true;
+}
+
+
+// Compiles and links the program from source
+bool UCompileShaderProgram(const char* vtxShaderSource, const char* fragShaderSource, GLuint programId)
+{
+    // Compilation and linkage error reporting
+    int success = 0;
+    char infoLog[512];
+    // Create the vertex and fragment shader objects
+    GLuint vertexShaderId = glCreateShader(GL_VERTEX_SHADER);
+    GLuint fragmentShaderId = glCreateShader(GL_FRAGMENT_SHADER);
+    // Retrive the shader source
+    glShaderSource(vertexShaderId, 1, &vtxShaderSource, NULL);
+    glShaderSource(fragmentShaderId, 1, &fragShaderSource, NULL);
+    // Compile the vertex shader, and print compilation errors (if any)
+    glCompileShader(vertexShaderId); // compile the vertex shader
+    // check for shader compile errors
+    glGetShaderiv(vertexShaderId, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        glGetShaderInfoLog(vertexShaderId, 512, NULL, infoLog);
+        std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog
+            << std::endl;
+        return false;
+    }
+    glCompileShader(fragmentShaderId); // compile the fragment shader
+    // check for shader compile errors
+    glGetShaderiv(fragmentShaderId, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        glGetShaderInfoLog(fragmentShaderId, sizeof(infoLog), NULL, infoLog);
+        std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog
+            << std::endl;
+        return false;
+    }
+    // Attached compiled shaders to the shader program
+    glAttachShader(programId, vertexShaderId);
+    glAttachShader(programId, fragmentShaderId);
+    gProgramCache.PrepareLink(programId);
+    glLinkProgram(programId); // links the shader program
+    // check for linking errors
+    glGetProgramiv(programId, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        glGetProgramInfoLog(programId, sizeof(infoLog), NULL, infoLog);
+        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog <<
+            std::endl;
+        return false;
+    }
+    // Shaders are no longer needed once linked into the program
+    glDetachShader(programId, vertexShaderId);
+    glDetachShader(programId, fragmentShaderId);
+    glDeleteShader(vertexShaderId);
+    glDeleteShader(fragmentShaderId);
+    return true;
+}
+
+
+// Builds one variant of the scene shader: injects the permutation's defines, compiles (or loads from the program
+// cache), resolves the typed uniform handles and checks the shared FrameData layout
+bool UCreateShaderVariant(const ShaderPermutation& permutation, ShaderVariant& variant)
+{
+    std::string defines = permutation.Defines();
+    // the deferred lighting pass draws a full-screen triangle instead of meshes
+    const char* vertexShader = permutation.Has(SHADER_FEATURE_DEFERRED_LIGHTING) ? fullscreenVertexShaderSource : vertexShaderSource;
+    std::string vertexSource = InjectDefines(vertexShader, defines);
+    std::string fragmentSource = InjectDefines(fragmentShaderSource, defines);
+    if (!UCreateShaderProgram(vertexSource.c_str(), fragmentSource.c_str(), variant.program))
+    {
+        cout << "Failed to build the shader variant " << permutation.Name() << endl;
+        UDestroyShaderProgram(variant.program);
+        return false;
+    }
+    variant.permutation = permutation;
+
+    const ShaderProgram& program = variant.program;
+    PhongUniforms& uniforms = variant.uniforms;
+    uniforms.uTextureArray = program.GetUniform<int>("uTextureArray");
+    uniforms.uTextureAtlas = program.GetUniform<int>("uTextureAtlas");
+    uniforms.uAtlasRegions = program.GetUniform<glm::vec4>("uAtlasRegions");
+    uniforms.uTexturesReady = program.GetUniform<int>("uTexturesReady");
+    uniforms.uBaseColor = program.GetUniform<glm::vec4>("uBaseColor");
+    uniforms.uGBufferAlbedo = program.GetUniform<int>("uGBufferAlbedo");
+    uniforms.uGBufferNormal = program.GetUniform<int>("uGBufferNormal");
+    uniforms.uGBufferDepth = program.GetUniform<int>("uGBufferDepth");
+    uniforms.uInverseViewProjection = program.GetUniform<glm::mat4>("uInverseViewProjection");
+    uniforms.uTextureArray.Set(TEXTURE_ARRAY_UNIT);
+    uniforms.uTextureAtlas.Set(TEXTURE_ATLAS_UNIT);
+    uniforms.uBaseColor.Set(glm::vec4(1.0f)); // lamps are white
+    uniforms.uGBufferAlbedo.Set(GBUFFER_FIRST_UNIT);
+    uniforms.uGBufferNormal.Set(GBUFFER_FIRST_UNIT + 1);
+    uniforms.uGBufferDepth.Set(GBUFFER_FIRST_UNIT + 2);
+    return gFrameUniforms.Validate(program, "FrameData");
+}
+
+
+// The variant drawing the scene's meshes stored in format
+ShaderPermutation USceneShaderPermutation(VertexFormat format)
+{
+    unsigned features = SHADER_FEATURE_TEXTURED;
+    if (gSpecularEnabled)
+        features |= SHADER_FEATURE_SPECULAR;
+    if (format == VERTEX_FORMAT_PACKED)
+        features |= SHADER_FEATURE_PACKED_VERTICES;
+    if (gTextureLayout == TEXTURE_LAYOUT_ATLAS)
+        features |= SHADER_FEATURE_TEXTURE_ATLAS;
+    if (gPointLightCount > 0)
+        features |= SHADER_FEATURE_CLUSTERED_LIGHTS;
+    return ShaderPermutation(features, gLightCount);
+}
+
+
+// The variant drawing the lamps stored in format: unlit and untextured
+ShaderPermutation ULampShaderPermutation(VertexFormat format)
+{
+    return ShaderPermutation(format == VERTEX_FORMAT_PACKED ? SHADER_FEATURE_PACKED_VERTICES : 0, 0);
+}
+
+
+// The variant that draws a forward permutation's surfaces with the current renderer: the permutation itself, or
+// its G-buffer variant, which keeps the light count for the normals but leaves the lighting features out
+ShaderPermutation URendererPermutation(const ShaderPermutation& forward)
+{
+    if (gRenderer == RENDERER_FORWARD)
+        return forward;
+    unsigned lightingFeatures = SHADER_FEATURE_SPECULAR | SHADER_FEATURE_CLUSTERED_LIGHTS;
+    return ShaderPermutation((forward.features & ~lightingFeatures) | SHADER_FEATURE_GBUFFER, forward.lightCount);
+}
+
+
+// The full-screen variant lighting the G-buffer, with the lighting features the scene variants would use
+ShaderPermutation UDeferredLightingPermutation()
+{
+    unsigned features = SHADER_FEATURE_DEFERRED_LIGHTING;
+    if (gSpecularEnabled)
+        features |= SHADER_FEATURE_SPECULAR;
+    if (gPointLightCount > 0)
+        features |= SHADER_FEATURE_CLUSTERED_LIGHTS;
+    return ShaderPermutation(features, gLightCount);
+}
+
+
+// Compiles the variants the scene can draw with up front, so the first frames do not stall on the compiler:
+// one per vertex format the meshes use, plus the lamps', plus the lighting pass when deferred. Switching the
+// renderer later builds the other path's variants on first use
+bool UPrepareShaderVariants()
+{
+    gShaderVariants.Create(UCreateShaderVariant, [](ShaderVariant& variant) { UDestroyShaderProgram(variant.program); });
+
+    bool formatUsed[VERTEX_FORMAT_COUNT] = {};
+    for (int mesh = 0; mesh < MESH_COUNT; ++mesh)
+    {
+        for (int lod = 0; lod < gMesh.lodCounts[mesh]; ++lod)
+            formatUsed[gMesh.ranges[mesh][lod].format] = true;
+    }
+    for (int format = 0; format < VERTEX_FORMAT_COUNT; ++format)
+    {
+        if (formatUsed[format] && !gShaderVariants.Get(URendererPermutation(USceneShaderPermutation((VertexFormat)format))))
+            return false;
+    }
+    if (!gShaderVariants.Get(URendererPermutation(ULampShaderPermutation(gMesh.ranges[MESH_PLANE][0].format))))
+        return false;
+    if (gRenderer == RENDERER_DEFERRED && !gShaderVariants.Get(UDeferredLightingPermutation()))
+        return false;
+
+    cout << "INFO: Shader variants:";
+    const char* separator = " ";
+    gShaderVariants.ForEach([&](ShaderVariant& variant)
+    {
+        cout << separator << variant.permutation.Name();
+        separator = "; ";
+    });
+    cout << endl;
+    return true;
+}
+
+
+// Makes the variant for permutation current, building it if the scene had not used it yet, and brings its
+// texture uniforms up to date with the streamer; nullptr when it failed to build
+ShaderVariant* UUseShaderVariant(const ShaderPermutation& permutation)
+{
+    ShaderVariant* variant = gShaderVariants.Get(permutation);
+    if (!variant)
+        return nullptr;
+    variant->program.Use();
+
+    if (permutation.Has(SHADER_FEATURE_TEXTURED) && variant->texturesReady != gTexturesReady)
+    {
+        if (permutation.Has(SHADER_FEATURE_TEXTURE_ATLAS))
+        {
+            // regions are placed as textures arrive
+            glm::vec4 regions[TEXTURE_COUNT];
+            for (int i = 0; i < TEXTURE_COUNT; ++i)
+            {
+                const AtlasRegion& region = gTextureAtlas.Region(i);
+                regions[i] = glm::vec4(region.offset[0], region.offset[1], region.scale[0], region.scale[1]);
+            }
+            variant->uniforms.uAtlasRegions.Set(regions, TEXTURE_COUNT);
+        }
+        variant->uniforms.uTexturesReady.Set(gTexturesReady);
+        variant->texturesReady = gTexturesReady;
+    }
+    return variant;
+}
+
+
+// One lamp per light: the plane mesh shrunk by gLightScale at the light's position, smaller for the fill lights
+void UBuildLampDrawList()
+{
+    const MeshRange& lamp = gMesh.ranges[MESH_PLANE][0];
+    std::vector<InstanceData> instances(gLightCount);
+    for (int light = 0; light < gLightCount; ++light)
+    {
+        InstanceData& instance = instances[light];
+        if (light == 0)
+            instance.model = glm::translate(gLightPosition) * glm::scale(gLightScale);
+        else
+            instance.model = glm::translate(FILL_LIGHT_POSITIONS[light - 1]) * glm::scale(gLightScale * FILL_LAMP_SCALE);
+        ComputeNormalMatrices(&instance.model, &instance.normal, 1);
+        instance.textureIndex = 0;
+        instance.padding[0] = instance.padding[1] = instance.padding[2] = 0;
+    }
+    gLampDrawList.Clear();
+    gLampDrawList.AddInstances(lamp, instances.data(), (GLuint)instances.size());
+    gLampDrawList.Upload();
+}
+
+
+void UDestroyShaderProgram(ShaderProgram& program)
+{
+    glDeleteProgram(program.Id);
+    program.Id = 0;
+}
+
+
+// Lays count point lights over the office floor UCreateScene builds: half of them ceiling lamps on an even
+// grid, the other half desk lamps at scattered spots just above the desks
+void UCreatePointLights(int count, int deskCount)
+{
+    // floor covered by the desks, the same grid as UCreateScene with the authored desk in front
+    const float deskSpacingX = 12.0f;
+    const float deskSpacingZ = 11.0f;
+    int columns = deskCount > 0 ? (int)ceil(sqrt((double)deskCount)) : 1;
+    int rows = (deskCount + columns - 1) / columns;
+    float width = columns * deskSpacingX;
+    float left = -width * 0.5f, front = 5.0f;
+    float depth = rows * deskSpacingZ + 10.0f;
+
+    // fixed seed, so every run lights the floor the same way
+    uint32_t seed = 1;
+    auto random = [&seed]()
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return (seed >> 8) / 16777216.0f;
+    };
+
+    int ceilingCount = (count + 1) / 2;
+    int ceilingColumns = std::max(1, (int)round(sqrt(ceilingCount * width / depth)));
+    int ceilingRows = (ceilingCount + ceilingColumns - 1) / ceilingColumns;
+    std::vector<PointLight> lights(count);
+    for (int i = 0; i < count; ++i)
+    {
+        PointLight& light = lights[i];
+        if (i < ceilingCount)
+        {
+            int column = i % ceilingColumns, row = i / ceilingColumns;
+            glm::vec3 position(left + (column + 0.5f) * width / ceilingColumns, 3.5f, front - (row + 0.5f) * depth / ceilingRows);
+            light.positionRadius = glm::vec4(position, 6.0f);
+            light.color = glm::vec4(0.9f, 0.8f, 0.65f, 1.0f); // warm white
+        }
+        else
+        {
+            glm::vec3 position(left + random() * width, 0.5f + random() * 0.7f, front - random() * depth);
+            light.positionRadius = glm::vec4(position, 2.5f);
+            light.color = glm::vec4(0.2f + 0.4f * random(), 0.2f + 0.4f * random(), 0.2f + 0.4f * random(), 1.0f);
+        }
+    }
+    gLightClusters.SetLights(lights);
+
+    cout << "INFO: Point lights: " << ceilingCount << " ceiling and " << count - ceilingCount << " desk lamps, "
+        << gLightClusterGrid[0] << "x" << gLightClusterGrid[1] << "x" << gLightClusterGrid[2] << " light clusters" << endl;
+}
+
+
+// Switches between forward and deferred shading and reports the render times of the renderer left, so the two
+// can be compared on the same view
+void USwitchRenderer()
+{
+    cout << "INFO: " << (gRenderer == RENDERER_DEFERRED ? "deferred" : "forward") << " shading:" << endl;
+    gRendererTimer.Report(cout);
+    gRenderer = gRenderer == RENDERER_DEFERRED ? RENDERER_FORWARD : RENDERER_DEFERRED;
+    gRendererTimer.Samples.clear();
+    cout << "INFO: Renderer: " << (gRenderer == RENDERER_DEFERRED ? "deferred" : "forward") << " shading" << endl;
+}
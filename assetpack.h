@@ -0,0 +1,296 @@
+#pragma once
+/* Memory-mapped asset pack.
+
+A pack is one binary file holding the scene's assets in the form the GPU
+takes them, so loading is a lookup instead of a decode:
+  header    magic "DPAK", version, entry count, offset of the index
+  payloads  each starting on an ASSET_PACK_ALIGNMENT boundary
+  index     one fixed-size entry per asset (name, offset, size), sorted by
+            name for a binary search
+What a payload holds is up to whoever wrote it: texture levels in the
+texture cache layout (texturecache.h), vertex and index buffers already in
+their final vertex format and index type, and so on.
+
+AssetPack maps the whole file read-only (MapViewOfFile / mmap) and Find()
+returns pointers into the mapping, so loaders hand them straight to
+glBufferData or glTexSubImage2D; no payload is read into a buffer of its
+own, and the OS pages in only what the driver touches. The mapping lives
+until Close(). AssetPackWriter collects payloads in memory and writes the
+file in one go.
+*/
+
+#ifndef ASSETPACK_H
+#define ASSETPACK_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+// Payload alignment inside a pack; enough for SIMD loads and for drivers that copy in cache lines
+const size_t ASSET_PACK_ALIGNMENT = 64;
+
+// A whole file mapped read-only
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { Close(); }
+
+    bool Open(const std::string& path)
+    {
+        Close();
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+        LARGE_INTEGER size;
+        HANDLE mapping = nullptr;
+        if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+            mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping)
+        {
+            mData = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping); // the view keeps the mapping alive
+        }
+        CloseHandle(file);
+        if (!mData)
+            return false;
+        mSize = (size_t)size.QuadPart;
+#else
+        int file = open(path.c_str(), O_RDONLY);
+        if (file < 0)
+            return false;
+        struct stat status;
+        void* data = MAP_FAILED;
+        if (fstat(file, &status) == 0 && status.st_size > 0)
+            data = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+        close(file); // the mapping keeps the file open
+        if (data == MAP_FAILED)
+            return false;
+        mData = (const unsigned char*)data;
+        mSize = (size_t)status.st_size;
+#endif
+        return true;
+    }
+
+    void Close()
+    {
+        if (!mData)
+            return;
+#ifdef _WIN32
+        UnmapViewOfFile(mData);
+#else
+        munmap((void*)mData, mSize);
+#endif
+        mData = nullptr;
+        mSize = 0;
+    }
+
+    const unsigned char* Data() const { return mData; }
+    size_t Size() const { return mSize; }
+
+private:
+    const unsigned char* mData = nullptr;
+    size_t mSize = 0;
+};
+
+namespace assetpack_detail
+{
+    const char PackMagic[4] = { 'D', 'P', 'A', 'K' };
+    const uint32_t PackVersion = 1;
+
+    struct PackHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t entryCount;
+        uint32_t reserved;
+        uint64_t indexOffset;
+    };
+
+    struct PackEntry
+    {
+        char name[48];      // zero-terminated
+        uint64_t offset;    // from the start of the file
+        uint64_t size;
+    };
+
+    inline bool EntryLess(const PackEntry& entry, const char* name)
+    {
+        return strncmp(entry.name, name, sizeof(entry.name)) < 0;
+    }
+}
+
+// A pack file mapped for reading; payload pointers stay valid until Close()
+class AssetPack
+{
+public:
+    // maps the file and checks its index; false when it is missing or not a pack
+    bool Open(const std::string& path)
+    {
+        using namespace assetpack_detail;
+        Close();
+        if (!mFile.Open(path))
+            return false;
+
+        const unsigned char* data = mFile.Data();
+        size_t size = mFile.Size();
+        PackHeader header;
+        bool valid = size >= sizeof(header);
+        if (valid)
+        {
+            memcpy(&header, data, sizeof(header));
+            valid = memcmp(header.magic, PackMagic, 4) == 0 && header.version == PackVersion
+                && header.indexOffset % alignof(PackEntry) == 0 && header.indexOffset <= size
+                && header.entryCount <= (size - header.indexOffset) / sizeof(PackEntry);
+        }
+        if (valid)
+        {
+            mEntries = (const PackEntry*)(data + header.indexOffset);
+            mEntryCount = header.entryCount;
+            for (size_t i = 0; i < mEntryCount && valid; ++i)
+            {
+                const PackEntry& entry = mEntries[i];
+                valid = memchr(entry.name, 0, sizeof(entry.name)) != nullptr
+                    && entry.offset <= size && entry.size <= size - entry.offset
+                    && (i == 0 || EntryLess(mEntries[i - 1], entry.name));
+            }
+        }
+        if (!valid)
+            Close();
+        return valid;
+    }
+
+    void Close()
+    {
+        mFile.Close();
+        mEntries = nullptr;
+        mEntryCount = 0;
+    }
+
+    bool IsOpen() const { return mEntries != nullptr; }
+    size_t EntryCount() const { return mEntryCount; }
+    size_t FileSize() const { return mFile.Size(); }
+
+    // the payload stored under name, inside the mapping; nullptr when the pack has no such entry
+    const unsigned char* Find(const std::string& name, size_t& size) const
+    {
+        using namespace assetpack_detail;
+        const PackEntry* end = mEntries + mEntryCount;
+        const PackEntry* entry = std::lower_bound(mEntries, end, name.c_str(), EntryLess);
+        if (entry == end || strncmp(entry->name, name.c_str(), sizeof(entry->name)) != 0)
+            return nullptr;
+        size = (size_t)entry->size;
+        return mFile.Data() + entry->offset;
+    }
+
+private:
+    MappedFile mFile;
+    const assetpack_detail::PackEntry* mEntries = nullptr;
+    size_t mEntryCount = 0;
+};
+
+// Collects payloads and writes them as a pack
+class AssetPackWriter
+{
+public:
+    // copies the payload; false when the name is too long or already taken
+    bool Add(const std::string& name, const void* data, size_t size)
+    {
+        if (name.empty() || name.size() >= sizeof(assetpack_detail::PackEntry::name))
+            return false;
+        for (const Payload& payload : mPayloads)
+        {
+            if (payload.name == name)
+                return false;
+        }
+        const unsigned char* bytes = (const unsigned char*)data;
+        mPayloads.push_back({ name, std::vector<unsigned char>(bytes, bytes + size) });
+        return true;
+    }
+
+    size_t PayloadCount() const { return mPayloads.size(); }
+
+    bool Write(const std::string& path) const
+    {
+        using namespace assetpack_detail;
+        std::vector<PackEntry> entries(mPayloads.size());
+        uint64_t offset = sizeof(PackHeader);
+        for (size_t i = 0; i < mPayloads.size(); ++i)
+        {
+            offset = Align(offset);
+            memset(&entries[i], 0, sizeof(PackEntry));
+            memcpy(entries[i].name, mPayloads[i].name.c_str(), mPayloads[i].name.size());
+            entries[i].offset = offset;
+            entries[i].size = mPayloads[i].bytes.size();
+            offset += entries[i].size;
+        }
+        std::vector<PackEntry> index(entries);
+        std::sort(index.begin(), index.end(), [](const PackEntry& a, const PackEntry& b) { return EntryLess(a, b.name); });
+
+        PackHeader header = {};
+        memcpy(header.magic, PackMagic, 4);
+        header.version = PackVersion;
+        header.entryCount = (uint32_t)index.size();
+        header.indexOffset = Align(offset);
+
+        FILE* file = fopen(path.c_str(), "wb");
+        if (!file)
+            return false;
+        bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+        uint64_t position = sizeof(header);
+        for (size_t i = 0; i < mPayloads.size() && written; ++i)
+        {
+            written = Pad(file, position, entries[i].offset)
+                && fwrite(mPayloads[i].bytes.data(), 1, mPayloads[i].bytes.size(), file) == mPayloads[i].bytes.size();
+            position = entries[i].offset + entries[i].size;
+        }
+        written = written && Pad(file, position, header.indexOffset)
+            && fwrite(index.data(), sizeof(PackEntry), index.size(), file) == index.size();
+        return fclose(file) == 0 && written;
+    }
+
+private:
+    struct Payload
+    {
+        std::string name;
+        std::vector<unsigned char> bytes;
+    };
+
+    std::vector<Payload> mPayloads;
+
+    static uint64_t Align(uint64_t offset)
+    {
+        return (offset + ASSET_PACK_ALIGNMENT - 1) & ~(uint64_t)(ASSET_PACK_ALIGNMENT - 1);
+    }
+
+    // writes zeros from position up to target
+    static bool Pad(FILE* file, uint64_t position, uint64_t target)
+    {
+        static const unsigned char zeros[ASSET_PACK_ALIGNMENT] = {};
+        size_t count = (size_t)(target - position);
+        return count == 0 || fwrite(zeros, 1, count, file) == count;
+    }
+};
+#endif
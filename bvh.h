@@ -0,0 +1,304 @@
+#pragma once
+/* View-frustum culling over a bounding volume hierarchy.
+
+BoundingBox is an axis aligned box; TransformBox() gives the box enclosing a
+transformed one. Frustum holds the six clip planes of a view-projection
+matrix in structure-of-arrays form, so one SIMD test classifies a box against
+all of them. ObjectBVH is a binary tree over object boxes: Build() sorts the
+objects into it, Refit() only recomputes the node boxes after objects moved,
+and Cull() returns the objects whose boxes touch the frustum. Subtrees fully
+inside the frustum are accepted without testing their children.
+*/
+
+#ifndef BVH_H
+#define BVH_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "simd.h"
+
+
+struct BoundingBox
+{
+    glm::vec3 minimum = glm::vec3(FLT_MAX);
+    glm::vec3 maximum = glm::vec3(-FLT_MAX);
+
+    void Extend(const glm::vec3& point)
+    {
+        minimum = glm::min(minimum, point);
+        maximum = glm::max(maximum, point);
+    }
+
+    void Extend(const BoundingBox& box)
+    {
+        minimum = glm::min(minimum, box.minimum);
+        maximum = glm::max(maximum, box.maximum);
+    }
+
+    glm::vec3 Center() const { return (minimum + maximum) * 0.5f; }
+    glm::vec3 Extent() const { return (maximum - minimum) * 0.5f; }
+};
+
+// Box enclosing box transformed by matrix (Arvo: the extent goes through the absolute 3x3)
+inline BoundingBox TransformBox(const BoundingBox& box, const glm::mat4& matrix)
+{
+    glm::vec3 center = box.Center();
+    glm::vec3 extent = box.Extent();
+    glm::vec3 worldCenter = glm::vec3(matrix * glm::vec4(center, 1.0f));
+    glm::vec3 worldExtent;
+    for (int row = 0; row < 3; ++row)
+        worldExtent[row] = fabsf(matrix[0][row]) * extent.x + fabsf(matrix[1][row]) * extent.y + fabsf(matrix[2][row]) * extent.z;
+
+    BoundingBox result;
+    result.minimum = worldCenter - worldExtent;
+    result.maximum = worldCenter + worldExtent;
+    return result;
+}
+
+
+enum FrustumTest
+{
+    FRUSTUM_OUTSIDE,
+    FRUSTUM_INTERSECTS,
+    FRUSTUM_INSIDE
+};
+
+// The six planes of a view-projection matrix, a point p is inside when dot(n, p) + d >= 0 for all of them
+struct Frustum
+{
+    // SoA, 8 slots so both SSE halves and the AVX register are full; slots 6 and 7 always pass
+    alignas(32) float nx[8];
+    alignas(32) float ny[8];
+    alignas(32) float nz[8];
+    alignas(32) float d[8];
+
+    // Gribb/Hartmann plane extraction for GL clip space (-w <= x, y, z <= w)
+    static Frustum FromMatrix(const glm::mat4& viewProjection)
+    {
+        Frustum frustum;
+        glm::vec4 rows[4];
+        for (int r = 0; r < 4; ++r)
+            rows[r] = glm::vec4(viewProjection[0][r], viewProjection[1][r], viewProjection[2][r], viewProjection[3][r]);
+
+        glm::vec4 planes[6] = { rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1],
+            rows[3] - rows[1], rows[3] + rows[2], rows[3] - rows[2] };
+        for (int p = 0; p < 8; ++p)
+        {
+            glm::vec4 plane = p < 6 ? planes[p] : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+            float length = sqrtf(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+            if (length > 0.0f)
+                plane = plane / length;
+            frustum.nx[p] = plane.x;
+            frustum.ny[p] = plane.y;
+            frustum.nz[p] = plane.z;
+            frustum.d[p] = plane.w;
+        }
+        return frustum;
+    }
+
+    // outside as soon as the box is fully behind one plane, inside when fully in front of all of them
+    FrustumTest Classify(const BoundingBox& box) const
+    {
+        glm::vec3 c = box.Center();
+        glm::vec3 e = box.Extent();
+#if defined(SIMD_AVX2)
+        __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_load_ps(nx), _mm256_set1_ps(c.x)),
+            _mm256_mul_ps(_mm256_load_ps(ny), _mm256_set1_ps(c.y))),
+            _mm256_add_ps(_mm256_mul_ps(_mm256_load_ps(nz), _mm256_set1_ps(c.z)), _mm256_load_ps(d)));
+        const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+        __m256 radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_and_ps(_mm256_load_ps(nx), absMask), _mm256_set1_ps(e.x)),
+            _mm256_mul_ps(_mm256_and_ps(_mm256_load_ps(ny), absMask), _mm256_set1_ps(e.y))),
+            _mm256_mul_ps(_mm256_and_ps(_mm256_load_ps(nz), absMask), _mm256_set1_ps(e.z)));
+        if (_mm256_movemask_ps(_mm256_cmp_ps(_mm256_add_ps(distance, radius), _mm256_setzero_ps(), _CMP_LT_OQ)))
+            return FRUSTUM_OUTSIDE;
+        if (_mm256_movemask_ps(_mm256_cmp_ps(_mm256_sub_ps(distance, radius), _mm256_setzero_ps(), _CMP_LT_OQ)))
+            return FRUSTUM_INTERSECTS;
+        return FRUSTUM_INSIDE;
+#elif defined(SIMD_SSE)
+        const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+        int outside = 0, crossing = 0;
+        for (int half = 0; half < 8; half += 4)
+        {
+            __m128 px = _mm_load_ps(nx + half), py = _mm_load_ps(ny + half), pz = _mm_load_ps(nz + half);
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(c.x)), _mm_mul_ps(py, _mm_set1_ps(c.y))),
+                _mm_add_ps(_mm_mul_ps(pz, _mm_set1_ps(c.z)), _mm_load_ps(d + half)));
+            __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_and_ps(px, absMask), _mm_set1_ps(e.x)),
+                _mm_mul_ps(_mm_and_ps(py, absMask), _mm_set1_ps(e.y))), _mm_mul_ps(_mm_and_ps(pz, absMask), _mm_set1_ps(e.z)));
+            outside |= _mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+            crossing |= _mm_movemask_ps(_mm_cmplt_ps(_mm_sub_ps(distance, radius), _mm_setzero_ps()));
+        }
+        if (outside)
+            return FRUSTUM_OUTSIDE;
+        return crossing ? FRUSTUM_INTERSECTS : FRUSTUM_INSIDE;
+#else
+        bool crossing = false;
+        for (int p = 0; p < 6; ++p)
+        {
+            float distance = nx[p] * c.x + ny[p] * c.y + nz[p] * c.z + d[p];
+            float radius = fabsf(nx[p]) * e.x + fabsf(ny[p]) * e.y + fabsf(nz[p]) * e.z;
+            if (distance + radius < 0.0f)
+                return FRUSTUM_OUTSIDE;
+            if (distance - radius < 0.0f)
+                crossing = true;
+        }
+        return crossing ? FRUSTUM_INTERSECTS : FRUSTUM_INSIDE;
+#endif
+    }
+};
+
+
+// Binary BVH over object bounding boxes, objects are referred to by their index in the boxes array
+class ObjectBVH
+{
+public:
+    static const uint32_t MaxLeafObjects = 4;
+    // deepest level Build() splits to, which bounds Cull()'s stack; median splits of a uint32_t count never get there
+    static const int MaxDepth = 48;
+
+    struct Node
+    {
+        BoundingBox bounds;
+        uint32_t first;     // leaf: first entry in ObjectIndices, inner: index of the right child (left is next)
+        uint32_t count;     // objects in a leaf, 0 for inner nodes
+    };
+
+    std::vector<Node> Nodes;
+    std::vector<uint32_t> ObjectIndices;
+
+    size_t ObjectCount() const { return ObjectIndices.size(); }
+
+    // top-down build, splitting at the median centroid of the longest axis
+    void Build(const std::vector<BoundingBox>& boxes)
+    {
+        Nodes.clear();
+        ObjectIndices.resize(boxes.size());
+        for (uint32_t i = 0; i < (uint32_t)boxes.size(); ++i)
+            ObjectIndices[i] = i;
+        if (boxes.empty())
+            return;
+
+        Nodes.reserve(boxes.size() * 2 / MaxLeafObjects + 1);
+        BuildNode(boxes, 0, (uint32_t)boxes.size(), 0);
+    }
+
+    // recomputes node boxes for moved objects, keeping the tree shape; children always follow their parent
+    void Refit(const std::vector<BoundingBox>& boxes)
+    {
+        for (size_t n = Nodes.size(); n-- > 0;)
+        {
+            Node& node = Nodes[n];
+            node.bounds = BoundingBox();
+            if (node.count > 0)
+            {
+                for (uint32_t i = 0; i < node.count; ++i)
+                    node.bounds.Extend(boxes[ObjectIndices[node.first + i]]);
+            }
+            else
+            {
+                node.bounds.Extend(Nodes[n + 1].bounds);
+                node.bounds.Extend(Nodes[node.first].bounds);
+            }
+        }
+    }
+
+    // appends the indices of objects whose boxes touch the frustum, returns the number of box tests
+    size_t Cull(const Frustum& frustum, const std::vector<BoundingBox>& boxes, std::vector<uint32_t>& visible) const
+    {
+        size_t tests = 0;
+        if (Nodes.empty())
+            return tests;
+
+        // one pending right child per level above the node being visited
+        uint32_t stack[MaxDepth + 1];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0)
+        {
+            uint32_t index = stack[--top];
+            const Node& node = Nodes[index];
+            ++tests;
+            FrustumTest test = frustum.Classify(node.bounds);
+            if (test == FRUSTUM_OUTSIDE)
+                continue;
+            if (test == FRUSTUM_INSIDE)
+            {
+                AppendSubtree(index, visible);
+                continue;
+            }
+
+            if (node.count > 0)
+            {
+                for (uint32_t i = 0; i < node.count; ++i)
+                {
+                    uint32_t object = ObjectIndices[node.first + i];
+                    ++tests;
+                    if (frustum.Classify(boxes[object]) != FRUSTUM_OUTSIDE)
+                        visible.push_back(object);
+                }
+            }
+            else
+            {
+                stack[top++] = node.first;
+                stack[top++] = index + 1;
+            }
+        }
+        return tests;
+    }
+
+private:
+    uint32_t BuildNode(const std::vector<BoundingBox>& boxes, uint32_t first, uint32_t count, int depth)
+    {
+        uint32_t index = (uint32_t)Nodes.size();
+        Nodes.push_back(Node());
+
+        BoundingBox bounds, centroids;
+        for (uint32_t i = first; i < first + count; ++i)
+        {
+            bounds.Extend(boxes[ObjectIndices[i]]);
+            centroids.Extend(boxes[ObjectIndices[i]].Center());
+        }
+        Nodes[index].bounds = bounds;
+
+        glm::vec3 size = centroids.maximum - centroids.minimum;
+        if (count <= MaxLeafObjects || depth == MaxDepth || (size.x <= 0.0f && size.y <= 0.0f && size.z <= 0.0f))
+        {
+            Nodes[index].first = first;
+            Nodes[index].count = count;
+            return index;
+        }
+
+        int axis = size.x >= size.y && size.x >= size.z ? 0 : (size.y >= size.z ? 1 : 2);
+        uint32_t middle = first + count / 2;
+        std::nth_element(ObjectIndices.begin() + first, ObjectIndices.begin() + middle, ObjectIndices.begin() + first + count,
+            [&boxes, axis](uint32_t a, uint32_t b)
+            {
+                return boxes[a].minimum[axis] + boxes[a].maximum[axis] < boxes[b].minimum[axis] + boxes[b].maximum[axis];
+            });
+
+        // the left child is built right after its parent, the right child index is stored
+        BuildNode(boxes, first, middle - first, depth + 1);
+        uint32_t right = BuildNode(boxes, middle, first + count - middle, depth + 1);
+        Nodes[index].first = right;
+        Nodes[index].count = 0;
+        return index;
+    }
+
+    void AppendSubtree(uint32_t index, std::vector<uint32_t>& visible) const
+    {
+        const Node& node = Nodes[index];
+        if (node.count > 0)
+        {
+            visible.insert(visible.end(), ObjectIndices.begin() + node.first, ObjectIndices.begin() + node.first + node.count);
+            return;
+        }
+        AppendSubtree(index + 1, visible);
+        AppendSubtree(node.first, visible);
+    }
+};
+#endif
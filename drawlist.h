@@ -0,0 +1,165 @@
+#pragma once
+/* Indirect draw list: per-draw data (mesh decode parameters) lives in a
+shader storage buffer indexed by gl_DrawIDARB, per-instance data (model
+and normal matrix, texture index) in a second one indexed by
+gl_BaseInstanceARB + gl_InstanceID, and the draws themselves are
+DrawElementsIndirectCommand records submitted with one
+glMultiDrawElementsIndirect call.
+
+A draw of N instances is a single command with instanceCount N, so a mesh
+repeated thousands of times costs one command, not one per copy. Lists whose
+contents never change are built and uploaded once and then only submitted.
+*/
+
+#ifndef DRAWLIST_H
+#define DRAWLIST_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "meshbuffer.h"
+#include "transformbatch.h"
+
+
+// Layout mandated by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+// std430 layout of one entry of the DrawBuffer shader storage block
+struct DrawData
+{
+    glm::vec4 positionOffset;   // xyz, decodes quantized positions (zero for float meshes)
+    glm::vec4 positionScale;    // xyz, one for float meshes
+};
+
+// std430 layout of one entry of the InstanceBuffer shader storage block
+struct InstanceData
+{
+    glm::mat4 model;
+    NormalMatrix normal;    // transpose(inverse(mat3(model))), so the vertex shader does not invert per vertex
+    GLuint textureIndex;
+    GLuint padding[3];
+};
+
+
+class DrawList
+{
+public:
+    GLuint DrawBuffer = 0;      // SSBO of DrawData
+    GLuint InstanceBuffer = 0;  // SSBO of InstanceData
+    GLuint IndirectBuffer = 0;  // GL_DRAW_INDIRECT_BUFFER of commands
+    GLuint Binding = 0;
+    GLuint InstanceBinding = 0;
+
+    std::vector<DrawElementsIndirectCommand> Commands;
+    std::vector<DrawData> Draws;
+    std::vector<InstanceData> Instances;
+
+    void Create(GLuint binding, GLuint instanceBinding)
+    {
+        Binding = binding;
+        InstanceBinding = instanceBinding;
+        glGenBuffers(1, &DrawBuffer);
+        glGenBuffers(1, &InstanceBuffer);
+        glGenBuffers(1, &IndirectBuffer);
+    }
+
+    void Clear()
+    {
+        Commands.clear();
+        Draws.clear();
+        Instances.clear();
+    }
+
+    // queues one draw of a mesh range, returns its draw index (gl_DrawIDARB in the shader)
+    GLuint Add(const MeshRange& range, const glm::mat4& model, GLuint textureIndex)
+    {
+        InstanceData instance;
+        instance.model = model;
+        ComputeNormalMatrices(&model, &instance.normal, 1);
+        instance.textureIndex = textureIndex;
+        instance.padding[0] = instance.padding[1] = instance.padding[2] = 0;
+        return AddInstances(range, &instance, 1);
+    }
+
+    // queues one draw of a mesh range repeated once per instance, returns its draw index
+    GLuint AddInstances(const MeshRange& range, const InstanceData* instances, GLuint instanceCount)
+    {
+        DrawElementsIndirectCommand command;
+        command.count = range.indexCount;
+        command.instanceCount = instanceCount;
+        command.firstIndex = range.firstIndex;
+        command.baseVertex = range.baseVertex;
+        command.baseInstance = (GLuint)Instances.size();  // gl_BaseInstanceARB, where this draw's instances start
+        Commands.push_back(command);
+
+        DrawData draw;
+        draw.positionOffset = glm::vec4(range.positionOffset[0], range.positionOffset[1], range.positionOffset[2], 0.0f);
+        draw.positionScale = glm::vec4(range.positionScale[0], range.positionScale[1], range.positionScale[2], 0.0f);
+        Draws.push_back(draw);
+
+        Instances.insert(Instances.end(), instances, instances + instanceCount);
+
+        return (GLuint)Draws.size() - 1;
+    }
+
+    // copies the queued commands, per-draw and per-instance data to the GPU, growing the buffers when needed
+    void Upload()
+    {
+        UploadBuffer(GL_SHADER_STORAGE_BUFFER, DrawBuffer, mDrawCapacity, Draws.data(), Draws.size() * sizeof(DrawData));
+        UploadBuffer(GL_SHADER_STORAGE_BUFFER, InstanceBuffer, mInstanceCapacity, Instances.data(), Instances.size() * sizeof(InstanceData));
+        UploadBuffer(GL_DRAW_INDIRECT_BUFFER, IndirectBuffer, mCommandCapacity, Commands.data(), Commands.size() * sizeof(DrawElementsIndirectCommand));
+    }
+
+    // submits every queued draw; the mesh buffer's VAO must be bound and indexType match its index buffer
+    void Submit(GLenum indexType) const
+    {
+        if (Commands.empty())
+            return;
+
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, Binding, DrawBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, InstanceBinding, InstanceBuffer);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, IndirectBuffer);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, indexType, 0, (GLsizei)Commands.size(), 0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+
+    void Destroy()
+    {
+        glDeleteBuffers(1, &DrawBuffer);
+        glDeleteBuffers(1, &InstanceBuffer);
+        glDeleteBuffers(1, &IndirectBuffer);
+        DrawBuffer = InstanceBuffer = IndirectBuffer = 0;
+        mDrawCapacity = mInstanceCapacity = mCommandCapacity = 0;
+    }
+
+private:
+    size_t mDrawCapacity = 0;
+    size_t mInstanceCapacity = 0;
+    size_t mCommandCapacity = 0;
+
+    static void UploadBuffer(GLenum target, GLuint buffer, size_t& capacity, const void* data, size_t size)
+    {
+        if (size == 0)
+            return;
+
+        glBindBuffer(target, buffer);
+        if (size > capacity)
+        {
+            // grow geometrically so a scene that keeps adding draws does not reallocate every frame
+            capacity = size * 2;
+            glBufferData(target, capacity, NULL, GL_DYNAMIC_DRAW);
+        }
+        glBufferSubData(target, 0, size, data);
+        glBindBuffer(target, 0);
+    }
+};
+#endif
@@ -0,0 +1,115 @@
+#pragma once
+/* G-buffer for deferred shading.
+
+The geometry pass renders every surface's attributes into three textures of
+one framebuffer, without lighting:
+  albedo  GL_RGBA8, the textured (or base) surface color
+  normal  GL_RGBA16F, xyz the world normal, w 1 for lit surfaces and 0 for
+          unlit ones (the lamps) and the cleared background
+  depth   GL_DEPTH_COMPONENT24, the world position is rebuilt from it with the
+          inverse view-projection matrix
+The lighting pass then reads them back with texelFetch, one fragment per
+pixel of a full-screen triangle. Shading cost follows the pixel count instead
+of how many triangles overlap each pixel.
+
+Resize() reallocates the textures when the framebuffer size changed and
+does nothing otherwise, so it can be called every frame.
+*/
+
+#ifndef GBUFFER_H
+#define GBUFFER_H
+
+#include <GL/glew.h>
+
+#include <iostream>
+
+
+class GBuffer
+{
+public:
+    int Width = 0;
+    int Height = 0;
+    GLuint Fbo = 0;
+    GLuint Albedo = 0;
+    GLuint Normal = 0;
+    GLuint Depth = 0;
+
+    // allocates the targets for a width x height framebuffer; false when the driver cannot render to them
+    bool Resize(int width, int height)
+    {
+        if (Fbo && width == Width && height == Height)
+            return true;
+        Destroy();
+        Width = width;
+        Height = height;
+
+        Albedo = CreateTarget(GL_RGBA8);
+        Normal = CreateTarget(GL_RGBA16F);
+        Depth = CreateTarget(GL_DEPTH_COMPONENT24);
+
+        glGenFramebuffers(1, &Fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, Fbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, Albedo, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, Normal, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, Depth, 0);
+        const GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+        glDrawBuffers(2, drawBuffers);
+
+        bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        if (!complete)
+        {
+            std::cout << "G-buffer framebuffer is incomplete" << std::endl;
+            Destroy();
+            return false;
+        }
+        return true;
+    }
+
+    // binds the framebuffer for the geometry pass and clears it: black albedo, unlit, far depth
+    void BeginGeometryPass() const
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, Fbo);
+        glViewport(0, 0, Width, Height);
+        const GLfloat clear[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        glClearBufferfv(GL_COLOR, 0, clear);
+        glClearBufferfv(GL_COLOR, 1, clear);
+        glClear(GL_DEPTH_BUFFER_BIT);
+    }
+
+    // binds the three textures for the lighting pass, on consecutive units from firstUnit
+    void BindTextures(GLint firstUnit) const
+    {
+        glActiveTexture(GL_TEXTURE0 + firstUnit);
+        glBindTexture(GL_TEXTURE_2D, Albedo);
+        glActiveTexture(GL_TEXTURE0 + firstUnit + 1);
+        glBindTexture(GL_TEXTURE_2D, Normal);
+        glActiveTexture(GL_TEXTURE0 + firstUnit + 2);
+        glBindTexture(GL_TEXTURE_2D, Depth);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    void Destroy()
+    {
+        glDeleteFramebuffers(1, &Fbo);
+        glDeleteTextures(1, &Albedo);
+        glDeleteTextures(1, &Normal);
+        glDeleteTextures(1, &Depth);
+        Fbo = Albedo = Normal = Depth = 0;
+    }
+
+private:
+    GLuint CreateTarget(GLenum format) const
+    {
+        GLuint texture = 0;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexStorage2D(GL_TEXTURE_2D, 1, format, Width, Height);
+        // read with texelFetch only, but a texture without mips must not expect them
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return texture;
+    }
+};
+#endif
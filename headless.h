@@ -0,0 +1,305 @@
+#pragma once
+/* Headless offscreen rendering support.
+
+Creates an OpenGL core context without a window system (EGL on Mesa's
+surfaceless platform, which runs on llvmpipe when no GPU is present) and an
+offscreen framebuffer object of arbitrary size that URender() draws into.
+Also collects per-frame timings and can dump the framebuffer to PPM images.
+*/
+
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <GL/glew.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// EGL is only available on the Linux render nodes; Windows builds keep the GLFW-only path
+#if defined(__linux__)
+#define HEADLESS_SUPPORTED 1
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+
+// A command line flag the application parses itself, so HeadlessOptions::Parse() can tell it from a misspelled one
+struct CommandLineFlag
+{
+    const char* name;
+    bool hasValue;      // the next argument belongs to it
+};
+
+// Command line options that control a headless run
+struct HeadlessOptions
+{
+    bool enabled = false;       // --headless
+    int width = 800;            // --size WxH
+    int height = 600;
+    int frames = 100;           // --frames N
+    std::string dumpPrefix;     // --dump <prefix>, writes <prefix>_NNNN.ppm
+    int dumpEvery = 0;          // --dump-every N, 0 only dumps the final frame
+
+    // parses the headless related arguments and skips the application's own flags (otherFlags); returns false on
+    // malformed input, a flag missing its value or one that is neither
+    bool Parse(int argc, char* argv[], const CommandLineFlag* otherFlags, size_t otherFlagCount)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const char* arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            const CommandLineFlag* other = std::find_if(otherFlags, otherFlags + otherFlagCount,
+                [arg](const CommandLineFlag& flag) { return strcmp(flag.name, arg) == 0; });
+            bool takesValue = strcmp(arg, "--size") == 0 || strcmp(arg, "--frames") == 0 || strcmp(arg, "--dump") == 0
+                || strcmp(arg, "--dump-every") == 0 || (other != otherFlags + otherFlagCount && other->hasValue);
+            if (takesValue && !hasValue)
+            {
+                std::cerr << "Missing value for " << arg << std::endl;
+                return false;
+            }
+
+            if (strcmp(arg, "--headless") == 0)
+                enabled = true;
+            else if (strcmp(arg, "--size") == 0)
+            {
+                if (sscanf(argv[++i], "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0)
+                {
+                    std::cerr << "Invalid --size, expected WIDTHxHEIGHT" << std::endl;
+                    return false;
+                }
+            }
+            else if (strcmp(arg, "--frames") == 0)
+                frames = std::max(1, atoi(argv[++i]));
+            else if (strcmp(arg, "--dump") == 0)
+                dumpPrefix = argv[++i];
+            else if (strcmp(arg, "--dump-every") == 0)
+                dumpEvery = std::max(0, atoi(argv[++i]));
+            else if (other == otherFlags + otherFlagCount)
+            {
+                std::cerr << "Unknown argument " << arg << std::endl;
+                return false;
+            }
+            else if (takesValue)
+                ++i; // the application reads the value itself
+        }
+        return true;
+    }
+
+    // true when the given (zero based) frame should be written to disk
+    bool ShouldDump(int frame) const
+    {
+        if (dumpPrefix.empty())
+            return false;
+        if (dumpEvery > 0)
+            return frame % dumpEvery == 0 || frame == frames - 1;
+        return frame == frames - 1;
+    }
+};
+
+
+// Accumulates per-frame CPU+GPU times and prints a summary
+class FrameTimer
+{
+public:
+    std::vector<double> Samples; // milliseconds, one per frame
+
+    void Add(double milliseconds)
+    {
+        Samples.push_back(milliseconds);
+    }
+
+    // prints the first frame separately since it includes shader compilation and texture upload on llvmpipe
+    void Report(std::ostream& out) const
+    {
+        if (Samples.empty())
+            return;
+
+        out << "INFO: first frame: " << Samples[0] << " ms" << std::endl;
+        if (Samples.size() < 2)
+            return;
+
+        std::vector<double> sorted(Samples.begin() + 1, Samples.end());
+        std::sort(sorted.begin(), sorted.end());
+        double total = 0.0;
+        for (double s : sorted)
+            total += s;
+        double average = total / sorted.size();
+
+        out << "INFO: frames: " << sorted.size()
+            << "  avg: " << average << " ms"
+            << "  min: " << sorted.front() << " ms"
+            << "  median: " << Percentile(sorted, 0.5) << " ms"
+            << "  p95: " << Percentile(sorted, 0.95) << " ms"
+            << "  max: " << sorted.back() << " ms"
+            << "  fps: " << (average > 0.0 ? 1000.0 / average : 0.0) << std::endl;
+    }
+
+private:
+    static double Percentile(const std::vector<double>& sorted, double p)
+    {
+        size_t index = (size_t)(p * (sorted.size() - 1) + 0.5);
+        return sorted[std::min(index, sorted.size() - 1)];
+    }
+};
+
+
+// Window-less GL context plus the offscreen framebuffer the scene is rendered into
+class HeadlessContext
+{
+public:
+    int Width = 0;
+    int Height = 0;
+    GLuint Fbo = 0;
+    GLuint ColorRbo = 0;
+    GLuint DepthRbo = 0;
+
+#ifdef HEADLESS_SUPPORTED
+    EGLDisplay Display = EGL_NO_DISPLAY;
+    EGLContext Context = EGL_NO_CONTEXT;
+#endif
+
+    // creates a 4.4 core context and makes it current, must run before glewInit
+    bool CreateContext()
+    {
+#ifdef HEADLESS_SUPPORTED
+        // prefer the surfaceless platform so no X/Wayland server or DRM node is needed
+        PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+            (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (getPlatformDisplay)
+            Display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+        if (Display == EGL_NO_DISPLAY)
+            Display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+        EGLint major = 0, minor = 0;
+        if (Display == EGL_NO_DISPLAY || !eglInitialize(Display, &major, &minor))
+        {
+            std::cout << "Failed to initialize EGL display" << std::endl;
+            return false;
+        }
+
+        const EGLint configAttribs[] = {
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+            EGL_NONE
+        };
+        EGLConfig config = NULL;
+        EGLint numConfigs = 0;
+        eglChooseConfig(Display, configAttribs, &config, 1, &numConfigs);
+
+        if (!eglBindAPI(EGL_OPENGL_API))
+        {
+            std::cout << "Failed to bind the EGL OpenGL API" << std::endl;
+            return false;
+        }
+
+        const EGLint contextAttribs[] = {
+            EGL_CONTEXT_MAJOR_VERSION, 4,
+            EGL_CONTEXT_MINOR_VERSION, 4,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+        // surfaceless drivers accept a context without any config
+        Context = eglCreateContext(Display, numConfigs > 0 ? config : EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, contextAttribs);
+        if (Context == EGL_NO_CONTEXT)
+        {
+            std::cout << "Failed to create EGL 4.4 core context" << std::endl;
+            return false;
+        }
+
+        if (!eglMakeCurrent(Display, EGL_NO_SURFACE, EGL_NO_SURFACE, Context))
+        {
+            std::cout << "Failed to make EGL context current (EGL_KHR_surfaceless_context required)" << std::endl;
+            return false;
+        }
+
+        std::cout << "INFO: EGL Version: " << major << "." << minor
+            << " (" << eglQueryString(Display, EGL_VENDOR) << ")" << std::endl;
+        return true;
+#else
+        std::cout << "Headless rendering is not supported on this platform" << std::endl;
+        return false;
+#endif
+    }
+
+    // creates the offscreen color+depth targets and leaves them bound
+    bool CreateFramebuffer(int width, int height)
+    {
+        Width = width;
+        Height = height;
+
+        glGenRenderbuffers(1, &ColorRbo);
+        glBindRenderbuffer(GL_RENDERBUFFER, ColorRbo);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+        glGenRenderbuffers(1, &DepthRbo);
+        glBindRenderbuffer(GL_RENDERBUFFER, DepthRbo);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+
+        glGenFramebuffers(1, &Fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, Fbo);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, ColorRbo);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, DepthRbo);
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        {
+            std::cout << "Offscreen framebuffer is incomplete" << std::endl;
+            return false;
+        }
+
+        glViewport(0, 0, width, height);
+        return true;
+    }
+
+    // reads back the color target and writes it as a binary PPM
+    bool SaveFramebuffer(const std::string& filename)
+    {
+        mPixels.resize((size_t)Width * Height * 3);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, Fbo);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, Width, Height, GL_RGB, GL_UNSIGNED_BYTE, mPixels.data());
+
+        FILE* file = fopen(filename.c_str(), "wb");
+        if (!file)
+        {
+            std::cout << "Failed to open " << filename << " for writing" << std::endl;
+            return false;
+        }
+        fprintf(file, "P6\n%d %d\n255\n", Width, Height);
+        // OpenGL rows start at the bottom, image files start at the top
+        size_t rowSize = (size_t)Width * 3;
+        for (int row = Height - 1; row >= 0; --row)
+            fwrite(&mPixels[row * rowSize], 1, rowSize, file);
+        fclose(file);
+        return true;
+    }
+
+    void Destroy()
+    {
+        if (Fbo)
+        {
+            glDeleteFramebuffers(1, &Fbo);
+            glDeleteRenderbuffers(1, &ColorRbo);
+            glDeleteRenderbuffers(1, &DepthRbo);
+            Fbo = ColorRbo = DepthRbo = 0;
+        }
+#ifdef HEADLESS_SUPPORTED
+        if (Display != EGL_NO_DISPLAY)
+        {
+            eglMakeCurrent(Display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            if (Context != EGL_NO_CONTEXT)
+                eglDestroyContext(Display, Context);
+            eglTerminate(Display);
+            Display = EGL_NO_DISPLAY;
+            Context = EGL_NO_CONTEXT;
+        }
+#endif
+    }
+
+private:
+    std::vector<unsigned char> mPixels;
+};
+#endif
@@ -0,0 +1,179 @@
+#pragma once
+/* Row conversions between decoded images and texture uploads.
+
+ConvertImageRows() turns a decoded image (stb_image: RGB or RGBA, top row
+first) into the 4-byte layout the driver wants uploaded, in one pass per
+row that does everything at once:
+  - flips the rows for OpenGL's bottom-up convention
+  - expands RGB to RGBA or BGRA with an opaque alpha
+  - swizzles RGBA sources to BGRA when asked
+  - optionally premultiplies color by alpha for sources that carry one, so
+    filtering and mip reduction do not bleed color out of transparent
+    texels. The product is taken in linear light and encoded back to sRGB,
+    so mipgen.h, which decodes the bytes as sRGB, filters premultiplied
+    linear color with the right weights. Opaque scenes leave it off.
+RGB expansion shuffles four pixels at a time with AVX2 (which implies
+SSSE3) and otherwise builds them from three 32-bit words; RGBA sources are
+swizzled four pixels at a time with SSE2, and premultiplied with a 64 KB
+table of every code and alpha pair.
+*/
+
+#ifndef IMAGEOPS_H
+#define IMAGEOPS_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "simd.h"
+
+
+enum ImageLayout { IMAGE_LAYOUT_RGBA, IMAGE_LAYOUT_BGRA };
+
+namespace imageops_detail
+{
+    inline uint32_t LoadWord(const unsigned char* bytes)
+    {
+        uint32_t word;
+        memcpy(&word, bytes, 4);
+        return word;
+    }
+
+    // swaps the first and third byte of little-endian words
+    inline uint32_t SwapRedBlue(uint32_t pixel)
+    {
+        return (pixel & 0xff00ff00u) | ((pixel & 0xffu) << 16) | ((pixel >> 16) & 0xffu);
+    }
+
+    // sRGB code of the color of code scaled by alpha / 255 in linear light, for every alpha and code
+    struct PremultiplyTable
+    {
+        unsigned char values[256][256];  // [alpha][code]
+
+        PremultiplyTable()
+        {
+            float linear[256];
+            for (int code = 0; code < 256; ++code)
+            {
+                float value = code / 255.0f;
+                linear[code] = value <= 0.04045f ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+            }
+            for (int alpha = 0; alpha < 256; ++alpha)
+            {
+                for (int code = 0; code < 256; ++code)
+                {
+                    float value = linear[code] * alpha / 255.0f;
+                    float encoded = value <= 0.0031308f ? value * 12.92f : 1.055f * powf(value, 1.0f / 2.4f) - 0.055f;
+                    values[alpha][code] = (unsigned char)(encoded * 255.0f + 0.5f);
+                }
+            }
+        }
+    };
+
+    inline const PremultiplyTable& Premultiplied()
+    {
+        static const PremultiplyTable table;
+        return table;
+    }
+
+    inline void ExpandRgbRow(unsigned char* destination, const unsigned char* source, int width, ImageLayout layout)
+    {
+        int x = 0;
+#if defined(SIMD_AVX2)
+        // four pixels per shuffle; a 16-byte load covers 5 1/3 pixels, so stop two short of the end
+        const __m128i shuffle = layout == IMAGE_LAYOUT_BGRA
+            ? _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1)
+            : _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+        const __m128i alpha = _mm_set1_epi32((int)0xff000000u);
+        for (; x + 6 <= width; x += 4)
+        {
+            __m128i rgb = _mm_loadu_si128((const __m128i*)(source + 3 * x));
+            _mm_storeu_si128((__m128i*)(destination + 4 * x), _mm_or_si128(_mm_shuffle_epi8(rgb, shuffle), alpha));
+        }
+#endif
+        // four pixels from three little-endian words
+        for (; x + 4 <= width; x += 4)
+        {
+            uint32_t w0 = LoadWord(source + 3 * x), w1 = LoadWord(source + 3 * x + 4), w2 = LoadWord(source + 3 * x + 8);
+            uint32_t pixels[4] = { w0 | 0xff000000u, (w0 >> 24) | (w1 << 8) | 0xff000000u,
+                (w1 >> 16) | (w2 << 16) | 0xff000000u, (w2 >> 8) | 0xff000000u };
+            for (int i = 0; i < 4; ++i)
+            {
+                uint32_t pixel = layout == IMAGE_LAYOUT_BGRA ? SwapRedBlue(pixels[i]) : pixels[i];
+                memcpy(destination + 4 * (x + i), &pixel, 4);
+            }
+        }
+        for (; x < width; ++x)
+        {
+            const unsigned char* in = source + 3 * (size_t)x;
+            unsigned char* out = destination + 4 * (size_t)x;
+            out[0] = in[layout == IMAGE_LAYOUT_BGRA ? 2 : 0];
+            out[1] = in[1];
+            out[2] = in[layout == IMAGE_LAYOUT_BGRA ? 0 : 2];
+            out[3] = 255;
+        }
+    }
+
+    inline void ConvertRgbaRow(unsigned char* destination, const unsigned char* source, int width, ImageLayout layout, bool premultiplyAlpha)
+    {
+        int x = 0;
+        if (premultiplyAlpha)
+        {
+            const PremultiplyTable& table = Premultiplied();
+            for (; x < width; ++x)
+            {
+                uint32_t pixel = LoadWord(source + 4 * (size_t)x);
+                if (layout == IMAGE_LAYOUT_BGRA)
+                    pixel = SwapRedBlue(pixel);
+                const unsigned char* scale = table.values[pixel >> 24];
+                unsigned char* out = destination + 4 * (size_t)x;
+                out[0] = scale[pixel & 0xff];
+                out[1] = scale[(pixel >> 8) & 0xff];
+                out[2] = scale[(pixel >> 16) & 0xff];
+                out[3] = (unsigned char)(pixel >> 24);
+            }
+            return;
+        }
+        if (layout == IMAGE_LAYOUT_RGBA)
+        {
+            memcpy(destination, source, 4 * (size_t)width);
+            return;
+        }
+#if defined(SIMD_SSE)
+        // two pixels per 16-bit half, red and blue swapped within each
+        const __m128i zero = _mm_setzero_si128();
+        for (; x + 4 <= width; x += 4)
+        {
+            __m128i rgba = _mm_loadu_si128((const __m128i*)(source + 4 * x));
+            __m128i low = _mm_unpacklo_epi8(rgba, zero), high = _mm_unpackhi_epi8(rgba, zero);
+            low = _mm_shufflehi_epi16(_mm_shufflelo_epi16(low, _MM_SHUFFLE(3, 0, 1, 2)), _MM_SHUFFLE(3, 0, 1, 2));
+            high = _mm_shufflehi_epi16(_mm_shufflelo_epi16(high, _MM_SHUFFLE(3, 0, 1, 2)), _MM_SHUFFLE(3, 0, 1, 2));
+            _mm_storeu_si128((__m128i*)(destination + 4 * x), _mm_packus_epi16(low, high));
+        }
+#endif
+        for (; x < width; ++x)
+        {
+            uint32_t pixel = SwapRedBlue(LoadWord(source + 4 * (size_t)x));
+            memcpy(destination + 4 * (size_t)x, &pixel, 4);
+        }
+    }
+}
+
+// Converts a top-down RGB or RGBA image (sourceChannels 3 or 4) into bottom-up 4-byte pixels in the given
+// layout, premultiplying alpha in linear light when asked; destination holds width * height * 4 bytes and must
+// not overlap source
+inline void ConvertImageRows(unsigned char* destination, const unsigned char* source, int width, int height, int sourceChannels, ImageLayout layout,
+    bool premultiplyAlpha)
+{
+    size_t sourceRow = (size_t)width * sourceChannels, destinationRow = (size_t)width * 4;
+    for (int y = 0; y < height; ++y)
+    {
+        const unsigned char* in = source + (size_t)(height - 1 - y) * sourceRow;
+        unsigned char* out = destination + (size_t)y * destinationRow;
+        if (sourceChannels == 3)
+            imageops_detail::ExpandRgbRow(out, in, width, layout);
+        else
+            imageops_detail::ConvertRgbaRow(out, in, width, layout, premultiplyAlpha);
+    }
+}
+#endif
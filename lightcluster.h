@@ -0,0 +1,386 @@
+#pragma once
+/* Clustered point lights for forward shading.
+
+The view frustum is divided into a grid of clusters: tilesX x tilesY screen
+tiles, each cut into depth slices along the view direction. Perspective
+projections slice depth exponentially, so each slice is about as deep as it
+is wide on screen. Orthographic projections slice it evenly. Assign() works
+out which lights reach each cluster, and the fragment shader then loops over
+only its own cluster's lights, not every light in the scene.
+
+A light is a sphere: a position and the radius at which its falloff reaches
+zero. Assignment moves the spheres into view space and finds the slices
+each one spans. Slices are then split across the thread pool. Each slice
+tests the AABB of every one of its clusters against its candidate lights,
+four lights per SSE comparison. The result is three shader storage buffers:
+  lights   PointLight records, in world space (SetLights)
+  ranges   per cluster, the offset and count of its run in indices
+  indices  light indices, each cluster's run in turn
+with cluster = x + tilesX * (y + tilesY * slice). Grid() and Slicing() hold
+the constants the shader needs to find a fragment's cluster.
+
+Cluster bounds depend only on the projection and are recomputed when it
+changes. A 1x1x1 grid puts every light in one cluster, which gives the
+brute-force loop to compare against.
+*/
+
+#ifndef LIGHTCLUSTER_H
+#define LIGHTCLUSTER_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "simd.h"
+#include "threadpool.h"
+
+
+// std430 layout of one entry of the PointLightBuffer shader storage block
+struct PointLight
+{
+    glm::vec4 positionRadius;   // xyz world position, w the distance where the light fades out
+    glm::vec4 color;            // rgb used
+};
+
+struct LightClusterStats
+{
+    size_t references = 0;      // light indices over every cluster
+    size_t occupied = 0;        // clusters reached by at least one light
+    size_t maxPerCluster = 0;
+    size_t passes = 0;
+    double milliseconds = 0.0;  // assignment and upload, every pass
+};
+
+namespace lightcluster_detail
+{
+    // Candidate lights of one slice, structure of arrays padded to a multiple of four
+    struct Candidates
+    {
+        std::vector<float> x, y, z, radiusSquared;
+        std::vector<uint32_t> index;
+
+        void Clear()
+        {
+            x.clear();
+            y.clear();
+            z.clear();
+            radiusSquared.clear();
+            index.clear();
+        }
+
+        void Add(const glm::vec4& sphere, uint32_t light)
+        {
+            x.push_back(sphere.x);
+            y.push_back(sphere.y);
+            z.push_back(sphere.z);
+            radiusSquared.push_back(sphere.w * sphere.w);
+            index.push_back(light);
+        }
+    };
+}
+
+class LightClusters
+{
+public:
+    GLuint LightBuffer = 0;     // SSBO of PointLight
+    GLuint RangeBuffer = 0;     // SSBO of uvec2 offset, count per cluster
+    GLuint IndexBuffer = 0;     // SSBO of uint light indices
+    GLuint LightBinding = 0;
+    GLuint RangeBinding = 0;
+    GLuint IndexBinding = 0;
+
+    void Create(int tilesX, int tilesY, int slices, GLuint lightBinding, GLuint rangeBinding, GLuint indexBinding)
+    {
+        mTilesX = std::max(1, tilesX);
+        mTilesY = std::max(1, tilesY);
+        mSlices = std::max(1, slices);
+        LightBinding = lightBinding;
+        RangeBinding = rangeBinding;
+        IndexBinding = indexBinding;
+        glGenBuffers(1, &LightBuffer);
+        glGenBuffers(1, &RangeBuffer);
+        glGenBuffers(1, &IndexBuffer);
+
+        size_t clusters = ClusterCount();
+        mMinX.resize(clusters);
+        mMinY.resize(clusters);
+        mMinZ.resize(clusters);
+        mMaxX.resize(clusters);
+        mMaxY.resize(clusters);
+        mMaxZ.resize(clusters);
+        mRanges.resize(clusters * 2);
+        mCandidates.resize(mSlices);
+        mSliceIndices.resize(mSlices);
+        mProjection = glm::mat4(0.0f);
+    }
+
+    // copies the lights to their buffer; indices in the cluster lists refer to this order
+    void SetLights(const std::vector<PointLight>& lights)
+    {
+        mLights = lights;
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, LightBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, std::max<size_t>(1, mLights.size()) * sizeof(PointLight),
+            mLights.empty() ? NULL : mLights.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    size_t LightCount() const { return mLights.size(); }
+
+    // rebuilds the cluster light lists for a camera and uploads them; slices are split across pool when given
+    void Assign(const glm::mat4& view, const glm::mat4& projection, ThreadPool* pool)
+    {
+        using namespace lightcluster_detail;
+        auto start = std::chrono::steady_clock::now();
+        if (projection != mProjection)
+            BuildClusterBounds(projection);
+
+        // view space spheres and the slices each one spans
+        mViewSpheres.resize(mLights.size());
+        mFirstSlice.resize(mLights.size());
+        mLastSlice.resize(mLights.size());
+        for (size_t i = 0; i < mLights.size(); ++i)
+        {
+            glm::vec4 center = view * glm::vec4(glm::vec3(mLights[i].positionRadius), 1.0f);
+            float radius = mLights[i].positionRadius.w;
+            mViewSpheres[i] = glm::vec4(glm::vec3(center), radius);
+            mFirstSlice[i] = Slice(-center.z - radius);
+            mLastSlice[i] = Slice(-center.z + radius);
+        }
+
+        auto assignSlices = [&](size_t begin, size_t end, unsigned)
+        {
+            for (size_t slice = begin; slice < end; ++slice)
+                AssignSlice((int)slice);
+        };
+        if (pool)
+            pool->ParallelFor((size_t)mSlices, assignSlices);
+        else
+            assignSlices(0, (size_t)mSlices, 0);
+
+        // rebase each slice's ranges onto the concatenated index list
+        mIndices.clear();
+        mStats.references = mStats.occupied = mStats.maxPerCluster = 0;
+        size_t clustersPerSlice = (size_t)mTilesX * mTilesY;
+        for (int slice = 0; slice < mSlices; ++slice)
+        {
+            uint32_t base = (uint32_t)mIndices.size();
+            for (size_t cluster = slice * clustersPerSlice; cluster < (slice + 1) * clustersPerSlice; ++cluster)
+            {
+                mRanges[cluster * 2] += base;
+                uint32_t count = mRanges[cluster * 2 + 1];
+                mStats.occupied += count > 0 ? 1 : 0;
+                mStats.maxPerCluster = std::max(mStats.maxPerCluster, (size_t)count);
+            }
+            mIndices.insert(mIndices.end(), mSliceIndices[slice].begin(), mSliceIndices[slice].end());
+        }
+        mStats.references = mIndices.size();
+        if (mIndices.empty())
+            mIndices.push_back(0); // keeps the buffer bindable, no range points at it
+
+        UploadBuffer(RangeBuffer, mRangeCapacity, mRanges.data(), mRanges.size() * sizeof(uint32_t));
+        UploadBuffer(IndexBuffer, mIndexCapacity, mIndices.data(), mIndices.size() * sizeof(uint32_t));
+
+        auto end = std::chrono::steady_clock::now();
+        mStats.milliseconds += std::chrono::duration<double, std::milli>(end - start).count();
+        ++mStats.passes;
+    }
+
+    void Bind() const
+    {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LightBinding, LightBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, RangeBinding, RangeBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, IndexBinding, IndexBuffer);
+    }
+
+    // xyz clusters along each axis, w 1 when depth is sliced exponentially
+    glm::uvec4 Grid() const { return glm::uvec4(mTilesX, mTilesY, mSlices, mLogarithmic ? 1 : 0); }
+
+    // xy tiles per pixel of a width x height framebuffer; z, w scale and bias turning view depth (its log when
+    // sliced exponentially) into a slice
+    glm::vec4 Slicing(int width, int height) const
+    {
+        return glm::vec4((float)mTilesX / std::max(1, width), (float)mTilesY / std::max(1, height), mDepthScale, mDepthBias);
+    }
+
+    size_t ClusterCount() const { return (size_t)mTilesX * mTilesY * mSlices; }
+    const LightClusterStats& Stats() const { return mStats; }
+
+    void Destroy()
+    {
+        glDeleteBuffers(1, &LightBuffer);
+        glDeleteBuffers(1, &RangeBuffer);
+        glDeleteBuffers(1, &IndexBuffer);
+        LightBuffer = RangeBuffer = IndexBuffer = 0;
+        mRangeCapacity = mIndexCapacity = 0;
+    }
+
+private:
+    int mTilesX = 1, mTilesY = 1, mSlices = 1;
+    bool mLogarithmic = true;
+    float mDepthScale = 0.0f, mDepthBias = 0.0f;
+    glm::mat4 mProjection;
+    // view space bounds of every cluster, structure of arrays
+    std::vector<float> mMinX, mMinY, mMinZ, mMaxX, mMaxY, mMaxZ;
+
+    std::vector<PointLight> mLights;
+    std::vector<glm::vec4> mViewSpheres;    // xyz view space center, w radius
+    std::vector<int> mFirstSlice, mLastSlice;
+    std::vector<lightcluster_detail::Candidates> mCandidates;   // per slice, reused every pass
+    std::vector<std::vector<uint32_t>> mSliceIndices;           // per slice, before concatenation
+    std::vector<uint32_t> mRanges;  // offset, count per cluster
+    std::vector<uint32_t> mIndices;
+    size_t mRangeCapacity = 0;
+    size_t mIndexCapacity = 0;
+    LightClusterStats mStats;
+
+    int Slice(float depth) const
+    {
+        float slice = mLogarithmic ? logf(std::max(depth, 1e-6f)) * mDepthScale + mDepthBias : depth * mDepthScale + mDepthBias;
+        return (int)std::min(std::max(floorf(slice), 0.0f), (float)(mSlices - 1));
+    }
+
+    void BuildClusterBounds(const glm::mat4& projection)
+    {
+        mProjection = projection;
+        glm::mat4 inverse = glm::inverse(projection);
+        auto unproject = [&](float x, float y, float z)
+        {
+            glm::vec4 point = inverse * glm::vec4(x, y, z, 1.0f);
+            return glm::vec3(point) / point.w;
+        };
+
+        // the near and far planes give the depth range; a perspective projection has no constant w
+        float nearDepth = -unproject(0.0f, 0.0f, -1.0f).z;
+        float farDepth = -unproject(0.0f, 0.0f, 1.0f).z;
+        mLogarithmic = projection[3][3] == 0.0f && nearDepth > 0.0f;
+        if (mLogarithmic)
+        {
+            mDepthScale = mSlices / logf(farDepth / nearDepth);
+            mDepthBias = -logf(nearDepth) * mDepthScale;
+        }
+        else
+        {
+            mDepthScale = mSlices / (farDepth - nearDepth);
+            mDepthBias = -nearDepth * mDepthScale;
+        }
+
+        std::vector<float> sliceDepths(mSlices + 1);
+        for (int slice = 0; slice <= mSlices; ++slice)
+        {
+            float t = (float)slice / mSlices;
+            sliceDepths[slice] = mLogarithmic ? nearDepth * powf(farDepth / nearDepth, t) : nearDepth + (farDepth - nearDepth) * t;
+        }
+
+        for (int y = 0; y < mTilesY; ++y)
+        {
+            for (int x = 0; x < mTilesX; ++x)
+            {
+                // each tile corner is a line from the near to the far plane, z varying linearly along it
+                glm::vec3 nearCorners[4], farCorners[4];
+                for (int corner = 0; corner < 4; ++corner)
+                {
+                    float ndcX = -1.0f + 2.0f * (x + (corner & 1)) / mTilesX;
+                    float ndcY = -1.0f + 2.0f * (y + (corner >> 1)) / mTilesY;
+                    nearCorners[corner] = unproject(ndcX, ndcY, -1.0f);
+                    farCorners[corner] = unproject(ndcX, ndcY, 1.0f);
+                }
+                for (int slice = 0; slice < mSlices; ++slice)
+                {
+                    glm::vec3 minimum(1e30f), maximum(-1e30f);
+                    for (int end = 0; end < 2; ++end)
+                    {
+                        float t = (sliceDepths[slice + end] - nearDepth) / (farDepth - nearDepth);
+                        for (int corner = 0; corner < 4; ++corner)
+                        {
+                            glm::vec3 point = nearCorners[corner] + (farCorners[corner] - nearCorners[corner]) * t;
+                            minimum = glm::min(minimum, point);
+                            maximum = glm::max(maximum, point);
+                        }
+                    }
+                    size_t cluster = x + (size_t)mTilesX * (y + (size_t)mTilesY * slice);
+                    mMinX[cluster] = minimum.x;
+                    mMinY[cluster] = minimum.y;
+                    mMinZ[cluster] = minimum.z;
+                    mMaxX[cluster] = maximum.x;
+                    mMaxY[cluster] = maximum.y;
+                    mMaxZ[cluster] = maximum.z;
+                }
+            }
+        }
+    }
+
+    // tests the lights spanning slice against each of its clusters, filling its ranges and mSliceIndices[slice]
+    void AssignSlice(int slice)
+    {
+        lightcluster_detail::Candidates& candidates = mCandidates[slice];
+        std::vector<uint32_t>& indices = mSliceIndices[slice];
+        candidates.Clear();
+        indices.clear();
+        for (size_t i = 0; i < mLights.size(); ++i)
+        {
+            if (mFirstSlice[i] <= slice && slice <= mLastSlice[i])
+                candidates.Add(mViewSpheres[i], (uint32_t)i);
+        }
+        size_t count = candidates.index.size();
+        while (candidates.index.size() % 4 != 0)
+            candidates.Add(glm::vec4(1e30f, 1e30f, 1e30f, 0.0f), 0); // never inside a cluster
+
+        size_t clustersPerSlice = (size_t)mTilesX * mTilesY;
+        for (size_t cluster = slice * clustersPerSlice; cluster < (slice + 1) * clustersPerSlice; ++cluster)
+        {
+            uint32_t offset = (uint32_t)indices.size();
+            size_t i = 0;
+#if defined(SIMD_SSE)
+            // squared distance from each sphere center to the box, against the squared radius
+            __m128 zero = _mm_setzero_ps();
+            __m128 minX = _mm_set1_ps(mMinX[cluster]), minY = _mm_set1_ps(mMinY[cluster]), minZ = _mm_set1_ps(mMinZ[cluster]);
+            __m128 maxX = _mm_set1_ps(mMaxX[cluster]), maxY = _mm_set1_ps(mMaxY[cluster]), maxZ = _mm_set1_ps(mMaxZ[cluster]);
+            for (; i < count; i += 4)
+            {
+                __m128 x = _mm_loadu_ps(&candidates.x[i]);
+                __m128 y = _mm_loadu_ps(&candidates.y[i]);
+                __m128 z = _mm_loadu_ps(&candidates.z[i]);
+                __m128 dx = _mm_max_ps(zero, _mm_max_ps(_mm_sub_ps(minX, x), _mm_sub_ps(x, maxX)));
+                __m128 dy = _mm_max_ps(zero, _mm_max_ps(_mm_sub_ps(minY, y), _mm_sub_ps(y, maxY)));
+                __m128 dz = _mm_max_ps(zero, _mm_max_ps(_mm_sub_ps(minZ, z), _mm_sub_ps(z, maxZ)));
+                __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+                int hits = _mm_movemask_ps(_mm_cmple_ps(distance, _mm_loadu_ps(&candidates.radiusSquared[i])));
+                for (int lane = 0; hits != 0; ++lane, hits >>= 1)
+                {
+                    if (hits & 1)
+                        indices.push_back(candidates.index[i + lane]);
+                }
+            }
+#endif
+            for (; i < count; ++i)
+            {
+                float dx = std::max(0.0f, std::max(mMinX[cluster] - candidates.x[i], candidates.x[i] - mMaxX[cluster]));
+                float dy = std::max(0.0f, std::max(mMinY[cluster] - candidates.y[i], candidates.y[i] - mMaxY[cluster]));
+                float dz = std::max(0.0f, std::max(mMinZ[cluster] - candidates.z[i], candidates.z[i] - mMaxZ[cluster]));
+                if (dx * dx + dy * dy + dz * dz <= candidates.radiusSquared[i])
+                    indices.push_back(candidates.index[i]);
+            }
+            mRanges[cluster * 2] = offset;
+            mRanges[cluster * 2 + 1] = (uint32_t)indices.size() - offset;
+        }
+    }
+
+    static void UploadBuffer(GLuint buffer, size_t& capacity, const void* data, size_t size)
+    {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+        if (size > capacity)
+        {
+            // grow geometrically so a view that reaches more lights does not reallocate every pass
+            capacity = size * 2;
+            glBufferData(GL_SHADER_STORAGE_BUFFER, capacity, NULL, GL_DYNAMIC_DRAW);
+        }
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, size, data);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+};
+#endif
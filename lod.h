@@ -0,0 +1,46 @@
+#pragma once
+/* Level-of-detail selection by projected size.
+
+ProjectedSize() estimates how many pixels tall an object's bounding sphere
+appears. SelectLod() maps that size to a level, finest first, using the
+smallest size each level is still drawn at. A level only changes once the
+size has moved past the threshold by a hysteresis fraction, so an object
+sitting near a threshold does not pop back and forth as the camera drifts.
+*/
+
+#ifndef LOD_H
+#define LOD_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "bvh.h"
+
+
+// Pixel height of the box's bounding sphere on a viewportHeight tall image; FLT_MAX when the camera is inside it
+inline float ProjectedSize(const BoundingBox& box, const glm::mat4& view, const glm::mat4& projection, int viewportHeight)
+{
+    float radius = glm::length(box.Extent());
+    float viewZ = (view * glm::vec4(box.Center(), 1.0f)).z;
+    // clip w of the center: the distance along the view axis for a perspective projection, 1 for an orthographic one
+    float w = projection[2][3] * viewZ + projection[3][3];
+    if (w <= radius * fabsf(projection[2][3]))
+        return FLT_MAX;
+    return radius * fabsf(projection[1][1]) * viewportHeight / w;
+}
+
+// minimumSizes[i] is the smallest projected size level i is drawn at (lodCount - 1 entries, decreasing);
+// current is the level drawn so far
+inline int SelectLod(int current, float projectedSize, const float* minimumSizes, int lodCount, float hysteresis)
+{
+    int lod = std::max(0, std::min(current, lodCount - 1));
+    while (lod + 1 < lodCount && projectedSize < minimumSizes[lod] * (1.0f - hysteresis))
+        ++lod;
+    while (lod > 0 && projectedSize > minimumSizes[lod - 1] * (1.0f + hysteresis))
+        --lod;
+    return lod;
+}
+#endif
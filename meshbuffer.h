@@ -0,0 +1,190 @@
+#pragma once
+/* Shared geometry storage: every static mesh is suballocated into one vertex
+buffer and one index buffer, described by a single vertex array object.
+A mesh is then just a MeshRange (first index, index count, base vertex) that
+can be drawn with glDrawElementsBaseVertex or a multi-draw-indirect command.
+
+Triangle soups are welded and reordered for vertex cache, overdraw and fetch
+locality on the way in (see meshutil.h), and the index buffer is stored with
+16-bit indices whenever every mesh fits, since indices are relative to each
+mesh's base vertex.
+
+A buffer stores a single VertexFormat (see vertexformat.h); meshes are always
+added as interleaved float position/normal/uv and encoded on the way in.
+*/
+
+#ifndef MESHBUFFER_H
+#define MESHBUFFER_H
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "meshutil.h"
+#include "vertexformat.h"
+
+
+// Location of one mesh inside a MeshBuffer
+struct MeshRange
+{
+    GLuint firstIndex = 0;   // offset into the index buffer, in indices
+    GLuint indexCount = 0;
+    GLint baseVertex = 0;    // added to every index of the mesh
+    GLuint vertexCount = 0;
+    VertexFormat format = VERTEX_FORMAT_FLOAT;
+    float positionOffset[3] = { 0.0f, 0.0f, 0.0f };  // decoded position = offset + stored * scale
+    float positionScale[3] = { 1.0f, 1.0f, 1.0f };
+    float boundsMinimum[3] = { 0.0f, 0.0f, 0.0f };      // object space bounding box, for culling
+    float boundsMaximum[3] = { 0.0f, 0.0f, 0.0f };
+};
+
+
+// One VAO + VBO + EBO holding many meshes of the same vertex format
+class MeshBuffer
+{
+public:
+    static const GLuint FloatsPerVertex = 3;
+    static const GLuint FloatsPerNormal = 3;
+    static const GLuint FloatsPerUV = 2;
+    static const GLuint FloatsPerEntry = FloatsPerVertex + FloatsPerNormal + FloatsPerUV;
+
+    GLuint Vao = 0;
+    GLuint Vbo = 0;
+    GLuint Ebo = 0;
+    VertexFormat Format = VERTEX_FORMAT_FLOAT;
+    GLenum IndexType = GL_UNSIGNED_INT;  // GL_UNSIGNED_SHORT when every mesh has at most 65536 vertices
+
+    // CPU copies in the buffer's format, appended to by Add() and uploaded in one go
+    std::vector<unsigned char> VertexData;
+    std::vector<GLuint> Indices;
+    GLuint VertexCount = 0;
+
+    explicit MeshBuffer(VertexFormat format = VERTEX_FORMAT_FLOAT) : Format(format) {}
+
+    GLuint IndexSize() const { return IndexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint); }
+
+    // appends an indexed float mesh; indices are relative to the mesh's own first vertex
+    MeshRange Add(const GLfloat* vertices, GLuint vertexCount, const GLuint* indices, GLuint indexCount)
+    {
+        MeshRange range;
+        range.firstIndex = (GLuint)Indices.size();
+        range.indexCount = indexCount;
+        range.baseVertex = (GLint)VertexCount;
+        range.vertexCount = vertexCount;
+        range.format = Format;
+        ComputePositionBounds(vertices, vertexCount, FloatsPerEntry, range.boundsMinimum, range.boundsMaximum);
+
+        if (Format == VERTEX_FORMAT_PACKED)
+        {
+            for (int k = 0; k < 3; ++k)
+            {
+                range.positionOffset[k] = range.boundsMinimum[k];
+                range.positionScale[k] = range.boundsMaximum[k] - range.boundsMinimum[k];
+            }
+
+            size_t start = VertexData.size();
+            VertexData.resize(start + (size_t)vertexCount * sizeof(PackedVertex));
+            PackedVertex* packed = (PackedVertex*)&VertexData[start];
+            for (GLuint v = 0; v < vertexCount; ++v)
+                packed[v] = PackVertex(vertices + (size_t)v * FloatsPerEntry, range.positionOffset, range.positionScale);
+        }
+        else
+        {
+            const unsigned char* bytes = (const unsigned char*)vertices;
+            VertexData.insert(VertexData.end(), bytes, bytes + (size_t)vertexCount * FloatsPerEntry * sizeof(GLfloat));
+        }
+
+        VertexCount += vertexCount;
+        Indices.insert(Indices.end(), indices, indices + indexCount);
+        if (vertexCount > mMaxMeshVertices)
+            mMaxMeshVertices = vertexCount;
+        return range;
+    }
+
+    // appends a non-indexed triangle soup, welding identical vertices and optimizing the result first
+    MeshRange Add(const GLfloat* vertices, GLuint vertexCount, MeshOptimizationStats* stats = nullptr)
+    {
+        IndexedMesh welded = WeldVertices(vertices, vertexCount, FloatsPerEntry);
+        OptimizeMesh(welded, FloatsPerVertex, stats);
+        return Add(welded);
+    }
+
+    MeshRange Add(const IndexedMesh& mesh)
+    {
+        return Add(mesh.vertices.data(), mesh.VertexCount(), mesh.indices.data(), (GLuint)mesh.indices.size());
+    }
+
+    bool IsEmpty() const
+    {
+        return Indices.empty();
+    }
+
+    // creates the GL objects for everything added so far
+    void Upload()
+    {
+        std::vector<unsigned char> indexData;
+        GLenum indexType = EncodeIndices(indexData);
+        Upload(VertexData.data(), VertexData.size(), indexData.data(), indexData.size(), indexType);
+    }
+
+    // creates the GL objects from vertices already in Format and indices already encoded, e.g. straight from a mapped
+    // asset pack; the CPU copies stay as they are
+    void Upload(const void* vertexData, size_t vertexBytes, const void* indexData, size_t indexBytes, GLenum indexType)
+    {
+        glGenVertexArrays(1, &Vao);
+        glGenBuffers(1, &Vbo);
+        glGenBuffers(1, &Ebo);
+
+        glBindVertexArray(Vao);
+        glBindBuffer(GL_ARRAY_BUFFER, Vbo);
+        glBufferData(GL_ARRAY_BUFFER, vertexBytes, vertexData, GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, Ebo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes, indexData, GL_STATIC_DRAW);
+        IndexType = indexType;
+
+        SetupVertexAttributes(Format);
+
+        glBindVertexArray(0);
+    }
+
+    // the index buffer as Upload() stores it; returns its type
+    GLenum EncodeIndices(std::vector<unsigned char>& bytes) const
+    {
+        if (mMaxMeshVertices <= 65536)
+        {
+            // per-mesh indices are relative to baseVertex, so 16 bits suffice for the whole buffer
+            std::vector<GLushort> shortIndices(Indices.begin(), Indices.end());
+            const unsigned char* data = (const unsigned char*)shortIndices.data();
+            bytes.assign(data, data + shortIndices.size() * sizeof(GLushort));
+            return GL_UNSIGNED_SHORT;
+        }
+        const unsigned char* data = (const unsigned char*)Indices.data();
+        bytes.assign(data, data + Indices.size() * sizeof(GLuint));
+        return GL_UNSIGNED_INT;
+    }
+
+    void Bind() const
+    {
+        glBindVertexArray(Vao);
+    }
+
+    // draws a single range, used for one-off draws outside the indirect batch
+    void Draw(const MeshRange& range) const
+    {
+        glDrawElementsBaseVertex(GL_TRIANGLES, range.indexCount, IndexType,
+            (void*)((size_t)IndexSize() * range.firstIndex), range.baseVertex);
+    }
+
+    void Destroy()
+    {
+        glDeleteVertexArrays(1, &Vao);
+        glDeleteBuffers(1, &Vbo);
+        glDeleteBuffers(1, &Ebo);
+        Vao = Vbo = Ebo = 0;
+    }
+
+private:
+    GLuint mMaxMeshVertices = 0;
+};
+#endif
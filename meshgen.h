@@ -0,0 +1,215 @@
+#pragma once
+/* Procedural generators for the desk props.
+
+Each generator emits a triangle soup in the float layout MeshBuffer expects
+(position, normal, texture coordinate; 8 floats per vertex), ready for
+UAddMesh() to weld and optimize. The tessellation parameters set the level of
+detail, so one generator yields every LOD of a prop:
+
+  GeneratePencil   prism body (faceted or smooth) with a conical tip
+  GenerateMouse    half-ellipsoid shell over a flat base
+  GenerateKeyboard slab whose top edges are rounded by a bevel
+
+Triangles wind counter-clockwise seen from outside. Zero-area triangles, as
+found at the pole of the mouse shell or on an unbeveled keyboard, are dropped.
+*/
+
+#ifndef MESHGEN_H
+#define MESHGEN_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+
+struct GeneratedVertex
+{
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec2 uv;
+};
+
+inline void AppendVertex(std::vector<float>& out, const GeneratedVertex& vertex)
+{
+    const float data[8] = { vertex.position.x, vertex.position.y, vertex.position.z,
+        vertex.normal.x, vertex.normal.y, vertex.normal.z, vertex.uv.x, vertex.uv.y };
+    out.insert(out.end(), data, data + 8);
+}
+
+inline void AppendTriangle(std::vector<float>& out, const GeneratedVertex& a, const GeneratedVertex& b, const GeneratedVertex& c)
+{
+    glm::vec3 cross = glm::cross(b.position - a.position, c.position - a.position);
+    if (glm::dot(cross, cross) <= 1e-12f)
+        return;
+    AppendVertex(out, a);
+    AppendVertex(out, b);
+    AppendVertex(out, c);
+}
+
+// a, b, c, d counter-clockwise seen from outside
+inline void AppendQuad(std::vector<float>& out, const GeneratedVertex& a, const GeneratedVertex& b, const GeneratedVertex& c, const GeneratedVertex& d)
+{
+    AppendTriangle(out, a, b, c);
+    AppendTriangle(out, a, c, d);
+}
+
+inline glm::vec3 FaceNormal(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+{
+    return glm::normalize(glm::cross(b - a, c - a));
+}
+
+
+// Pencil along +x: a body of the given number of sides from -length/2 to length/2, a cone tip reaching
+// tipLength further and a flat back cap. Smooth sides make a round pencil, faceted ones a hex or square one.
+// Texture u runs along the pencil and v around it.
+inline std::vector<float> GeneratePencil(int sides, bool smooth, float length = 2.0f, float radius = 0.1f, float tipLength = 0.5f)
+{
+    const float twoPi = 6.28318530718f;
+    sides = std::max(sides, 3);
+    float back = -0.5f * length, front = 0.5f * length, total = length + tipLength;
+    glm::vec3 apex(front + tipLength, 0.0f, 0.0f);
+    glm::vec3 backCenter(back, 0.0f, 0.0f);
+
+    std::vector<float> out;
+    for (int s = 0; s < sides; ++s)
+    {
+        float v0 = (float)s / sides, v1 = (float)(s + 1) / sides;
+        glm::vec3 d0(0.0f, cosf(v0 * twoPi), sinf(v0 * twoPi));
+        glm::vec3 d1(0.0f, cosf(v1 * twoPi), sinf(v1 * twoPi));
+        glm::vec3 dMid(0.0f, cosf((v0 + v1) * 0.5f * twoPi), sinf((v0 + v1) * 0.5f * twoPi));
+        glm::vec3 back0 = backCenter + radius * d0, back1 = backCenter + radius * d1;
+        glm::vec3 front0 = back0 + glm::vec3(length, 0.0f, 0.0f), front1 = back1 + glm::vec3(length, 0.0f, 0.0f);
+        float uFront = length / total;
+
+        // body
+        glm::vec3 n0 = smooth ? d0 : dMid, n1 = smooth ? d1 : dMid;
+        AppendQuad(out, { back0, n0, glm::vec2(0.0f, v0) }, { back1, n1, glm::vec2(0.0f, v1) },
+            { front1, n1, glm::vec2(uFront, v1) }, { front0, n0, glm::vec2(uFront, v0) });
+
+        // tip: the cone normal leans forward by radius / tipLength
+        glm::vec3 t0, t1, tApex;
+        if (smooth)
+        {
+            t0 = glm::normalize(glm::vec3(radius, 0.0f, 0.0f) + tipLength * d0);
+            t1 = glm::normalize(glm::vec3(radius, 0.0f, 0.0f) + tipLength * d1);
+            tApex = glm::normalize(glm::vec3(radius, 0.0f, 0.0f) + tipLength * dMid);
+        }
+        else
+            t0 = t1 = tApex = FaceNormal(front0, front1, apex);
+        AppendTriangle(out, { front0, t0, glm::vec2(uFront, v0) }, { front1, t1, glm::vec2(uFront, v1) },
+            { apex, tApex, glm::vec2(1.0f, (v0 + v1) * 0.5f) });
+
+        // back cap
+        glm::vec3 capNormal(-1.0f, 0.0f, 0.0f);
+        AppendTriangle(out, { backCenter, capNormal, glm::vec2(0.0f, 0.5f) }, { back1, capNormal, glm::vec2(0.0f, v1) },
+            { back0, capNormal, glm::vec2(0.0f, v0) });
+    }
+    return out;
+}
+
+
+// Mouse shell: the upper half of an ellipsoid over the footprint x, z in [-0.5, 0.5], height tall, cut into
+// segments around and rings from the base to the top, closed by a flat base facing down.
+// Texture coordinates are projected from above.
+inline std::vector<float> GenerateMouse(int segments, int rings, float height = 1.0f)
+{
+    const float twoPi = 6.28318530718f, halfPi = 1.57079632679f;
+    segments = std::max(segments, 3);
+    rings = std::max(rings, 1);
+
+    auto shell = [&](int ring, int segment)
+    {
+        float elevation = halfPi * ring / rings, azimuth = twoPi * segment / segments;
+        glm::vec3 position(0.5f * cosf(elevation) * cosf(azimuth), height * sinf(elevation), 0.5f * cosf(elevation) * sinf(azimuth));
+        // gradient of the ellipsoid equation
+        glm::vec3 normal = glm::normalize(glm::vec3(position.x / 0.25f, position.y / (height * height), position.z / 0.25f));
+        return GeneratedVertex{ position, normal, glm::vec2(position.x + 0.5f, position.z + 0.5f) };
+    };
+
+    std::vector<float> out;
+    for (int ring = 0; ring < rings; ++ring)
+    {
+        for (int segment = 0; segment < segments; ++segment)
+            AppendQuad(out, shell(ring, segment), shell(ring + 1, segment), shell(ring + 1, segment + 1), shell(ring, segment + 1));
+    }
+
+    GeneratedVertex center{ glm::vec3(0.0f), glm::vec3(0.0f, -1.0f, 0.0f), glm::vec2(0.5f, 0.5f) };
+    for (int segment = 0; segment < segments; ++segment)
+    {
+        GeneratedVertex a = shell(0, segment), b = shell(0, segment + 1);
+        a.normal = b.normal = center.normal;
+        AppendTriangle(out, center, a, b);
+    }
+    return out;
+}
+
+
+// Keyboard slab: width x depth footprint centered on the origin, from y = 0 up to height, with the top edges
+// rounded by a bevel of the given radius in bevelSegments steps (0 gives a plain box).
+// Texture coordinates are projected from above.
+inline std::vector<float> GenerateKeyboard(int bevelSegments, float width = 3.0f, float depth = 6.0f, float height = 0.15f, float bevel = 0.05f)
+{
+    const float halfPi = 1.57079632679f;
+    if (bevelSegments <= 0)
+        bevel = 0.0f;
+    bevelSegments = std::max(bevelSegments, 0);
+    float innerX = 0.5f * width - bevel, innerZ = 0.5f * depth - bevel;
+
+    // outline of the inner rectangle's corners, counter-clockwise from +x toward +z; each corner sweeps a
+    // quarter turn so the rounded edges stay smooth
+    struct OutlinePoint { glm::vec3 corner; glm::vec3 direction; };
+    std::vector<OutlinePoint> outline;
+    const float cornerX[4] = { innerX, -innerX, -innerX, innerX };
+    const float cornerZ[4] = { innerZ, innerZ, -innerZ, -innerZ };
+    int cornerSteps = std::max(bevelSegments, 1);
+    for (int corner = 0; corner < 4; ++corner)
+    {
+        for (int step = 0; step <= cornerSteps; ++step)
+        {
+            float angle = halfPi * (corner + (float)step / cornerSteps);
+            outline.push_back({ glm::vec3(cornerX[corner], 0.0f, cornerZ[corner]), glm::vec3(cosf(angle), 0.0f, sinf(angle)) });
+        }
+    }
+
+    // ring k of the bevel, from the top face (k = 0) down to the vertical sides (k = bevelSegments)
+    auto bevelPoint = [&](int ring, const OutlinePoint& point)
+    {
+        float angle = bevelSegments > 0 ? halfPi * ring / bevelSegments : halfPi;
+        glm::vec3 position = point.corner + point.direction * (bevel * sinf(angle));
+        position.y = height - bevel + bevel * cosf(angle);
+        glm::vec3 normal = point.direction * sinf(angle) + glm::vec3(0.0f, cosf(angle), 0.0f);
+        return GeneratedVertex{ position, normal, glm::vec2(position.x / width + 0.5f, position.z / depth + 0.5f) };
+    };
+
+    std::vector<float> out;
+    size_t count = outline.size();
+    for (size_t q = 0; q < count; ++q)
+    {
+        const OutlinePoint& p0 = outline[q];
+        const OutlinePoint& p1 = outline[(q + 1) % count];
+        for (int ring = 0; ring < bevelSegments; ++ring)
+            AppendQuad(out, bevelPoint(ring, p0), bevelPoint(ring, p1), bevelPoint(ring + 1, p1), bevelPoint(ring + 1, p0));
+
+        // vertical side down to the base
+        GeneratedVertex top0 = bevelPoint(bevelSegments, p0), top1 = bevelPoint(bevelSegments, p1);
+        GeneratedVertex bottom0 = top0, bottom1 = top1;
+        bottom0.position.y = bottom1.position.y = 0.0f;
+        AppendQuad(out, top0, top1, bottom1, bottom0);
+    }
+
+    // top face inside the bevel and the base
+    glm::vec3 up(0.0f, 1.0f, 0.0f), down(0.0f, -1.0f, 0.0f);
+    auto flat = [&](float x, float y, float z, const glm::vec3& normal)
+    {
+        return GeneratedVertex{ glm::vec3(x, y, z), normal, glm::vec2(x / width + 0.5f, z / depth + 0.5f) };
+    };
+    AppendQuad(out, flat(-innerX, height, -innerZ, up), flat(-innerX, height, innerZ, up),
+        flat(innerX, height, innerZ, up), flat(innerX, height, -innerZ, up));
+    float halfWidth = 0.5f * width, halfDepth = 0.5f * depth;
+    AppendQuad(out, flat(-halfWidth, 0.0f, -halfDepth, down), flat(halfWidth, 0.0f, -halfDepth, down),
+        flat(halfWidth, 0.0f, halfDepth, down), flat(-halfWidth, 0.0f, halfDepth, down));
+    return out;
+}
+#endif
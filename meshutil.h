@@ -0,0 +1,408 @@
+#pragma once
+/* CPU-side mesh processing helpers used when meshes are created or imported.
+
+WeldVertices turns a non-indexed triangle soup into a deduplicated vertex
+array plus an index list: vertices whose attributes are bit-identical are
+merged through an open-addressing hash table.
+
+OptimizeMesh then reorders an indexed mesh in three passes:
+  1. triangles for post-transform vertex cache locality (Tipsify, Sander et al. 2007)
+  2. clusters of those triangles, outward facing first, to reduce overdraw
+     (kept only while the cache efficiency stays within a threshold)
+  3. vertices in first-use order for vertex fetch locality
+AnalyzeVertexCache reports ACMR (transformed vertices per triangle) and ATVR
+(transformed vertices per unique vertex) with a FIFO cache model.
+*/
+
+#ifndef MESHUTIL_H
+#define MESHUTIL_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+
+// Result of welding: unique vertices plus the indices that rebuild the original triangles
+struct IndexedMesh
+{
+    std::vector<float> vertices;     // floatsPerVertex floats per unique vertex
+    std::vector<uint32_t> indices;   // one per corner of the original soup
+    uint32_t floatsPerVertex = 0;
+
+    uint32_t VertexCount() const { return floatsPerVertex ? (uint32_t)(vertices.size() / floatsPerVertex) : 0; }
+};
+
+
+// Hashes a vertex's bit pattern; -0.0f is folded into 0.0f so mirrored data still welds
+inline uint32_t HashVertex(const float* vertex, uint32_t floatCount)
+{
+    uint32_t hash = 2166136261u; // FNV-1a
+    for (uint32_t i = 0; i < floatCount; ++i)
+    {
+        float value = vertex[i] == 0.0f ? 0.0f : vertex[i];
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        hash = (hash ^ bits) * 16777619u;
+        hash ^= hash >> 15;
+    }
+    return hash;
+}
+
+inline bool VerticesEqual(const float* a, const float* b, uint32_t floatCount)
+{
+    for (uint32_t i = 0; i < floatCount; ++i)
+    {
+        if (a[i] != b[i]) // 0.0f == -0.0f, matching HashVertex
+            return false;
+    }
+    return true;
+}
+
+
+// Deduplicates identical vertices of a triangle soup (vertexCount corners, floatsPerVertex floats each)
+inline IndexedMesh WeldVertices(const float* soup, uint32_t vertexCount, uint32_t floatsPerVertex)
+{
+    IndexedMesh mesh;
+    mesh.floatsPerVertex = floatsPerVertex;
+    mesh.indices.resize(vertexCount);
+    mesh.vertices.reserve((size_t)vertexCount * floatsPerVertex);
+
+    // power of two table at most half full, slots hold unique vertex index + 1 (0 = empty)
+    uint32_t tableSize = 16;
+    while (tableSize < vertexCount * 2)
+        tableSize <<= 1;
+    std::vector<uint32_t> table(tableSize, 0);
+    uint32_t mask = tableSize - 1;
+
+    for (uint32_t corner = 0; corner < vertexCount; ++corner)
+    {
+        const float* vertex = soup + (size_t)corner * floatsPerVertex;
+        uint32_t slot = HashVertex(vertex, floatsPerVertex) & mask;
+
+        for (;;)
+        {
+            uint32_t entry = table[slot];
+            if (entry == 0)
+            {
+                uint32_t unique = mesh.VertexCount();
+                mesh.vertices.insert(mesh.vertices.end(), vertex, vertex + floatsPerVertex);
+                table[slot] = unique + 1;
+                mesh.indices[corner] = unique;
+                break;
+            }
+            if (VerticesEqual(&mesh.vertices[(size_t)(entry - 1) * floatsPerVertex], vertex, floatsPerVertex))
+            {
+                mesh.indices[corner] = entry - 1;
+                break;
+            }
+            slot = (slot + 1) & mask; // linear probing
+        }
+    }
+
+    mesh.vertices.shrink_to_fit();
+    return mesh;
+}
+
+
+// Vertex cache efficiency of an index list
+struct VertexCacheStats
+{
+    float acmr = 0.0f;  // average cache miss ratio: transformed vertices / triangles, 0.5 is ideal for grids
+    float atvr = 0.0f;  // average transformed vertex ratio: transformed vertices / unique vertices, 1.0 is ideal
+};
+
+// Before/after figures for one OptimizeMesh call
+struct MeshOptimizationStats
+{
+    VertexCacheStats before;
+    VertexCacheStats after;
+    uint32_t clusters = 0;          // triangle clusters considered by the overdraw pass
+    bool overdrawApplied = false;   // false when cluster sorting would have cost too much cache efficiency
+};
+
+
+// Simulates a FIFO post-transform cache of cacheSize entries
+inline VertexCacheStats AnalyzeVertexCache(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize = 16)
+{
+    VertexCacheStats stats;
+    if (indexCount < 3 || vertexCount == 0)
+        return stats;
+
+    // a vertex is in the cache while fewer than cacheSize misses happened since it was loaded
+    std::vector<uint32_t> loadedAt(vertexCount, 0);
+    uint32_t misses = 0;
+
+    for (uint32_t i = 0; i < indexCount; ++i)
+    {
+        uint32_t v = indices[i];
+        if (loadedAt[v] == 0 || misses - loadedAt[v] >= cacheSize)
+        {
+            ++misses;
+            loadedAt[v] = misses;
+        }
+    }
+
+    stats.acmr = (float)misses / (indexCount / 3);
+    stats.atvr = (float)misses / vertexCount;
+    return stats;
+}
+
+
+// Vertex to triangle adjacency in compressed (offset + list) form
+struct TriangleAdjacency
+{
+    std::vector<uint32_t> offsets;     // vertexCount + 1 entries
+    std::vector<uint32_t> triangles;   // triangle ids, grouped by vertex
+
+    TriangleAdjacency(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount)
+        : offsets(vertexCount + 1, 0), triangles(indexCount)
+    {
+        for (uint32_t i = 0; i < indexCount; ++i)
+            ++offsets[indices[i] + 1];
+        for (uint32_t v = 0; v < vertexCount; ++v)
+            offsets[v + 1] += offsets[v];
+
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (uint32_t i = 0; i < indexCount; ++i)
+            triangles[fill[indices[i]]++] = i / 3;
+    }
+};
+
+
+// Tipsify: fans around vertices that stay in a cache of cacheSize entries, in linear time.
+// Writes the reordered triangles to destination and the first triangle of every cluster to clusterStarts.
+inline void OptimizeVertexCacheTipsify(uint32_t* destination, const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount,
+    uint32_t cacheSize, std::vector<uint32_t>& clusterStarts)
+{
+    clusterStarts.clear();
+    uint32_t triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+        return;
+
+    TriangleAdjacency adjacency(indices, indexCount, vertexCount);
+
+    std::vector<uint32_t> liveTriangles(vertexCount);
+    for (uint32_t v = 0; v < vertexCount; ++v)
+        liveTriangles[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> deadEnd;          // recently referenced vertices, a stack
+    std::vector<uint32_t> candidates;
+    deadEnd.reserve(indexCount);
+
+    uint32_t timestamp = cacheSize + 1;
+    uint32_t cursor = 0;                    // next vertex to try when the dead-end stack runs dry
+    uint32_t written = 0;
+    int64_t fanning = 0;
+    bool newCluster = true;
+
+    while (fanning >= 0)
+    {
+        uint32_t f = (uint32_t)fanning;
+        candidates.clear();
+
+        // emit every remaining triangle around the fanning vertex
+        for (uint32_t a = adjacency.offsets[f]; a < adjacency.offsets[f + 1]; ++a)
+        {
+            uint32_t triangle = adjacency.triangles[a];
+            if (emitted[triangle])
+                continue;
+
+            if (newCluster)
+            {
+                clusterStarts.push_back(written / 3);
+                newCluster = false;
+            }
+
+            for (uint32_t corner = 0; corner < 3; ++corner)
+            {
+                uint32_t v = indices[triangle * 3 + corner];
+                destination[written++] = v;
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                --liveTriangles[v];
+                if (timestamp - cacheTime[v] > cacheSize)
+                    cacheTime[v] = timestamp++;
+            }
+            emitted[triangle] = true;
+        }
+
+        // pick the candidate that will still be cached after its remaining triangles are emitted
+        int64_t best = -1;
+        int64_t bestPriority = -1;
+        for (uint32_t v : candidates)
+        {
+            if (liveTriangles[v] == 0)
+                continue;
+            int64_t priority = 0;
+            if ((int64_t)timestamp - cacheTime[v] + 2 * (int64_t)liveTriangles[v] <= (int64_t)cacheSize)
+                priority = (int64_t)timestamp - cacheTime[v];
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                best = v;
+            }
+        }
+
+        if (best < 0)
+        {
+            // dead end: fall back to recently used vertices, then to the input order
+            while (!deadEnd.empty() && best < 0)
+            {
+                uint32_t v = deadEnd.back();
+                deadEnd.pop_back();
+                if (liveTriangles[v] > 0)
+                    best = v;
+            }
+            while (best < 0 && cursor < vertexCount)
+            {
+                if (liveTriangles[cursor] > 0)
+                    best = cursor;
+                ++cursor;
+            }
+            // the cache no longer holds anything useful, which makes this a cluster boundary
+            newCluster = true;
+        }
+        fanning = best;
+    }
+}
+
+
+// Sorts triangle clusters so outward facing ones (seen first from most directions) are drawn first.
+// Uses the mesh's per-vertex normals at normalOffset; positions are at floats 0..2.
+inline void OptimizeOverdraw(uint32_t* destination, const uint32_t* indices, uint32_t indexCount, const float* vertices,
+    uint32_t floatsPerVertex, uint32_t normalOffset, const std::vector<uint32_t>& clusterStarts)
+{
+    uint32_t triangleCount = indexCount / 3;
+    uint32_t clusterCount = (uint32_t)clusterStarts.size();
+
+    // area weighted mesh centroid
+    float meshCentroid[3] = { 0.0f, 0.0f, 0.0f };
+    float meshArea = 0.0f;
+    for (uint32_t t = 0; t < triangleCount; ++t)
+    {
+        const float* p0 = vertices + (size_t)indices[t * 3 + 0] * floatsPerVertex;
+        const float* p1 = vertices + (size_t)indices[t * 3 + 1] * floatsPerVertex;
+        const float* p2 = vertices + (size_t)indices[t * 3 + 2] * floatsPerVertex;
+        float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+        float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+        float cx = e1[1] * e2[2] - e1[2] * e2[1];
+        float cy = e1[2] * e2[0] - e1[0] * e2[2];
+        float cz = e1[0] * e2[1] - e1[1] * e2[0];
+        float area = 0.5f * sqrtf(cx * cx + cy * cy + cz * cz);
+        for (int k = 0; k < 3; ++k)
+            meshCentroid[k] += area * (p0[k] + p1[k] + p2[k]) / 3.0f;
+        meshArea += area;
+    }
+    if (meshArea > 0.0f)
+    {
+        for (int k = 0; k < 3; ++k)
+            meshCentroid[k] /= meshArea;
+    }
+
+    // sort key: how far the cluster's average normal points away from the mesh centre
+    std::vector<float> sortKey(clusterCount);
+    for (uint32_t c = 0; c < clusterCount; ++c)
+    {
+        uint32_t begin = clusterStarts[c];
+        uint32_t end = c + 1 < clusterCount ? clusterStarts[c + 1] : triangleCount;
+        float centroid[3] = { 0.0f, 0.0f, 0.0f };
+        float normal[3] = { 0.0f, 0.0f, 0.0f };
+
+        for (uint32_t i = begin * 3; i < end * 3; ++i)
+        {
+            const float* vertex = vertices + (size_t)indices[i] * floatsPerVertex;
+            for (int k = 0; k < 3; ++k)
+            {
+                centroid[k] += vertex[k];
+                normal[k] += vertex[normalOffset + k];
+            }
+        }
+
+        float corners = (float)((end - begin) * 3);
+        float length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        float key = 0.0f;
+        for (int k = 0; k < 3; ++k)
+            key += (centroid[k] / corners - meshCentroid[k]) * (length > 0.0f ? normal[k] / length : 0.0f);
+        sortKey[c] = key;
+    }
+
+    std::vector<uint32_t> order(clusterCount);
+    for (uint32_t c = 0; c < clusterCount; ++c)
+        order[c] = c;
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKey[a] > sortKey[b]; });
+
+    uint32_t written = 0;
+    for (uint32_t c : order)
+    {
+        uint32_t begin = clusterStarts[c];
+        uint32_t end = c + 1 < clusterCount ? clusterStarts[c + 1] : triangleCount;
+        for (uint32_t i = begin * 3; i < end * 3; ++i)
+            destination[written++] = indices[i];
+    }
+}
+
+
+// Renumbers vertices in the order the index list first touches them, so vertex fetch walks memory linearly
+inline void OptimizeVertexFetch(IndexedMesh& mesh)
+{
+    uint32_t vertexCount = mesh.VertexCount();
+    const uint32_t unused = ~0u;
+    std::vector<uint32_t> remap(vertexCount, unused);
+    std::vector<float> vertices;
+    vertices.reserve(mesh.vertices.size());
+
+    uint32_t next = 0;
+    for (uint32_t& index : mesh.indices)
+    {
+        if (remap[index] == unused)
+        {
+            remap[index] = next++;
+            const float* vertex = &mesh.vertices[(size_t)index * mesh.floatsPerVertex];
+            vertices.insert(vertices.end(), vertex, vertex + mesh.floatsPerVertex);
+        }
+        index = remap[index];
+    }
+
+    // vertices no triangle references are dropped
+    mesh.vertices.swap(vertices);
+}
+
+
+// Runs the cache, overdraw and fetch passes on a welded mesh.
+// overdrawThreshold bounds how much worse than the Tipsify order the ACMR may get (1.05 = 5%).
+inline void OptimizeMesh(IndexedMesh& mesh, uint32_t normalOffset, MeshOptimizationStats* stats = nullptr,
+    uint32_t cacheSize = 16, float overdrawThreshold = 1.05f)
+{
+    uint32_t indexCount = (uint32_t)mesh.indices.size();
+    uint32_t vertexCount = mesh.VertexCount();
+    MeshOptimizationStats result;
+    result.before = AnalyzeVertexCache(mesh.indices.data(), indexCount, vertexCount, cacheSize);
+
+    if (indexCount >= 3)
+    {
+        std::vector<uint32_t> clusterStarts;
+        std::vector<uint32_t> cacheOrder(indexCount);
+        OptimizeVertexCacheTipsify(cacheOrder.data(), mesh.indices.data(), indexCount, vertexCount, cacheSize, clusterStarts);
+        result.clusters = (uint32_t)clusterStarts.size();
+
+        std::vector<uint32_t> overdrawOrder(indexCount);
+        OptimizeOverdraw(overdrawOrder.data(), cacheOrder.data(), indexCount, mesh.vertices.data(),
+            mesh.floatsPerVertex, normalOffset, clusterStarts);
+
+        float cacheAcmr = AnalyzeVertexCache(cacheOrder.data(), indexCount, vertexCount, cacheSize).acmr;
+        float overdrawAcmr = AnalyzeVertexCache(overdrawOrder.data(), indexCount, vertexCount, cacheSize).acmr;
+        result.overdrawApplied = overdrawAcmr <= cacheAcmr * overdrawThreshold;
+        mesh.indices.swap(result.overdrawApplied ? overdrawOrder : cacheOrder);
+
+        OptimizeVertexFetch(mesh);
+    }
+
+    result.after = AnalyzeVertexCache(mesh.indices.data(), indexCount, mesh.VertexCount(), cacheSize);
+    if (stats)
+        *stats = result;
+}
+#endif
@@ -0,0 +1,309 @@
+#pragma once
+/* CPU mip chain generation in linear light.
+
+BuildMipChain() reduces an 8-bit RGBA image level by level, each level
+halving the previous one (rounding down, at least 1), so non-power-of-two
+sizes like 1300x877 follow the same chain glTexStorage2D allocates. Color
+is treated as sRGB: it is decoded to linear floats before filtering and
+encoded again afterwards, so mips keep the brightness of the original
+instead of darkening high-contrast detail. Alpha is filtered as is.
+
+Each reduction is separable, a horizontal then a vertical pass with taps
+that wrap around the edges like GL_REPEAT sampling:
+  MIP_FILTER_BOX      area average; exact for any ratio, so odd sizes
+                      weigh the pixel straddling two outputs half to each
+  MIP_FILTER_KAISER   Kaiser-windowed sinc, radius 3, alpha 4
+  MIP_FILTER_LANCZOS  Lanczos-3 windowed sinc
+Pixels are filtered as one SSE vector each, and the rows of every pass are
+split across the thread pool.
+
+ResampleImage() runs the same filters to bring an image to any size, up or
+down, e.g. to fit the common layer size of a texture array. Upsampling
+stretches the kernel over source pixels instead, so box becomes bilinear.
+*/
+
+#ifndef MIPGEN_H
+#define MIPGEN_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "simd.h"
+#include "threadpool.h"
+
+
+enum MipFilter { MIP_FILTER_BOX, MIP_FILTER_KAISER, MIP_FILTER_LANCZOS };
+
+inline const char* MipFilterName(MipFilter filter)
+{
+    switch (filter)
+    {
+    case MIP_FILTER_BOX: return "box";
+    case MIP_FILTER_KAISER: return "kaiser";
+    default: return "lanczos";
+    }
+}
+
+// One reduced level: 8-bit RGBA, same row order as the image it came from
+struct MipLevel
+{
+    int width = 0, height = 0;
+    std::vector<unsigned char> pixels;
+};
+
+namespace mipgen_detail
+{
+    inline float SrgbToLinear(float value)
+    {
+        return value <= 0.04045f ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+    }
+
+    struct SrgbTables
+    {
+        float toLinear[256];
+        float thresholds[255];   // linear value halfway between consecutive codes
+
+        SrgbTables()
+        {
+            for (int code = 0; code < 256; ++code)
+                toLinear[code] = SrgbToLinear(code / 255.0f);
+            for (int code = 0; code < 255; ++code)
+                thresholds[code] = SrgbToLinear((code + 0.5f) / 255.0f);
+        }
+    };
+
+    inline const SrgbTables& Tables()
+    {
+        static const SrgbTables tables;
+        return tables;
+    }
+
+    inline unsigned char LinearToSrgb(float value)
+    {
+        const float* thresholds = Tables().thresholds;
+        return (unsigned char)(std::upper_bound(thresholds, thresholds + 255, value) - thresholds);
+    }
+
+    inline float Sinc(float x)
+    {
+        const float pi = 3.14159265359f;
+        return fabsf(x) < 1e-5f ? 1.0f : sinf(pi * x) / (pi * x);
+    }
+
+    // modified Bessel function of the first kind, order 0
+    inline float BesselI0(float x)
+    {
+        float sum = 1.0f, term = 1.0f;
+        for (int k = 1; k < 32 && term > sum * 1e-8f; ++k)
+        {
+            term *= (x * 0.5f / k) * (x * 0.5f / k);
+            sum += term;
+        }
+        return sum;
+    }
+
+    // kernel over output pixel units (source units when upsampling); radius is where it reaches zero
+    inline float Radius(MipFilter filter) { return filter == MIP_FILTER_BOX ? 0.5f : 3.0f; }
+
+    inline float Kernel(MipFilter filter, float x)
+    {
+        const float radius = 3.0f, alpha = 4.0f;
+        if (fabsf(x) >= radius)
+            return 0.0f;
+        if (filter == MIP_FILTER_LANCZOS)
+            return Sinc(x) * Sinc(x / radius);
+        float ratio = x / radius;
+        return Sinc(x) * BesselI0(alpha * sqrtf(1.0f - ratio * ratio)) / BesselI0(alpha);
+    }
+
+    // taps of every output pixel along one axis: source index and weight, count per output
+    struct Taps
+    {
+        int perOutput = 0;
+        std::vector<int> indices;
+        std::vector<float> weights;
+    };
+
+    inline void BuildTaps(MipFilter filter, int sourceSize, int outputSize, Taps& taps)
+    {
+        float scale = (float)sourceSize / outputSize;
+        float support = std::max(scale, 1.0f);
+        float reach = Radius(filter) * support;
+        taps.perOutput = (int)ceilf(2.0f * reach) + 1;
+        taps.indices.assign((size_t)outputSize * taps.perOutput, 0);
+        taps.weights.assign((size_t)outputSize * taps.perOutput, 0.0f);
+        for (int output = 0; output < outputSize; ++output)
+        {
+            // output pixel covers [output, output + 1) * scale in source coordinates
+            float center = (output + 0.5f) * scale;
+            int first = (int)floorf(center - reach);
+            float total = 0.0f;
+            int* indices = &taps.indices[(size_t)output * taps.perOutput];
+            float* weights = &taps.weights[(size_t)output * taps.perOutput];
+            for (int tap = 0; tap < taps.perOutput; ++tap)
+            {
+                int source = first + tap;
+                float weight;
+                if (filter == MIP_FILTER_BOX)
+                    weight = std::max(0.0f, std::min((float)source + 1.0f, center + reach) - std::max((float)source, center - reach));
+                else
+                    weight = Kernel(filter, (source + 0.5f - center) / support);
+                indices[tap] = ((source % sourceSize) + sourceSize) % sourceSize;
+                weights[tap] = weight;
+                total += weight;
+            }
+            for (int tap = 0; tap < taps.perOutput; ++tap)
+                weights[tap] /= total;
+        }
+    }
+
+    // output[i] = sum of weights[t] * inputs[t][i] over count floats
+    inline void AccumulateRow(float* output, const float* const* inputs, const float* weights, int taps, size_t count)
+    {
+        size_t i = 0;
+#if defined(SIMD_SSE)
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 sum = _mm_setzero_ps();
+            for (int tap = 0; tap < taps; ++tap)
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[tap]), _mm_loadu_ps(inputs[tap] + i)));
+            _mm_storeu_ps(output + i, sum);
+        }
+#endif
+        for (; i < count; ++i)
+        {
+            float sum = 0.0f;
+            for (int tap = 0; tap < taps; ++tap)
+                sum += weights[tap] * inputs[tap][i];
+            output[i] = sum;
+        }
+    }
+
+    inline void ForRows(ThreadPool* pool, int rows, const std::function<void(size_t, size_t, unsigned)>& body)
+    {
+        if (pool)
+            pool->ParallelFor((size_t)rows, body);
+        else
+            body(0, (size_t)rows, 0);
+    }
+
+    // resamples a linear RGBA float image to outputWidth x outputHeight
+    inline void Reduce(const std::vector<float>& source, int width, int height, int outputWidth, int outputHeight, MipFilter filter,
+        ThreadPool* pool, std::vector<float>& output)
+    {
+        Taps horizontal, vertical;
+        BuildTaps(filter, width, outputWidth, horizontal);
+        BuildTaps(filter, height, outputHeight, vertical);
+
+        std::vector<float> columns((size_t)outputWidth * height * 4);
+        ForRows(pool, height, [&](size_t begin, size_t end, unsigned)
+        {
+            for (size_t y = begin; y < end; ++y)
+            {
+                const float* in = &source[y * width * 4];
+                float* out = &columns[y * outputWidth * 4];
+                for (int x = 0; x < outputWidth; ++x)
+                {
+                    const int* indices = &horizontal.indices[(size_t)x * horizontal.perOutput];
+                    const float* weights = &horizontal.weights[(size_t)x * horizontal.perOutput];
+#if defined(SIMD_SSE)
+                    __m128 sum = _mm_setzero_ps();
+                    for (int tap = 0; tap < horizontal.perOutput; ++tap)
+                        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[tap]), _mm_loadu_ps(in + indices[tap] * 4)));
+                    _mm_storeu_ps(out + x * 4, sum);
+#else
+                    for (int k = 0; k < 4; ++k)
+                    {
+                        float sum = 0.0f;
+                        for (int tap = 0; tap < horizontal.perOutput; ++tap)
+                            sum += weights[tap] * in[indices[tap] * 4 + k];
+                        out[x * 4 + k] = sum;
+                    }
+#endif
+                }
+            }
+        });
+
+        output.resize((size_t)outputWidth * outputHeight * 4);
+        ForRows(pool, outputHeight, [&](size_t begin, size_t end, unsigned)
+        {
+            std::vector<const float*> inputs(vertical.perOutput);
+            for (size_t y = begin; y < end; ++y)
+            {
+                for (int tap = 0; tap < vertical.perOutput; ++tap)
+                    inputs[tap] = &columns[(size_t)vertical.indices[y * vertical.perOutput + tap] * outputWidth * 4];
+                AccumulateRow(&output[y * outputWidth * 4], inputs.data(), &vertical.weights[y * vertical.perOutput],
+                    vertical.perOutput, (size_t)outputWidth * 4);
+            }
+        });
+    }
+
+    inline void DecodeImage(const unsigned char* rgba, int width, int height, ThreadPool* pool, std::vector<float>& image)
+    {
+        const SrgbTables& tables = Tables();
+        image.resize((size_t)width * height * 4);
+        ForRows(pool, height, [&](size_t begin, size_t end, unsigned)
+        {
+            for (size_t i = begin * width * 4; i < end * width * 4; i += 4)
+            {
+                for (int k = 0; k < 3; ++k)
+                    image[i + k] = tables.toLinear[rgba[i + k]];
+                image[i + 3] = rgba[i + 3] / 255.0f;
+            }
+        });
+    }
+
+    inline void EncodeImage(const std::vector<float>& image, int width, int height, ThreadPool* pool, unsigned char* rgba)
+    {
+        ForRows(pool, height, [&](size_t begin, size_t end, unsigned)
+        {
+            for (size_t i = begin * width * 4; i < end * width * 4; i += 4)
+            {
+                // windowed sincs ring past the input range
+                for (int k = 0; k < 3; ++k)
+                    rgba[i + k] = LinearToSrgb(image[i + k]);
+                rgba[i + 3] = (unsigned char)(std::min(1.0f, std::max(0.0f, image[i + 3])) * 255.0f + 0.5f);
+            }
+        });
+    }
+}
+
+// Builds every level below an RGBA image down to 1x1; levels[i] is mip level i + 1
+inline void BuildMipChain(const unsigned char* rgba, int width, int height, MipFilter filter, ThreadPool* pool, std::vector<MipLevel>& levels)
+{
+    using namespace mipgen_detail;
+    levels.clear();
+
+    std::vector<float> current, next;
+    DecodeImage(rgba, width, height, pool, current);
+    while (width > 1 || height > 1)
+    {
+        int outputWidth = std::max(1, width / 2), outputHeight = std::max(1, height / 2);
+        Reduce(current, width, height, outputWidth, outputHeight, filter, pool, next);
+
+        levels.emplace_back();
+        MipLevel& level = levels.back();
+        level.width = outputWidth;
+        level.height = outputHeight;
+        level.pixels.resize((size_t)outputWidth * outputHeight * 4);
+        EncodeImage(next, outputWidth, outputHeight, pool, level.pixels.data());
+
+        current.swap(next);
+        width = outputWidth;
+        height = outputHeight;
+    }
+}
+
+// Resizes an RGBA image to outputWidth x outputHeight in linear light; output is resized to fit
+inline void ResampleImage(const unsigned char* rgba, int width, int height, int outputWidth, int outputHeight, MipFilter filter,
+    ThreadPool* pool, std::vector<unsigned char>& output)
+{
+    using namespace mipgen_detail;
+    std::vector<float> image, resampled;
+    DecodeImage(rgba, width, height, pool, image);
+    Reduce(image, width, height, outputWidth, outputHeight, filter, pool, resampled);
+    output.resize((size_t)outputWidth * outputHeight * 4);
+    EncodeImage(resampled, outputWidth, outputHeight, pool, output.data());
+}
+#endif
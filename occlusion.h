@@ -0,0 +1,316 @@
+#pragma once
+/* Software occlusion culling on the CPU.
+
+A small depth buffer (a few hundred pixels wide) is filled each time the view
+changes with the triangles of a handful of large, nearby occluders; the
+bounding boxes of the other objects are then tested against it before their
+draws are submitted. The buffer is split into 8x4 pixel tiles that keep the
+farthest depth they hold, so most box tests settle a whole tile with one
+compare and only touch pixels where the box is close to an occluder, in the
+spirit of masked occlusion culling.
+
+Rasterization evaluates the triangle edge functions and the depth plane for 8
+(AVX2) or 4 (SSE) pixels at once. Work is split over a ThreadPool: occluder
+transformation by object, rasterization by horizontal band of tile rows so
+threads never write the same pixels, and box tests by object.
+
+Occluders are rasterized at pixel centers, so an object seen only through a
+gap narrower than one buffer pixel may be culled; the buffer resolution
+trades that error against speed.
+*/
+
+#ifndef OCCLUSION_H
+#define OCCLUSION_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "bvh.h"
+#include "simd.h"
+#include "threadpool.h"
+
+
+// CPU copy of an occluder's triangles in object space
+struct OccluderMesh
+{
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+};
+
+struct OccluderInstance
+{
+    const OccluderMesh* mesh;
+    glm::mat4 world;
+};
+
+
+class OcclusionBuffer
+{
+public:
+    static const int TileWidth = 8;
+    static const int TileHeight = 4;
+
+    // width and height are rounded up to whole tiles
+    void Resize(int width, int height)
+    {
+        mTilesX = std::max(1, (width + TileWidth - 1) / TileWidth);
+        mTilesY = std::max(1, (height + TileHeight - 1) / TileHeight);
+        mWidth = mTilesX * TileWidth;
+        mHeight = mTilesY * TileHeight;
+        mDepth.assign((size_t)mWidth * mHeight, 1.0f);
+        mTileMax.assign((size_t)mTilesX * mTilesY, 1.0f);
+    }
+
+    int Width() const { return mWidth; }
+    int Height() const { return mHeight; }
+    size_t TriangleCount() const { return mTriangles.size(); }
+
+    // clears the buffer and rasterizes the occluders as seen through viewProjection
+    void Render(const std::vector<OccluderInstance>& occluders, const glm::mat4& viewProjection, ThreadPool& pool)
+    {
+        mViewProjection = viewProjection;
+
+        // transform and clip, one triangle list per chunk so the threads never share a vector
+        std::vector<std::vector<ScreenTriangle>> chunks(pool.ThreadCount());
+        pool.ParallelFor(occluders.size(), [&](size_t begin, size_t end, unsigned chunk)
+        {
+            chunks[chunk].clear();
+            for (size_t i = begin; i < end; ++i)
+                SetupTriangles(occluders[i], chunks[chunk]);
+        });
+        mTriangles.clear();
+        for (const std::vector<ScreenTriangle>& chunk : chunks)
+            mTriangles.insert(mTriangles.end(), chunk.begin(), chunk.end());
+
+        // every thread owns a band of tile rows
+        pool.ParallelFor((size_t)mTilesY, [&](size_t begin, size_t end, unsigned)
+        {
+            int yBegin = (int)begin * TileHeight;
+            int yEnd = (int)end * TileHeight;
+            std::fill(mDepth.begin() + (size_t)yBegin * mWidth, mDepth.begin() + (size_t)yEnd * mWidth, 1.0f);
+            for (const ScreenTriangle& triangle : mTriangles)
+                RasterizeTriangle(triangle, yBegin, yEnd);
+            UpdateTileMax((int)begin, (int)end);
+        });
+    }
+
+    // false when every pixel the box covers lies behind an occluder
+    bool IsVisible(const BoundingBox& box) const
+    {
+        float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX, minZ = FLT_MAX;
+        for (int corner = 0; corner < 8; ++corner)
+        {
+            glm::vec4 p(corner & 1 ? box.maximum.x : box.minimum.x, corner & 2 ? box.maximum.y : box.minimum.y,
+                corner & 4 ? box.maximum.z : box.minimum.z, 1.0f);
+            glm::vec4 clip = mViewProjection * p;
+            if (clip.z < -clip.w || clip.w <= 0.0f)
+                return true; // crosses the near plane, the box is around the camera
+            float x = (clip.x / clip.w * 0.5f + 0.5f) * mWidth;
+            float y = (clip.y / clip.w * 0.5f + 0.5f) * mHeight;
+            minX = std::min(minX, x);
+            maxX = std::max(maxX, x);
+            minY = std::min(minY, y);
+            maxY = std::max(maxY, y);
+            minZ = std::min(minZ, clip.z / clip.w * 0.5f + 0.5f);
+        }
+
+        int x0 = std::max(0, (int)floorf(minX));
+        int x1 = std::min(mWidth - 1, (int)ceilf(maxX));
+        int y0 = std::max(0, (int)floorf(minY));
+        int y1 = std::min(mHeight - 1, (int)ceilf(maxY));
+        if (x0 > x1 || y0 > y1)
+            return true;
+
+        for (int tileY = y0 / TileHeight; tileY <= y1 / TileHeight; ++tileY)
+        {
+            for (int tileX = x0 / TileWidth; tileX <= x1 / TileWidth; ++tileX)
+            {
+                // the whole tile is nearer than the box
+                if (mTileMax[(size_t)tileY * mTilesX + tileX] < minZ)
+                    continue;
+
+                int rowBegin = std::max(y0, tileY * TileHeight), rowEnd = std::min(y1, tileY * TileHeight + TileHeight - 1);
+                int columnBegin = std::max(x0, tileX * TileWidth), columnEnd = std::min(x1, tileX * TileWidth + TileWidth - 1);
+                for (int y = rowBegin; y <= rowEnd; ++y)
+                {
+                    const float* row = &mDepth[(size_t)y * mWidth];
+                    for (int x = columnBegin; x <= columnEnd; ++x)
+                    {
+                        if (row[x] >= minZ)
+                            return true;
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+private:
+    struct ScreenTriangle
+    {
+        float x[3], y[3], z[3];  // pixels, pixels, depth 0..1
+    };
+
+    int mWidth = 0, mHeight = 0, mTilesX = 0, mTilesY = 0;
+    std::vector<float> mDepth;      // row major, 1 = far
+    std::vector<float> mTileMax;    // farthest depth in each tile
+    std::vector<ScreenTriangle> mTriangles;
+    glm::mat4 mViewProjection = glm::mat4(1.0f);
+
+    // clips the instance's triangles against the near plane (z >= -w) and projects them to the buffer
+    void SetupTriangles(const OccluderInstance& occluder, std::vector<ScreenTriangle>& out) const
+    {
+        glm::mat4 mvp = mViewProjection * occluder.world;
+        const std::vector<uint32_t>& indices = occluder.mesh->indices;
+        for (size_t t = 0; t + 2 < indices.size(); t += 3)
+        {
+            glm::vec4 clip[3];
+            for (int k = 0; k < 3; ++k)
+                clip[k] = mvp * glm::vec4(occluder.mesh->positions[indices[t + k]], 1.0f);
+
+            glm::vec4 polygon[4];
+            int count = 0;
+            for (int k = 0; k < 3; ++k)
+            {
+                const glm::vec4& a = clip[k];
+                const glm::vec4& b = clip[(k + 1) % 3];
+                float da = a.z + a.w, db = b.z + b.w;
+                if (da >= 0.0f)
+                    polygon[count++] = a;
+                if ((da >= 0.0f) != (db >= 0.0f))
+                    polygon[count++] = a + (b - a) * (da / (da - db));
+            }
+
+            for (int k = 1; k + 1 < count; ++k)
+            {
+                const glm::vec4* corners[3] = { &polygon[0], &polygon[k], &polygon[k + 1] };
+                ScreenTriangle triangle;
+                bool valid = true;
+                for (int v = 0; v < 3; ++v)
+                {
+                    const glm::vec4& c = *corners[v];
+                    if (c.w <= 0.0f)
+                    {
+                        valid = false;
+                        break;
+                    }
+                    triangle.x[v] = (c.x / c.w * 0.5f + 0.5f) * mWidth;
+                    triangle.y[v] = (c.y / c.w * 0.5f + 0.5f) * mHeight;
+                    triangle.z[v] = c.z / c.w * 0.5f + 0.5f;
+                }
+                if (valid)
+                    out.push_back(triangle);
+            }
+        }
+    }
+
+    // depth test and write of the triangle's pixel centers within rows [yBegin, yEnd)
+    void RasterizeTriangle(const ScreenTriangle& triangle, int yBegin, int yEnd)
+    {
+        float x0 = triangle.x[0], y0 = triangle.y[0], z0 = triangle.z[0];
+        float x1 = triangle.x[1], y1 = triangle.y[1], z1 = triangle.z[1];
+        float x2 = triangle.x[2], y2 = triangle.y[2], z2 = triangle.z[2];
+        float area = (x1 - x0) * (y2 - y0) - (x2 - x0) * (y1 - y0);
+        if (area == 0.0f)
+            return;
+        if (area < 0.0f)
+        {
+            // occluders are two-sided, wind every triangle the same way
+            std::swap(x1, x2); std::swap(y1, y2); std::swap(z1, z2);
+            area = -area;
+        }
+
+        int minX = std::max(0, (int)floorf(std::min(x0, std::min(x1, x2))));
+        int maxX = std::min(mWidth - 1, (int)ceilf(std::max(x0, std::max(x1, x2))));
+        int minY = std::max(yBegin, (int)floorf(std::min(y0, std::min(y1, y2))));
+        int maxY = std::min(yEnd - 1, (int)ceilf(std::max(y0, std::max(y1, y2))));
+        if (minX > maxX || minY > maxY)
+            return;
+
+        // edge a->b is >= 0 on the inside: (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x)
+        float edgeX[3] = { -(y1 - y0), -(y2 - y1), -(y0 - y2) };
+        float edgeY[3] = { x1 - x0, x2 - x1, x0 - x2 };
+        float edgeC[3] = { -edgeX[0] * x0 - edgeY[0] * y0, -edgeX[1] * x1 - edgeY[1] * y1, -edgeX[2] * x2 - edgeY[2] * y2 };
+        // widen each edge by 1/512 pixel so rounding cannot open cracks between triangles sharing it
+        for (int e = 0; e < 3; ++e)
+            edgeC[e] += sqrtf(edgeX[e] * edgeX[e] + edgeY[e] * edgeY[e]) * (1.0f / 512.0f);
+        float depthX = ((z1 - z0) * (y2 - y0) - (z2 - z0) * (y1 - y0)) / area;
+        float depthY = ((z2 - z0) * (x1 - x0) - (z1 - z0) * (x2 - x0)) / area;
+        float depthC = z0 - depthX * x0 - depthY * y0;
+
+        // start on a tile column so full SIMD rows stay inside the buffer
+        int startX = minX - minX % TileWidth;
+        for (int y = minY; y <= maxY; ++y)
+        {
+            float centerY = y + 0.5f;
+            float rowEdge[3];
+            for (int e = 0; e < 3; ++e)
+                rowEdge[e] = edgeY[e] * centerY + edgeC[e];
+            float rowDepth = depthY * centerY + depthC;
+            float* row = &mDepth[(size_t)y * mWidth];
+
+#if defined(SIMD_AVX2)
+            const __m256 laneOffsets = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+            for (int x = startX; x <= maxX; x += 8)
+            {
+                __m256 centerX = _mm256_add_ps(_mm256_set1_ps((float)x), laneOffsets);
+                __m256 e0 = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(edgeX[0]), centerX), _mm256_set1_ps(rowEdge[0]));
+                __m256 e1 = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(edgeX[1]), centerX), _mm256_set1_ps(rowEdge[1]));
+                __m256 e2 = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(edgeX[2]), centerX), _mm256_set1_ps(rowEdge[2]));
+                // a pixel is outside when any edge value is negative, i.e. the OR of the three has its sign bit set
+                __m256 outside = _mm256_or_ps(_mm256_or_ps(e0, e1), e2);
+                __m256 depth = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(depthX), centerX), _mm256_set1_ps(rowDepth));
+                __m256 current = _mm256_loadu_ps(row + x);
+                __m256 nearer = _mm256_min_ps(current, depth);
+                _mm256_storeu_ps(row + x, _mm256_blendv_ps(nearer, current, outside));
+            }
+#elif defined(SIMD_SSE)
+            const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+            for (int x = startX; x <= maxX; x += 4)
+            {
+                __m128 centerX = _mm_add_ps(_mm_set1_ps((float)x), laneOffsets);
+                __m128 e0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeX[0]), centerX), _mm_set1_ps(rowEdge[0]));
+                __m128 e1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeX[1]), centerX), _mm_set1_ps(rowEdge[1]));
+                __m128 e2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeX[2]), centerX), _mm_set1_ps(rowEdge[2]));
+                __m128 outside = _mm_castsi128_ps(_mm_srai_epi32(_mm_castps_si128(_mm_or_ps(_mm_or_ps(e0, e1), e2)), 31));
+                __m128 depth = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(depthX), centerX), _mm_set1_ps(rowDepth));
+                __m128 current = _mm_loadu_ps(row + x);
+                __m128 nearer = _mm_min_ps(current, depth);
+                _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(outside, current), _mm_andnot_ps(outside, nearer)));
+            }
+#else
+            for (int x = startX; x <= maxX; ++x)
+            {
+                float centerX = x + 0.5f;
+                if (edgeX[0] * centerX + rowEdge[0] < 0.0f || edgeX[1] * centerX + rowEdge[1] < 0.0f || edgeX[2] * centerX + rowEdge[2] < 0.0f)
+                    continue;
+                row[x] = std::min(row[x], depthX * centerX + rowDepth);
+            }
+#endif
+        }
+    }
+
+    void UpdateTileMax(int tileRowBegin, int tileRowEnd)
+    {
+        for (int tileY = tileRowBegin; tileY < tileRowEnd; ++tileY)
+        {
+            for (int tileX = 0; tileX < mTilesX; ++tileX)
+            {
+                float farthest = 0.0f;
+                for (int y = tileY * TileHeight; y < (tileY + 1) * TileHeight; ++y)
+                {
+                    const float* row = &mDepth[(size_t)y * mWidth + tileX * TileWidth];
+                    for (int x = 0; x < TileWidth; ++x)
+                        farthest = std::max(farthest, row[x]);
+                }
+                mTileMax[(size_t)tileY * mTilesX + tileX] = farthest;
+            }
+        }
+    }
+};
+#endif
@@ -0,0 +1,220 @@
+#pragma once
+/* On-disk cache of linked shader program binaries.
+
+Compiling GLSL is the slowest part of startup on drivers that compile on
+the CPU (llvmpipe runs LLVM for every program). ProgramCache keeps the
+binary of each linked program (glGetProgramBinary) in a directory, one
+file per program, named after a key that hashes:
+  - the driver: GL_VENDOR, GL_RENDERER and GL_VERSION
+  - every source string of the program, defines included
+so an edited shader or a driver update never picks up an old binary. The
+next start hands the file to glProgramBinary and skips compiling and
+linking. A driver may still reject a binary it wrote itself (for instance
+after an update that kept the version string); Load() then returns false,
+deletes the file and the caller compiles from source as usual.
+
+Needs GL 4.1 or ARB_get_program_binary and at least one binary format;
+without them the cache stays disabled and every program is compiled.
+*/
+
+#ifndef PROGRAMCACHE_H
+#define PROGRAMCACHE_H
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+
+namespace programcache_detail
+{
+    const char FileMagic[4] = { 'D', 'P', 'R', 'G' };
+    const uint32_t FileVersion = 1;
+
+    struct FileHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t format;    // GL binary format
+        uint32_t length;
+        uint64_t key;
+    };
+
+    // FNV-1a, continued from hash
+    inline uint64_t Hash(const void* data, size_t size, uint64_t hash)
+    {
+        const unsigned char* bytes = (const unsigned char*)data;
+        for (size_t i = 0; i < size; ++i)
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        return hash;
+    }
+
+    inline uint64_t HashString(const char* text, uint64_t hash)
+    {
+        // the terminator keeps "ab" + "c" apart from "a" + "bc"
+        return Hash(text ? text : "", text ? strlen(text) + 1 : 1, hash);
+    }
+}
+
+class ProgramCache
+{
+public:
+    // enables the cache in directory, creating it when missing; false when the driver cannot save program binaries
+    bool Create(const std::string& directory)
+    {
+        using namespace programcache_detail;
+        mEnabled = false;
+        GLint formats = 0;
+        if (GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary)
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        if (formats <= 0)
+            return false;
+
+#ifdef _WIN32
+        _mkdir(directory.c_str());
+#else
+        mkdir(directory.c_str(), 0755);
+#endif
+        mDirectory = directory;
+        mDriverHash = 14695981039346656037ull;
+        mDriverHash = HashString((const char*)glGetString(GL_VENDOR), mDriverHash);
+        mDriverHash = HashString((const char*)glGetString(GL_RENDERER), mDriverHash);
+        mDriverHash = HashString((const char*)glGetString(GL_VERSION), mDriverHash);
+        mEnabled = true;
+        return true;
+    }
+
+    bool IsEnabled() const { return mEnabled; }
+
+    // identifies a program built from these source strings by this driver
+    uint64_t Key(std::initializer_list<const char*> sources) const
+    {
+        uint64_t key = mDriverHash;
+        for (const char* source : sources)
+            key = programcache_detail::HashString(source, key);
+        return key;
+    }
+
+    // loads the cached binary for key into program, leaving it linked; false when there is none or the driver
+    // rejected it, and program can then be compiled and linked as usual
+    bool Load(uint64_t key, GLuint program)
+    {
+        using namespace programcache_detail;
+        if (!mEnabled)
+            return false;
+        std::string path = Path(key);
+        FILE* file = fopen(path.c_str(), "rb");
+        if (!file)
+            return false;
+
+        // the binary fills the rest of the file, so a damaged length cannot ask for more than is there
+        long fileSize = fseek(file, 0, SEEK_END) == 0 ? ftell(file) : -1;
+        rewind(file);
+        FileHeader header;
+        std::vector<unsigned char> binary;
+        bool valid = fileSize > (long)sizeof(header) && fread(&header, sizeof(header), 1, file) == 1
+            && memcmp(header.magic, FileMagic, 4) == 0 && header.version == FileVersion && header.key == key
+            && header.length == (uint64_t)fileSize - sizeof(header);
+        if (valid)
+        {
+            binary.resize(header.length);
+            valid = fread(binary.data(), 1, binary.size(), file) == binary.size();
+        }
+        fclose(file);
+
+        GLint linked = GL_FALSE;
+        if (valid)
+        {
+            glProgramBinary(program, (GLenum)header.format, binary.data(), (GLsizei)binary.size());
+            glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        }
+        if (!linked)
+        {
+            remove(path.c_str()); // stale or damaged, rewritten after the compile
+            ++mRejected;
+            return false;
+        }
+        ++mLoaded;
+        return true;
+    }
+
+    // call before linking a program that will be stored
+    void PrepareLink(GLuint program) const
+    {
+        if (mEnabled)
+            glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    // writes the binary of a linked program under key, through a temporary renamed over the final file so an
+    // interrupted run leaves no truncated binary behind
+    bool Store(uint64_t key, GLuint program)
+    {
+        using namespace programcache_detail;
+        if (!mEnabled)
+            return false;
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0)
+            return false;
+
+        FileHeader header = {};
+        std::vector<unsigned char> binary((size_t)length);
+        GLenum format = 0;
+        glGetProgramBinary(program, length, &length, &format, binary.data());
+        memcpy(header.magic, FileMagic, 4);
+        header.version = FileVersion;
+        header.format = format;
+        header.length = (uint32_t)length;
+        header.key = key;
+
+        std::string path = Path(key), temporary = path + ".tmp";
+        FILE* file = fopen(temporary.c_str(), "wb");
+        if (!file)
+            return false;
+        bool written = fwrite(&header, sizeof(header), 1, file) == 1
+            && fwrite(binary.data(), 1, (size_t)length, file) == (size_t)length;
+        written = fclose(file) == 0 && written;
+#ifdef _WIN32
+        if (written)
+            remove(path.c_str()); // rename does not replace an existing file on Windows
+#endif
+        if (!written || rename(temporary.c_str(), path.c_str()) != 0)
+        {
+            remove(temporary.c_str());
+            return false;
+        }
+        ++mStored;
+        return true;
+    }
+
+    // programs loaded from binaries, binaries the driver refused, and binaries written
+    size_t Loaded() const { return mLoaded; }
+    size_t Rejected() const { return mRejected; }
+    size_t Stored() const { return mStored; }
+
+private:
+    bool mEnabled = false;
+    std::string mDirectory;
+    uint64_t mDriverHash = 0;
+    size_t mLoaded = 0;
+    size_t mRejected = 0;
+    size_t mStored = 0;
+
+    std::string Path(uint64_t key) const
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+        return mDirectory + "/" + name;
+    }
+};
+#endif
@@ -0,0 +1,157 @@
+#pragma once
+/* Hierarchical scene graph with cached world transforms.
+
+Nodes hold a local translation/rotation/scale and a parent. They are stored
+in flat arrays in creation order, and a parent must exist before its
+children, so one forward pass over the arrays visits every parent before
+its children. Setting a local transform marks the node dirty; Update()
+recomputes the world matrix of dirty nodes and their descendants only, and
+does no matrix math at all when nothing changed. World matrices live in one
+contiguous array, ready to be copied into a GPU buffer, and each comes with
+its normal matrix so shaders never invert a matrix themselves.
+
+Local transforms are kept structure-of-arrays and the recomputation runs
+through the batch kernels of transformbatch.h, one batch per tree depth so
+every parent is final before its children are multiplied by it.
+*/
+
+#ifndef SCENEGRAPH_H
+#define SCENEGRAPH_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "transformbatch.h"
+
+
+class SceneGraph
+{
+public:
+    typedef uint32_t NodeId;
+    static const NodeId InvalidNode = 0xffffffffu;
+
+    // adds a node below parent (InvalidNode for a root); its world matrix is computed on the next Update()
+    NodeId CreateNode(NodeId parent, const glm::vec3& position, const glm::quat& rotation = glm::quat(), const glm::vec3& scale = glm::vec3(1.0f))
+    {
+        NodeId node = (NodeId)mParents.size();
+        mParents.push_back(parent);
+        mDepths.push_back(parent == InvalidNode ? 0 : mDepths[parent] + 1);
+        mLocal.Push(position, rotation, scale);
+        mWorld.push_back(glm::mat4(1.0f));
+        mNormals.push_back(NormalMatrix());
+        mDirty.push_back(1);
+        ++mDirtyCount;
+        return node;
+    }
+
+    void SetPosition(NodeId node, const glm::vec3& position) { mLocal.Set(node, position, Rotation(node), Scale(node)); MarkDirty(node); }
+    void SetRotation(NodeId node, const glm::quat& rotation) { mLocal.Set(node, Position(node), rotation, Scale(node)); MarkDirty(node); }
+    void SetScale(NodeId node, const glm::vec3& scale) { mLocal.Set(node, Position(node), Rotation(node), scale); MarkDirty(node); }
+
+    glm::vec3 Position(NodeId node) const { return mLocal.Position(node); }
+    glm::quat Rotation(NodeId node) const { return mLocal.Rotation(node); }
+    glm::vec3 Scale(NodeId node) const { return mLocal.Scale(node); }
+    NodeId Parent(NodeId node) const { return mParents[node]; }
+
+    // valid after Update()
+    const glm::mat4& World(NodeId node) const { return mWorld[node]; }
+    const std::vector<glm::mat4>& WorldMatrices() const { return mWorld; }
+    // transpose(inverse(mat3(World(node)))), also valid after Update()
+    const NormalMatrix& Normal(NodeId node) const { return mNormals[node]; }
+
+    size_t NodeCount() const { return mParents.size(); }
+
+    // recomputes the world and normal matrices of dirty subtrees, returns the number of nodes recomputed
+    size_t Update()
+    {
+        if (mDirtyCount == 0)
+            return 0;
+
+        // a parent precedes its children, so its flag already reflects whether its world matrix changes
+        for (std::vector<NodeId>& level : mLevels)
+            level.clear();
+        size_t updated = 0;
+        for (NodeId node = 0; node < (NodeId)mParents.size(); ++node)
+        {
+            NodeId parent = mParents[node];
+            if (parent != InvalidNode && mDirty[parent])
+                mDirty[node] = 1;
+            if (!mDirty[node])
+                continue;
+
+            if (mDepths[node] >= mLevels.size())
+                mLevels.resize(mDepths[node] + 1);
+            mLevels[mDepths[node]].push_back(node);
+            ++updated;
+        }
+
+        for (const std::vector<NodeId>& level : mLevels)
+            UpdateLevel(level);
+
+        // flags are kept through the pass so children see them; clear them once everything is current
+        std::fill(mDirty.begin(), mDirty.end(), (uint8_t)0);
+        mDirtyCount = 0;
+        return updated;
+    }
+
+private:
+    std::vector<NodeId> mParents;
+    std::vector<uint32_t> mDepths;
+    TransformSoA mLocal;
+    std::vector<glm::mat4> mWorld;
+    std::vector<NormalMatrix> mNormals;
+    std::vector<uint8_t> mDirty;
+    size_t mDirtyCount = 0;
+
+    // scratch for Update(), kept to avoid reallocating every time something moves
+    std::vector<std::vector<NodeId>> mLevels;
+    TransformSoA mBatchLocal;
+    std::vector<glm::mat4> mBatchLocalMatrices;
+    std::vector<glm::mat4> mBatchParents;
+    std::vector<glm::mat4> mBatchWorld;
+    std::vector<NormalMatrix> mBatchNormals;
+
+    void MarkDirty(NodeId node)
+    {
+        if (!mDirty[node])
+        {
+            mDirty[node] = 1;
+            ++mDirtyCount;
+        }
+    }
+
+    // gathers the nodes of one depth into contiguous batches, runs the kernels and scatters the results back
+    void UpdateLevel(const std::vector<NodeId>& nodes)
+    {
+        size_t count = nodes.size();
+        if (count == 0)
+            return;
+
+        mBatchLocal.Resize(count);
+        mBatchLocalMatrices.resize(count);
+        mBatchParents.resize(count);
+        mBatchWorld.resize(count);
+        mBatchNormals.resize(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            NodeId node = nodes[i];
+            mBatchLocal.Set(i, mLocal.Position(node), mLocal.Rotation(node), mLocal.Scale(node));
+            mBatchParents[i] = mParents[node] == InvalidNode ? glm::mat4(1.0f) : mWorld[mParents[node]];
+        }
+
+        ComposeLocalMatrices(mBatchLocal, 0, count, mBatchLocalMatrices.data());
+        MultiplyMatrices(mBatchParents.data(), mBatchLocalMatrices.data(), mBatchWorld.data(), count);
+        ComputeNormalMatrices(mBatchWorld.data(), mBatchNormals.data(), count);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            mWorld[nodes[i]] = mBatchWorld[i];
+            mNormals[nodes[i]] = mBatchNormals[i];
+        }
+    }
+};
+#endif
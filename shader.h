@@ -0,0 +1,280 @@
+#pragma once
+/* Linked GLSL program with its active uniforms and attributes reflected once
+at link time, so the render loop never has to look a uniform up by name.
+
+Typical use:
+    ShaderProgram program;            // filled in by UCreateShaderProgram
+    Uniform<glm::mat4> model = program.GetUniform<glm::mat4>("model");
+    model.Set(matrix);                // no string lookup, no glUseProgram needed
+*/
+
+#ifndef SHADER_H
+#define SHADER_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+// Maps a C++ type to the GLSL type it is uploaded as, used to validate handles against reflection
+template <typename T> struct UniformTraits;
+template <> struct UniformTraits<int> { static const GLenum Type = GL_INT; };
+template <> struct UniformTraits<float> { static const GLenum Type = GL_FLOAT; };
+template <> struct UniformTraits<glm::vec2> { static const GLenum Type = GL_FLOAT_VEC2; };
+template <> struct UniformTraits<glm::vec3> { static const GLenum Type = GL_FLOAT_VEC3; };
+template <> struct UniformTraits<glm::vec4> { static const GLenum Type = GL_FLOAT_VEC4; };
+template <> struct UniformTraits<glm::mat3> { static const GLenum Type = GL_FLOAT_MAT3; };
+template <> struct UniformTraits<glm::mat4> { static const GLenum Type = GL_FLOAT_MAT4; };
+
+// True for every GLSL sampler type of GL 4.x (float, shadow, int and unsigned, of every dimensionality), which
+// are all set through int handles
+inline bool IsSamplerType(GLenum type)
+{
+    switch (type)
+    {
+    case GL_SAMPLER_1D: case GL_SAMPLER_2D: case GL_SAMPLER_3D: case GL_SAMPLER_CUBE:
+    case GL_SAMPLER_1D_SHADOW: case GL_SAMPLER_2D_SHADOW: case GL_SAMPLER_1D_ARRAY: case GL_SAMPLER_2D_ARRAY:
+    case GL_SAMPLER_1D_ARRAY_SHADOW: case GL_SAMPLER_2D_ARRAY_SHADOW: case GL_SAMPLER_2D_MULTISAMPLE:
+    case GL_SAMPLER_2D_MULTISAMPLE_ARRAY: case GL_SAMPLER_CUBE_SHADOW: case GL_SAMPLER_BUFFER: case GL_SAMPLER_2D_RECT:
+    case GL_SAMPLER_2D_RECT_SHADOW: case GL_SAMPLER_CUBE_MAP_ARRAY: case GL_SAMPLER_CUBE_MAP_ARRAY_SHADOW:
+    case GL_INT_SAMPLER_1D: case GL_INT_SAMPLER_2D: case GL_INT_SAMPLER_3D: case GL_INT_SAMPLER_CUBE:
+    case GL_INT_SAMPLER_1D_ARRAY: case GL_INT_SAMPLER_2D_ARRAY: case GL_INT_SAMPLER_2D_MULTISAMPLE:
+    case GL_INT_SAMPLER_2D_MULTISAMPLE_ARRAY: case GL_INT_SAMPLER_BUFFER: case GL_INT_SAMPLER_2D_RECT:
+    case GL_INT_SAMPLER_CUBE_MAP_ARRAY:
+    case GL_UNSIGNED_INT_SAMPLER_1D: case GL_UNSIGNED_INT_SAMPLER_2D: case GL_UNSIGNED_INT_SAMPLER_3D:
+    case GL_UNSIGNED_INT_SAMPLER_CUBE: case GL_UNSIGNED_INT_SAMPLER_1D_ARRAY: case GL_UNSIGNED_INT_SAMPLER_2D_ARRAY:
+    case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE: case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE_ARRAY:
+    case GL_UNSIGNED_INT_SAMPLER_BUFFER: case GL_UNSIGNED_INT_SAMPLER_2D_RECT: case GL_UNSIGNED_INT_SAMPLER_CUBE_MAP_ARRAY:
+        return true;
+    default:
+        return false;
+    }
+}
+
+
+// A uniform whose location was resolved once; Set() writes it through the program object directly
+template <typename T>
+class Uniform
+{
+public:
+    GLuint Program = 0;
+    GLint Location = -1;
+
+    Uniform() {}
+    Uniform(GLuint program, GLint location) : Program(program), Location(location) {}
+
+    // false when the uniform was optimized out or not declared, Set() is then a no-op like glUniform* at -1
+    bool IsValid() const { return Location >= 0; }
+
+    void Set(const T& value) const { Upload(Program, Location, 1, &value); }
+    void Set(const T* values, GLsizei count) const { Upload(Program, Location, count, values); }
+
+private:
+    static void Upload(GLuint p, GLint l, GLsizei n, const int* v) { glProgramUniform1iv(p, l, n, v); }
+    static void Upload(GLuint p, GLint l, GLsizei n, const float* v) { glProgramUniform1fv(p, l, n, v); }
+    static void Upload(GLuint p, GLint l, GLsizei n, const glm::vec2* v) { glProgramUniform2fv(p, l, n, glm::value_ptr(*v)); }
+    static void Upload(GLuint p, GLint l, GLsizei n, const glm::vec3* v) { glProgramUniform3fv(p, l, n, glm::value_ptr(*v)); }
+    static void Upload(GLuint p, GLint l, GLsizei n, const glm::vec4* v) { glProgramUniform4fv(p, l, n, glm::value_ptr(*v)); }
+    static void Upload(GLuint p, GLint l, GLsizei n, const glm::mat3* v) { glProgramUniformMatrix3fv(p, l, n, GL_FALSE, glm::value_ptr(*v)); }
+    static void Upload(GLuint p, GLint l, GLsizei n, const glm::mat4* v) { glProgramUniformMatrix4fv(p, l, n, GL_FALSE, glm::value_ptr(*v)); }
+};
+
+
+// Linked program plus its reflected interface
+class ShaderProgram
+{
+public:
+    // one active uniform or vertex attribute
+    struct Variable
+    {
+        std::string Name;   // array names have their "[0]" suffix removed
+        GLint Location;     // -1 for members of uniform blocks
+        GLenum Type;        // GL_FLOAT_VEC3, GL_SAMPLER_2D, ...
+        GLint ArraySize;
+    };
+
+    // one active uniform block
+    struct Block
+    {
+        std::string Name;
+        GLint Binding;      // binding point assigned by layout(binding = N)
+        GLint DataSize;     // minimum buffer size in bytes
+    };
+
+    GLuint Id = 0;
+    std::vector<Variable> Uniforms;
+    std::vector<Variable> Attributes;
+    std::vector<Block> Blocks;
+
+    void Use() const { glUseProgram(Id); }
+
+    // queries all active uniforms and inputs, called once after a successful link
+    void Reflect()
+    {
+        Uniforms.clear();
+        Attributes.clear();
+        mUniformIndex.clear();
+        mAttributeIndex.clear();
+
+        ReflectInterface(GL_UNIFORM, Uniforms, mUniformIndex);
+        ReflectInterface(GL_PROGRAM_INPUT, Attributes, mAttributeIndex);
+        ReflectBlocks();
+    }
+
+    const Block* FindBlock(const std::string& name) const
+    {
+        for (const Block& block : Blocks)
+        {
+            if (block.Name == name)
+                return &block;
+        }
+        return nullptr;
+    }
+
+    const Variable* FindUniform(const std::string& name) const
+    {
+        auto it = mUniformIndex.find(name);
+        return it == mUniformIndex.end() ? nullptr : &Uniforms[it->second];
+    }
+
+    const Variable* FindAttribute(const std::string& name) const
+    {
+        auto it = mAttributeIndex.find(name);
+        return it == mAttributeIndex.end() ? nullptr : &Attributes[it->second];
+    }
+
+    GLint AttributeLocation(const std::string& name) const
+    {
+        const Variable* attribute = FindAttribute(name);
+        return attribute ? attribute->Location : -1;
+    }
+
+    // resolves a typed handle from the reflected table; call at setup time, never per frame
+    template <typename T>
+    Uniform<T> GetUniform(const std::string& name) const
+    {
+        const Variable* uniform = FindUniform(name);
+        if (!uniform)
+            return Uniform<T>(Id, -1);
+
+        // samplers are set through int handles
+        bool typeMatches = uniform->Type == UniformTraits<T>::Type || (IsSamplerType(uniform->Type) && UniformTraits<T>::Type == GL_INT);
+        if (!typeMatches)
+        {
+            std::cout << "WARNING::SHADER::UNIFORM_TYPE_MISMATCH " << name << std::endl;
+            return Uniform<T>(Id, -1);
+        }
+        return Uniform<T>(Id, uniform->Location);
+    }
+
+private:
+    std::unordered_map<std::string, size_t> mUniformIndex;
+    std::unordered_map<std::string, size_t> mAttributeIndex;
+
+    void ReflectInterface(GLenum programInterface, std::vector<Variable>& out, std::unordered_map<std::string, size_t>& index)
+    {
+        GLint count = 0;
+        GLint maxNameLength = 0;
+        glGetProgramInterfaceiv(Id, programInterface, GL_ACTIVE_RESOURCES, &count);
+        glGetProgramInterfaceiv(Id, programInterface, GL_MAX_NAME_LENGTH, &maxNameLength);
+
+        std::vector<char> name(maxNameLength + 1);
+        const GLenum properties[] = { GL_LOCATION, GL_TYPE, GL_ARRAY_SIZE };
+        GLint values[3];
+
+        for (GLint i = 0; i < count; ++i)
+        {
+            glGetProgramResourceiv(Id, programInterface, i, 3, properties, 3, NULL, values);
+            glGetProgramResourceName(Id, programInterface, i, (GLsizei)name.size(), NULL, name.data());
+
+            Variable variable;
+            variable.Name = name.data();
+            variable.Location = values[0];
+            variable.Type = (GLenum)values[1];
+            variable.ArraySize = values[2];
+
+            size_t bracket = variable.Name.find("[0]");
+            if (bracket != std::string::npos && bracket + 3 == variable.Name.size())
+                variable.Name.erase(bracket);
+
+            index[variable.Name] = out.size();
+            out.push_back(variable);
+        }
+    }
+
+    void ReflectBlocks()
+    {
+        Blocks.clear();
+
+        GLint count = 0;
+        GLint maxNameLength = 0;
+        glGetProgramInterfaceiv(Id, GL_UNIFORM_BLOCK, GL_ACTIVE_RESOURCES, &count);
+        glGetProgramInterfaceiv(Id, GL_UNIFORM_BLOCK, GL_MAX_NAME_LENGTH, &maxNameLength);
+
+        std::vector<char> name(maxNameLength + 1);
+        const GLenum properties[] = { GL_BUFFER_BINDING, GL_BUFFER_DATA_SIZE };
+        GLint values[2];
+
+        for (GLint i = 0; i < count; ++i)
+        {
+            glGetProgramResourceiv(Id, GL_UNIFORM_BLOCK, i, 2, properties, 2, NULL, values);
+            glGetProgramResourceName(Id, GL_UNIFORM_BLOCK, i, (GLsizei)name.size(), NULL, name.data());
+            Blocks.push_back({ name.data(), values[0], values[1] });
+        }
+    }
+};
+
+
+// A uniform buffer holding one std140 struct, bound once to a fixed binding point and shared by every program
+template <typename T>
+class UniformBuffer
+{
+public:
+    GLuint Id = 0;
+    GLuint Binding = 0;
+
+    void Create(GLuint binding)
+    {
+        Binding = binding;
+        glGenBuffers(1, &Id);
+        glBindBuffer(GL_UNIFORM_BUFFER, Id);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(T), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, binding, Id);
+    }
+
+    // one buffer write replaces the per-program glUniform* calls
+    void Update(const T& data) const
+    {
+        glBindBuffer(GL_UNIFORM_BUFFER, Id);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(T), &data);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    // warns when a program's block disagrees with the C++ layout or binding
+    bool Validate(const ShaderProgram& program, const std::string& blockName) const
+    {
+        const ShaderProgram::Block* block = program.FindBlock(blockName);
+        if (!block)
+            return true; // optimized out, nothing to feed
+        if (block->Binding != (GLint)Binding || block->DataSize > (GLint)sizeof(T))
+        {
+            std::cout << "ERROR::SHADER::UNIFORM_BLOCK_MISMATCH " << blockName << " binding " << block->Binding
+                << " size " << block->DataSize << " (expected binding " << Binding << " size " << sizeof(T) << ")" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    void Destroy()
+    {
+        glDeleteBuffers(1, &Id);
+        Id = 0;
+    }
+};
+#endif
@@ -0,0 +1,192 @@
+#pragma once
+/* Shader permutations built from feature flags.
+
+One shader source covers every way the scene is drawn; a permutation picks
+the features a draw needs and the builder compiles a variant for it:
+  SHADER_FEATURE_TEXTURED         samples the scene texture, else uBaseColor
+  SHADER_FEATURE_SPECULAR         adds the Phong highlight
+  SHADER_FEATURE_PACKED_VERTICES  decodes quantized positions and octahedral
+                                  normals (VERTEX_FORMAT_PACKED)
+  SHADER_FEATURE_TEXTURE_ATLAS    samples the atlas instead of the array
+  SHADER_FEATURE_INVERSE_NORMALS  inverts the model matrix per vertex instead
+                                  of reading the instance's normal matrix;
+                                  only the vertex benchmark uses it, as the
+                                  baseline
+  SHADER_FEATURE_CLUSTERED_LIGHTS adds the point lights of the fragment's
+                                  cluster (lightcluster.h)
+  SHADER_FEATURE_GBUFFER          writes the surface to the G-buffer
+                                  (gbuffer.h) instead of lighting it
+  SHADER_FEATURE_DEFERRED_LIGHTING
+                                  lights the surface read from the G-buffer,
+                                  drawn as a full-screen triangle
+plus a light count, 0 to MAX_SHADER_LIGHTS, where 0 draws unlit.
+
+The choices reach GLSL as #defines inserted after the #version and
+#extension lines, always defined and always 0 or 1 (LIGHT_COUNT the
+count), e.g.
+    #define TEXTURED 1
+    #define SPECULAR 0
+    #define LIGHT_COUNT 1
+The sources test them with plain if statements on those constants (they are
+stringified by the GLSL() macro and cannot hold #if lines); every compiler
+folds the constant branches, so a variant carries no code and no uniform
+reads for the features it leaves out, and loops over LIGHT_COUNT unroll.
+
+ShaderPermutationCache builds a variant the first time it is asked for and
+hands back the same one afterwards, so only the permutations the scene
+draws are ever compiled.
+*/
+
+#ifndef SHADERPERMUTATION_H
+#define SHADERPERMUTATION_H
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+
+
+enum ShaderFeature
+{
+    SHADER_FEATURE_TEXTURED = 1 << 0,
+    SHADER_FEATURE_SPECULAR = 1 << 1,
+    SHADER_FEATURE_PACKED_VERTICES = 1 << 2,
+    SHADER_FEATURE_TEXTURE_ATLAS = 1 << 3,
+    SHADER_FEATURE_INVERSE_NORMALS = 1 << 4,
+    SHADER_FEATURE_CLUSTERED_LIGHTS = 1 << 5,
+    SHADER_FEATURE_GBUFFER = 1 << 6,
+    SHADER_FEATURE_DEFERRED_LIGHTING = 1 << 7,
+};
+
+const int SHADER_FEATURE_COUNT = 8;
+
+// Lights the FrameData block holds; a permutation lights with the first LIGHT_COUNT of them
+const int MAX_SHADER_LIGHTS = 4;
+
+namespace shaderpermutation_detail
+{
+    // GLSL macro of each feature bit, in bit order
+    const char* const FeatureDefines[SHADER_FEATURE_COUNT] = { "TEXTURED", "SPECULAR", "PACKED_VERTICES", "TEXTURE_ATLAS", "INVERSE_NORMALS", "CLUSTERED_LIGHTS", "GBUFFER",
+        "DEFERRED_LIGHTING" };
+    const char* const FeatureNames[SHADER_FEATURE_COUNT] = { "textured", "specular", "packed", "atlas", "inverse normals", "clustered", "g-buffer",
+        "deferred lighting" };
+}
+
+struct ShaderPermutation
+{
+    unsigned features = 0;  // ShaderFeature bits
+    int lightCount = 0;
+
+    ShaderPermutation() = default;
+    ShaderPermutation(unsigned features, int lightCount) : features(features), lightCount(lightCount) {}
+
+    bool Has(ShaderFeature feature) const { return (features & feature) != 0; }
+
+    uint32_t Key() const { return (uint32_t)features | (uint32_t)lightCount << 16; }
+
+    // the #define block injected into every stage of the variant
+    std::string Defines() const
+    {
+        using namespace shaderpermutation_detail;
+        std::string defines;
+        for (int bit = 0; bit < SHADER_FEATURE_COUNT; ++bit)
+            defines += std::string("#define ") + FeatureDefines[bit] + ((features & (1u << bit)) ? " 1\n" : " 0\n");
+        defines += "#define LIGHT_COUNT " + std::to_string(lightCount) + "\n";
+        defines += "#define MAX_LIGHTS " + std::to_string(MAX_SHADER_LIGHTS) + "\n";
+        return defines;
+    }
+
+    // e.g. "textured+specular, 1 light", for logs
+    std::string Name() const
+    {
+        using namespace shaderpermutation_detail;
+        std::string name;
+        for (int bit = 0; bit < SHADER_FEATURE_COUNT; ++bit)
+        {
+            if (features & (1u << bit))
+                name += (name.empty() ? "" : "+") + std::string(FeatureNames[bit]);
+        }
+        if (name.empty())
+            name = "untextured";
+        if (lightCount == 0)
+            return name + ", unlit";
+        return name + ", " + std::to_string(lightCount) + (lightCount == 1 ? " light" : " lights");
+    }
+};
+
+// Inserts defines after the #version line and any #extension lines that follow it, where GLSL requires them
+inline std::string InjectDefines(const char* source, const std::string& defines)
+{
+    std::string text(source);
+    size_t position = 0;
+    while (position < text.size() && (text.compare(position, 8, "#version") == 0 || text.compare(position, 10, "#extension") == 0))
+    {
+        size_t end = text.find('\n', position);
+        position = end == std::string::npos ? text.size() : end + 1;
+    }
+    return text.insert(position, defines);
+}
+
+// Variants built on first use and kept by permutation key; Variant is whatever the builder fills in
+template <typename Variant>
+class ShaderPermutationCache
+{
+public:
+    using Builder = std::function<bool(const ShaderPermutation&, Variant&)>;
+    using Destroyer = std::function<void(Variant&)>;
+
+    void Create(Builder builder, Destroyer destroyer)
+    {
+        mBuilder = builder;
+        mDestroyer = destroyer;
+    }
+
+    // the variant for permutation, building it on the first request; nullptr when it failed to build,
+    // which is remembered so a broken variant is not recompiled every frame
+    Variant* Get(const ShaderPermutation& permutation)
+    {
+        auto found = mVariants.find(permutation.Key());
+        if (found != mVariants.end())
+            return found->second.get();
+
+        std::unique_ptr<Variant> variant(new Variant());
+        if (!mBuilder(permutation, *variant))
+            variant.reset();
+        Variant* result = variant.get();
+        mVariants[permutation.Key()] = std::move(variant);
+        return result;
+    }
+
+    // variants built successfully so far
+    size_t Count() const
+    {
+        size_t count = 0;
+        for (const auto& entry : mVariants)
+            count += entry.second ? 1 : 0;
+        return count;
+    }
+
+    template <typename Function>
+    void ForEach(Function function)
+    {
+        for (auto& entry : mVariants)
+        {
+            if (entry.second)
+                function(*entry.second);
+        }
+    }
+
+    void Destroy()
+    {
+        ForEach(mDestroyer);
+        mVariants.clear();
+    }
+
+private:
+    Builder mBuilder;
+    Destroyer mDestroyer;
+    std::map<uint32_t, std::unique_ptr<Variant>> mVariants;
+};
+#endif
@@ -0,0 +1,32 @@
+#pragma once
+/* Compile-time SIMD selection shared by the CPU kernels.
+
+SIMD_AVX2 is defined when the compiler targets AVX2 (/arch:AVX2, -mavx2),
+SIMD_SSE otherwise on x86 (SSE2 is part of x64), and neither elsewhere, in
+which case the kernels use their plain C++ paths. SIMD_AVX2 implies the SSE
+intrinsics are available too.
+*/
+
+#ifndef SIMD_H
+#define SIMD_H
+
+#if defined(__AVX2__)
+#define SIMD_AVX2
+#define SIMD_SSE
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_SSE
+#include <emmintrin.h>
+#endif
+
+inline const char* SimdInstructionSet()
+{
+#if defined(SIMD_AVX2)
+    return "AVX2";
+#elif defined(SIMD_SSE)
+    return "SSE";
+#else
+    return "scalar";
+#endif
+}
+#endif
@@ -0,0 +1,320 @@
+#pragma once
+/* Texture arrays and atlases: every scene texture behind one binding, picked
+in the shader by index instead of by binding a texture per draw.
+
+TextureArray is one GL_TEXTURE_2D_ARRAY whose layers share a format, a size
+and a full mip chain. Textures of other sizes are resampled to the layer
+size on the CPU before their mips are built (ResampleImage in mipgen.h), so
+every layer lines up with the array's levels; GL_REPEAT and the mip chain
+keep working per layer, and the shader selects one by layer index.
+
+TextureAtlas is the fallback when that is not wanted or possible (more
+textures than GL_MAX_ARRAY_TEXTURE_LAYERS, or textures that must keep their
+own size): one large GL_TEXTURE_2D that textures are packed into at their
+own size by a skyline packer (SkylinePacker). Each region starts on an
+ATLAS_ALIGNMENT boundary and is surrounded by a gutter of as many texels
+filled with the texture's own wrapped edges, so filtering across an edge
+behaves like GL_REPEAT. That holds for the first ATLAS_LEVELS mip levels,
+which are all the atlas keeps. The shader wraps the texture coordinate
+itself and maps it into the region (AtlasRegion). Atlases are uncompressed,
+since compressed sub-uploads must cover whole blocks at every level.
+*/
+
+#ifndef TEXTUREARRAY_H
+#define TEXTUREARRAY_H
+
+#include <GL/glew.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "texturecache.h"
+
+
+// Region alignment and gutter width in the atlas, in texels of level 0
+const int ATLAS_ALIGNMENT = 16;
+// Mip levels an atlas keeps: the gutter is still one texel wide at the last one
+const int ATLAS_LEVELS = 5;
+
+// Bottom-left skyline rectangle packer: the packed area is described by the height of its top edge along x,
+// and each rectangle goes where that edge is lowest
+class SkylinePacker
+{
+public:
+    void Reset(int width, int height)
+    {
+        mWidth = width;
+        mHeight = height;
+        mSkyline.assign(1, { 0, 0, width });
+        mUsedArea = 0;
+    }
+
+    // finds a place for a width x height rectangle, lowest first, then on the narrowest segment; false when
+    // it does not fit
+    bool Insert(int width, int height, int& x, int& y)
+    {
+        size_t bestIndex = mSkyline.size();
+        int bestTop = INT_MAX, bestWidth = INT_MAX;
+        for (size_t i = 0; i < mSkyline.size(); ++i)
+        {
+            int top;
+            if (Fits(i, width, height, top) && (top < bestTop || (top == bestTop && mSkyline[i].width < bestWidth)))
+            {
+                bestIndex = i;
+                bestTop = top;
+                bestWidth = mSkyline[i].width;
+            }
+        }
+        if (bestIndex == mSkyline.size())
+            return false;
+
+        x = mSkyline[bestIndex].x;
+        y = bestTop;
+        mSkyline.insert(mSkyline.begin() + bestIndex, { x, y + height, width });
+
+        // the new segment shadows the ones it covers
+        for (size_t i = bestIndex + 1; i < mSkyline.size();)
+        {
+            int covered = mSkyline[i - 1].x + mSkyline[i - 1].width - mSkyline[i].x;
+            if (covered <= 0)
+                break;
+            mSkyline[i].x += covered;
+            mSkyline[i].width -= covered;
+            if (mSkyline[i].width > 0)
+                break;
+            mSkyline.erase(mSkyline.begin() + i);
+        }
+        for (size_t i = 0; i + 1 < mSkyline.size();)
+        {
+            if (mSkyline[i].y == mSkyline[i + 1].y)
+            {
+                mSkyline[i].width += mSkyline[i + 1].width;
+                mSkyline.erase(mSkyline.begin() + i + 1);
+            }
+            else
+                ++i;
+        }
+        mUsedArea += (size_t)width * height;
+        return true;
+    }
+
+    // share of the area covered by rectangles
+    float Occupancy() const { return mWidth > 0 && mHeight > 0 ? (float)mUsedArea / ((float)mWidth * mHeight) : 0.0f; }
+
+private:
+    struct Segment
+    {
+        int x, y, width;
+    };
+
+    int mWidth = 0, mHeight = 0;
+    std::vector<Segment> mSkyline;
+    size_t mUsedArea = 0;
+
+    // top is the height the rectangle would rest at when its left edge is on segment index
+    bool Fits(size_t index, int width, int height, int& top) const
+    {
+        if (mSkyline[index].x + width > mWidth)
+            return false;
+        top = 0;
+        for (size_t i = index; width > 0; ++i)
+        {
+            top = std::max(top, mSkyline[i].y);
+            if (top + height > mHeight)
+                return false;
+            width -= mSkyline[i].width;
+        }
+        return true;
+    }
+};
+
+// Same-format textures as layers of one GL_TEXTURE_2D_ARRAY
+class TextureArray
+{
+public:
+    // immutable storage for layers of width x height with a full mip chain, GL_RGBA8 or block compressed; false
+    // when the GL cannot hold that many layers, layers that large, or the memory for them
+    bool Create(TextureCompression compression, int width, int height, int layers)
+    {
+        GLint maxLayers = 0, maxSize = 0;
+        glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+        glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+        if (layers > maxLayers || width > maxSize || height > maxSize)
+            return false;
+
+        mCompression = compression;
+        mWidth = width;
+        mHeight = height;
+        mLayers = layers;
+        mLevels = 1;
+        while (std::max(width, height) >> mLevels)
+            ++mLevels;
+        GLenum internalFormat = compression == TEXTURE_COMPRESSION_NONE ? GL_RGBA8 : TextureCompressionFormat(compression);
+        glGenTextures(1, &mTexture);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, mTexture);
+        while (glGetError() != GL_NO_ERROR)
+            ; // only the allocation's own error counts
+        glTexStorage3D(GL_TEXTURE_2D_ARRAY, mLevels, internalFormat, width, height, layers);
+        if (glGetError() != GL_NO_ERROR)
+        {
+            glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+            Destroy();
+            return false;
+        }
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        return true;
+    }
+
+    // true when levels can become a layer as they are
+    bool Accepts(const TextureLevels& levels) const
+    {
+        return levels.compression == mCompression && levels.width == mWidth && levels.height == mHeight && levels.LevelCount() == mLevels;
+    }
+
+    // uploads one level of a layer from client memory, or from an offset into the bound pixel unpack buffer;
+    // the array may stay bound for rendering, so the active unit's binding is restored afterwards
+    void UploadLevel(int layer, int level, const TextureLevels& levels, const void* data, GLenum type) const
+    {
+        GLint bound = 0;
+        glGetIntegerv(GL_TEXTURE_BINDING_2D_ARRAY, &bound);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, mTexture);
+        if (mCompression != TEXTURE_COMPRESSION_NONE)
+            glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, levels.LevelWidth(level), levels.LevelHeight(level), 1,
+                TextureCompressionFormat(mCompression), (GLsizei)levels.levelSizes[level], data);
+        else
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, levels.LevelWidth(level), levels.LevelHeight(level), 1,
+                levels.layout == IMAGE_LAYOUT_BGRA ? GL_BGRA : GL_RGBA, type, data);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, (GLuint)bound);
+    }
+
+    void Destroy()
+    {
+        glDeleteTextures(1, &mTexture);
+        mTexture = 0;
+    }
+
+    GLuint Texture() const { return mTexture; }
+    int Width() const { return mWidth; }
+    int Height() const { return mHeight; }
+    int Layers() const { return mLayers; }
+    int Levels() const { return mLevels; }
+
+private:
+    GLuint mTexture = 0;
+    TextureCompression mCompression = TEXTURE_COMPRESSION_NONE;
+    int mWidth = 0, mHeight = 0, mLayers = 0, mLevels = 0;
+};
+
+// Where a texture lives in an atlas, in atlas texture coordinates: atlas uv = offset + fract(uv) * scale
+struct AtlasRegion
+{
+    float offset[2] = { 0.0f, 0.0f };
+    float scale[2] = { 0.0f, 0.0f };
+};
+
+// Textures of any size packed into one uncompressed GL_TEXTURE_2D
+class TextureAtlas
+{
+public:
+    // storage for a width x height atlas of ATLAS_LEVELS levels with room for slots regions
+    void Create(int width, int height, int slots)
+    {
+        mWidth = width;
+        mHeight = height;
+        mPacker.Reset(width, height);
+        mRegions.assign(slots, AtlasRegion());
+        mOrigins.assign(slots * 2, 0);
+        glGenTextures(1, &mTexture);
+        glBindTexture(GL_TEXTURE_2D, mTexture);
+        glTexStorage2D(GL_TEXTURE_2D, ATLAS_LEVELS, GL_RGBA8, width, height);
+        // wrapping happens in the shader, inside each region
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        // trilinear only down to the last level whose gutter is still a texel wide
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, ATLAS_LEVELS - 1);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    // reserves the region of slot for a width x height texture and its gutter; false when the atlas is full
+    bool Place(int slot, int width, int height)
+    {
+        int paddedWidth = Align(width) + 2 * ATLAS_ALIGNMENT, paddedHeight = Align(height) + 2 * ATLAS_ALIGNMENT;
+        int x, y;
+        if (!mPacker.Insert(paddedWidth, paddedHeight, x, y))
+            return false;
+        mOrigins[slot * 2] = x + ATLAS_ALIGNMENT;
+        mOrigins[slot * 2 + 1] = y + ATLAS_ALIGNMENT;
+        AtlasRegion& region = mRegions[slot];
+        region.offset[0] = (float)(x + ATLAS_ALIGNMENT) / mWidth;
+        region.offset[1] = (float)(y + ATLAS_ALIGNMENT) / mHeight;
+        region.scale[0] = (float)width / mWidth;
+        region.scale[1] = (float)height / mHeight;
+        return true;
+    }
+
+    // uploads one level of the texture placed in slot, with the gutter around it, from client memory; the active
+    // unit's binding is restored afterwards
+    void UploadLevel(int slot, int level, const TextureLevels& levels, const unsigned char* data, GLenum type)
+    {
+        int width = levels.LevelWidth(level), height = levels.LevelHeight(level);
+        int gutter = ATLAS_ALIGNMENT >> level;
+        int paddedWidth = width + 2 * gutter, paddedHeight = height + 2 * gutter;
+        // region offsets are multiples of ATLAS_ALIGNMENT texels, so they stay exact down to the last level
+        int x = mOrigins[slot * 2] >> level, y = mOrigins[slot * 2 + 1] >> level;
+
+        mPadded.resize((size_t)paddedWidth * paddedHeight);
+        const uint32_t* pixels = (const uint32_t*)data;
+        for (int row = 0; row < paddedHeight; ++row)
+        {
+            const uint32_t* source = pixels + (size_t)Wrap(row - gutter, height) * width;
+            uint32_t* destination = &mPadded[(size_t)row * paddedWidth];
+            for (int column = 0; column < gutter; ++column)
+            {
+                destination[column] = source[Wrap(column - gutter, width)];
+                destination[gutter + width + column] = source[Wrap(column, width)];
+            }
+            memcpy(destination + gutter, source, (size_t)width * sizeof(uint32_t));
+        }
+
+        GLint bound = 0;
+        glGetIntegerv(GL_TEXTURE_BINDING_2D, &bound);
+        glBindTexture(GL_TEXTURE_2D, mTexture);
+        glTexSubImage2D(GL_TEXTURE_2D, level, x - gutter, y - gutter, paddedWidth, paddedHeight,
+            levels.layout == IMAGE_LAYOUT_BGRA ? GL_BGRA : GL_RGBA, type, mPadded.data());
+        glBindTexture(GL_TEXTURE_2D, (GLuint)bound);
+    }
+
+    void Destroy()
+    {
+        glDeleteTextures(1, &mTexture);
+        mTexture = 0;
+        std::vector<uint32_t>().swap(mPadded);
+    }
+
+    GLuint Texture() const { return mTexture; }
+    int Width() const { return mWidth; }
+    int Height() const { return mHeight; }
+    const AtlasRegion& Region(int slot) const { return mRegions[slot]; }
+    float Occupancy() const { return mPacker.Occupancy(); }
+
+private:
+    GLuint mTexture = 0;
+    int mWidth = 0, mHeight = 0;
+    SkylinePacker mPacker;
+    std::vector<AtlasRegion> mRegions;
+    std::vector<int> mOrigins;      // texel x, y of each region at level 0
+    std::vector<uint32_t> mPadded;  // one level with its gutter, reused between uploads
+
+    static int Align(int size) { return (size + ATLAS_ALIGNMENT - 1) & ~(ATLAS_ALIGNMENT - 1); }
+    static int Wrap(int index, int size) { return ((index % size) + size) % size; }
+};
+#endif
@@ -0,0 +1,702 @@
+#pragma once
+/* Block compressed textures and their on-disk cache.
+
+The first time a texture is loaded with compression enabled, its RGBA pixels
+are reduced to a full mip chain (mipgen.h) and every level is encoded on the
+CPU, block rows split across the thread pool:
+  BC1 (S3TC DXT1)  4 bits per pixel, two RGB565 endpoints and 2-bit indices
+  BC7 mode 6       8 bits per pixel, two RGBA 7.7.7.7 endpoints with a
+                   shared low bit each and 4-bit indices
+Both encoders fit the endpoints along the principal axis of the block's
+colors, pick the closest palette entry per pixel, then refine the endpoints
+once by least squares. That is far from an exhaustive search but fast
+enough to run on the worker threads at first start.
+
+The encoded levels are written next to the source image (wood.jpg ->
+wood.jpg.bc7) with a hash of the source file and the mip filter, so later
+starts read them back without decoding the JPEG, and an edited source or a
+different filter invalidates the cache. Asset packs (assetpack.h) store
+textures in the same serialized form and map the levels in place.
+*/
+
+#ifndef TEXTURECACHE_H
+#define TEXTURECACHE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "imageops.h"
+#include "mipgen.h"
+#include "threadpool.h"
+
+
+enum TextureCompression { TEXTURE_COMPRESSION_NONE, TEXTURE_COMPRESSION_BC1, TEXTURE_COMPRESSION_BC7 };
+
+inline const char* TextureCompressionName(TextureCompression compression)
+{
+    switch (compression)
+    {
+    case TEXTURE_COMPRESSION_BC1: return "bc1";
+    case TEXTURE_COMPRESSION_BC7: return "bc7";
+    default: return "none";
+    }
+}
+
+// GL_COMPRESSED_RGB_S3TC_DXT1_EXT and GL_COMPRESSED_RGBA_BPTC_UNORM
+inline unsigned TextureCompressionFormat(TextureCompression compression)
+{
+    return compression == TEXTURE_COMPRESSION_BC1 ? 0x83F0u : compression == TEXTURE_COMPRESSION_BC7 ? 0x8E8Cu : 0u;
+}
+
+inline size_t TextureCompressionBlockBytes(TextureCompression compression)
+{
+    return compression == TEXTURE_COMPRESSION_BC1 ? 8 : 16;
+}
+
+// Every level of one texture, largest first, packed back to back in data: blocks when compressed, 4-byte pixels
+// in layout when compression is TEXTURE_COMPRESSION_NONE. Levels mapped from an asset pack stay where they are,
+// mapped points at them and data is empty.
+struct TextureLevels
+{
+    TextureCompression compression = TEXTURE_COMPRESSION_NONE;
+    MipFilter mipFilter = MIP_FILTER_BOX;
+    ImageLayout layout = IMAGE_LAYOUT_RGBA;
+    bool premultipliedAlpha = false;    // color scaled by alpha in linear light (imageops.h)
+    int width = 0, height = 0;
+    std::vector<unsigned char> data;
+    const unsigned char* mapped = nullptr;
+    std::vector<size_t> levelOffsets;
+    std::vector<size_t> levelSizes;
+
+    int LevelCount() const { return (int)levelSizes.size(); }
+    int LevelWidth(int level) const { return std::max(1, width >> level); }
+    int LevelHeight(int level) const { return std::max(1, height >> level); }
+    const unsigned char* LevelData(int level) const { return (mapped ? mapped : data.data()) + levelOffsets[level]; }
+    // what the upload of a level reads: whole 4x4 blocks, or 4-byte pixels
+    size_t ExpectedLevelSize(int level) const
+    {
+        if (compression == TEXTURE_COMPRESSION_NONE)
+            return (size_t)LevelWidth(level) * LevelHeight(level) * 4;
+        return (size_t)((LevelWidth(level) + 3) / 4) * ((LevelHeight(level) + 3) / 4) * TextureCompressionBlockBytes(compression);
+    }
+    size_t ByteCount() const { return levelSizes.empty() ? 0 : levelOffsets.back() + levelSizes.back(); }
+};
+
+
+// ---------------------------------------------------------------------------------------------------------------
+// Block encoders
+
+namespace texturecache_detail
+{
+    // least-squares endpoints for pixels whose positions along the segment are weights (0 = first, 1 = second)
+    inline bool FitEndpoints(const float pixels[16][4], const float weights[16], int channels, float first[4], float second[4])
+    {
+        float a = 0.0f, b = 0.0f, c = 0.0f, x[4] = {}, y[4] = {};
+        for (int i = 0; i < 16; ++i)
+        {
+            float w = weights[i], v = 1.0f - w;
+            a += v * v;
+            b += v * w;
+            c += w * w;
+            for (int k = 0; k < channels; ++k)
+            {
+                x[k] += v * pixels[i][k];
+                y[k] += w * pixels[i][k];
+            }
+        }
+        float determinant = a * c - b * b;
+        if (fabsf(determinant) < 1e-6f)
+            return false;
+        for (int k = 0; k < channels; ++k)
+        {
+            first[k] = std::min(255.0f, std::max(0.0f, (c * x[k] - b * y[k]) / determinant));
+            second[k] = std::min(255.0f, std::max(0.0f, (a * y[k] - b * x[k]) / determinant));
+        }
+        return true;
+    }
+
+    // endpoints at the extremes of the pixels' projection on their principal axis
+    inline void PrincipalEndpoints(const float pixels[16][4], int channels, float first[4], float second[4])
+    {
+        float mean[4] = {};
+        for (int i = 0; i < 16; ++i)
+            for (int k = 0; k < channels; ++k)
+                mean[k] += pixels[i][k] / 16.0f;
+
+        float covariance[4][4] = {};
+        for (int i = 0; i < 16; ++i)
+            for (int j = 0; j < channels; ++j)
+                for (int k = 0; k < channels; ++k)
+                    covariance[j][k] += (pixels[i][j] - mean[j]) * (pixels[i][k] - mean[k]);
+
+        // power iteration, starting from the diagonal of the bounding box
+        float axis[4] = {};
+        for (int k = 0; k < channels; ++k)
+        {
+            float low = 255.0f, high = 0.0f;
+            for (int i = 0; i < 16; ++i)
+            {
+                low = std::min(low, pixels[i][k]);
+                high = std::max(high, pixels[i][k]);
+            }
+            axis[k] = high - low;
+        }
+        for (int iteration = 0; iteration < 8; ++iteration)
+        {
+            float next[4] = {}, length = 0.0f;
+            for (int j = 0; j < channels; ++j)
+            {
+                for (int k = 0; k < channels; ++k)
+                    next[j] += covariance[j][k] * axis[k];
+                length = std::max(length, fabsf(next[j]));
+            }
+            if (length < 1e-6f)
+                break;
+            for (int k = 0; k < channels; ++k)
+                axis[k] = next[k] / length;
+        }
+
+        float axisLength = 0.0f;
+        for (int k = 0; k < channels; ++k)
+            axisLength += axis[k] * axis[k];
+        float low = 0.0f, high = 0.0f;
+        if (axisLength > 1e-12f)
+        {
+            low = 1e30f;
+            high = -1e30f;
+            for (int i = 0; i < 16; ++i)
+            {
+                float t = 0.0f;
+                for (int k = 0; k < channels; ++k)
+                    t += (pixels[i][k] - mean[k]) * axis[k];
+                t /= axisLength;
+                low = std::min(low, t);
+                high = std::max(high, t);
+            }
+        }
+        for (int k = 0; k < channels; ++k)
+        {
+            first[k] = std::min(255.0f, std::max(0.0f, mean[k] + low * axis[k]));
+            second[k] = std::min(255.0f, std::max(0.0f, mean[k] + high * axis[k]));
+        }
+    }
+
+    inline void LoadBlock(const unsigned char* rgba, int width, int height, int blockX, int blockY, float pixels[16][4])
+    {
+        for (int y = 0; y < 4; ++y)
+        {
+            int sourceY = std::min(blockY * 4 + y, height - 1);
+            for (int x = 0; x < 4; ++x)
+            {
+                int sourceX = std::min(blockX * 4 + x, width - 1);
+                const unsigned char* pixel = rgba + ((size_t)sourceY * width + sourceX) * 4;
+                for (int k = 0; k < 4; ++k)
+                    pixels[y * 4 + x][k] = pixel[k];
+            }
+        }
+    }
+
+    // ---- BC1 ----
+
+    inline uint16_t PackRgb565(const float color[4])
+    {
+        int r = (int)(color[0] * 31.0f / 255.0f + 0.5f), g = (int)(color[1] * 63.0f / 255.0f + 0.5f), b = (int)(color[2] * 31.0f / 255.0f + 0.5f);
+        return (uint16_t)((std::min(r, 31) << 11) | (std::min(g, 63) << 5) | std::min(b, 31));
+    }
+
+    inline void UnpackRgb565(uint16_t packed, float color[3])
+    {
+        int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+        color[0] = (float)((r << 3) | (r >> 2));
+        color[1] = (float)((g << 2) | (g >> 4));
+        color[2] = (float)((b << 3) | (b >> 2));
+    }
+
+    // indices for two packed endpoints in four-color mode; returns the squared error
+    inline float Bc1Indices(const float pixels[16][4], uint16_t color0, uint16_t color1, uint32_t& indices, float weights[16])
+    {
+        float palette[4][3];
+        UnpackRgb565(color0, palette[0]);
+        UnpackRgb565(color1, palette[1]);
+        for (int k = 0; k < 3; ++k)
+        {
+            palette[2][k] = (2.0f * palette[0][k] + palette[1][k]) / 3.0f;
+            palette[3][k] = (palette[0][k] + 2.0f * palette[1][k]) / 3.0f;
+        }
+        const float paletteWeights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+        float total = 0.0f;
+        indices = 0;
+        for (int i = 0; i < 16; ++i)
+        {
+            int best = 0;
+            float bestError = 1e30f;
+            for (int entry = 0; entry < 4; ++entry)
+            {
+                float error = 0.0f;
+                for (int k = 0; k < 3; ++k)
+                {
+                    float d = pixels[i][k] - palette[entry][k];
+                    error += d * d;
+                }
+                if (error < bestError)
+                {
+                    bestError = error;
+                    best = entry;
+                }
+            }
+            indices |= (uint32_t)best << (2 * i);
+            weights[i] = paletteWeights[best];
+            total += bestError;
+        }
+        return total;
+    }
+
+    inline float EncodeBc1Endpoints(const float pixels[16][4], const float first[4], const float second[4], unsigned char out[8], float weights[16])
+    {
+        uint16_t color0 = PackRgb565(first), color1 = PackRgb565(second);
+        if (color0 < color1)
+            std::swap(color0, color1);
+        uint32_t indices = 0;
+        float error;
+        if (color0 == color1)
+        {
+            // one color; four-color mode needs color0 > color1, so every index points at color0
+            float palette[3];
+            UnpackRgb565(color0, palette);
+            error = 0.0f;
+            for (int i = 0; i < 16; ++i)
+            {
+                for (int k = 0; k < 3; ++k)
+                    error += (pixels[i][k] - palette[k]) * (pixels[i][k] - palette[k]);
+                weights[i] = 0.0f;
+            }
+        }
+        else
+            error = Bc1Indices(pixels, color0, color1, indices, weights);
+
+        out[0] = (unsigned char)(color0 & 0xff);
+        out[1] = (unsigned char)(color0 >> 8);
+        out[2] = (unsigned char)(color1 & 0xff);
+        out[3] = (unsigned char)(color1 >> 8);
+        for (int b = 0; b < 4; ++b)
+            out[4 + b] = (unsigned char)(indices >> (8 * b));
+        return error;
+    }
+
+    // ---- BC7 mode 6 ----
+
+    const int Bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    struct Bc7Endpoints
+    {
+        int quantized[2][4];    // 7 bits per channel
+        int pbits[2];
+    };
+
+    inline void QuantizeBc7(const float first[4], const float second[4], int pbit0, int pbit1, Bc7Endpoints& endpoints)
+    {
+        const float* colors[2] = { first, second };
+        endpoints.pbits[0] = pbit0;
+        endpoints.pbits[1] = pbit1;
+        for (int e = 0; e < 2; ++e)
+            for (int k = 0; k < 4; ++k)
+                endpoints.quantized[e][k] = std::min(127, std::max(0, (int)floorf((colors[e][k] - endpoints.pbits[e]) * 0.5f + 0.5f)));
+    }
+
+    inline float Bc7Indices(const float pixels[16][4], const Bc7Endpoints& endpoints, int indices[16])
+    {
+        int palette[16][4];
+        for (int k = 0; k < 4; ++k)
+        {
+            int e0 = (endpoints.quantized[0][k] << 1) | endpoints.pbits[0];
+            int e1 = (endpoints.quantized[1][k] << 1) | endpoints.pbits[1];
+            for (int entry = 0; entry < 16; ++entry)
+                palette[entry][k] = ((64 - Bc7Weights[entry]) * e0 + Bc7Weights[entry] * e1 + 32) >> 6;
+        }
+
+        // the palette is a line, so the projection lands next to the best entry
+        float direction[4], lengthSquared = 0.0f;
+        for (int k = 0; k < 4; ++k)
+        {
+            direction[k] = (float)(palette[15][k] - palette[0][k]);
+            lengthSquared += direction[k] * direction[k];
+        }
+
+        float total = 0.0f;
+        for (int i = 0; i < 16; ++i)
+        {
+            int guess = 0;
+            if (lengthSquared > 0.0f)
+            {
+                float t = 0.0f;
+                for (int k = 0; k < 4; ++k)
+                    t += (pixels[i][k] - palette[0][k]) * direction[k];
+                guess = std::min(15, std::max(0, (int)(t / lengthSquared * 15.0f + 0.5f)));
+            }
+            int best = guess;
+            float bestError = 1e30f;
+            for (int entry = std::max(0, guess - 1); entry <= std::min(15, guess + 1); ++entry)
+            {
+                float error = 0.0f;
+                for (int k = 0; k < 4; ++k)
+                {
+                    float d = pixels[i][k] - palette[entry][k];
+                    error += d * d;
+                }
+                if (error < bestError)
+                {
+                    bestError = error;
+                    best = entry;
+                }
+            }
+            indices[i] = best;
+            total += bestError;
+        }
+        return total;
+    }
+
+    // the four p-bit combinations of one pair of endpoints; returns the best error
+    inline float BestBc7Quantization(const float pixels[16][4], const float first[4], const float second[4], Bc7Endpoints& best, int bestIndices[16])
+    {
+        float bestError = 1e30f;
+        for (int p = 0; p < 4; ++p)
+        {
+            Bc7Endpoints endpoints;
+            int indices[16];
+            QuantizeBc7(first, second, p & 1, p >> 1, endpoints);
+            float error = Bc7Indices(pixels, endpoints, indices);
+            if (p == 0 || error < bestError)
+            {
+                bestError = error;
+                best = endpoints;
+                memcpy(bestIndices, indices, sizeof(indices));
+            }
+        }
+        return bestError;
+    }
+
+    struct BitWriter
+    {
+        uint64_t bits[2] = {};
+        int position = 0;
+
+        void Write(uint32_t value, int count)
+        {
+            for (int i = 0; i < count; ++i, ++position)
+                bits[position >> 6] |= (uint64_t)((value >> i) & 1) << (position & 63);
+        }
+    };
+}
+
+// Encodes one 4x4 block of RGBA pixels (alpha ignored) into 8 bytes of BC1
+inline void EncodeBc1Block(const float pixels[16][4], unsigned char out[8])
+{
+    using namespace texturecache_detail;
+    float first[4], second[4], weights[16];
+    PrincipalEndpoints(pixels, 3, first, second);
+    float error = EncodeBc1Endpoints(pixels, first, second, out, weights);
+
+    unsigned char refined[8];
+    float refinedWeights[16];
+    if (FitEndpoints(pixels, weights, 3, first, second) && EncodeBc1Endpoints(pixels, first, second, refined, refinedWeights) < error)
+        memcpy(out, refined, 8);
+}
+
+// Encodes one 4x4 block of RGBA pixels into 16 bytes of BC7 mode 6
+inline void EncodeBc7Block(const float pixels[16][4], unsigned char out[16])
+{
+    using namespace texturecache_detail;
+    float first[4], second[4];
+    PrincipalEndpoints(pixels, 4, first, second);
+    Bc7Endpoints endpoints;
+    int indices[16];
+    float error = BestBc7Quantization(pixels, first, second, endpoints, indices);
+
+    float weights[16];
+    for (int i = 0; i < 16; ++i)
+        weights[i] = Bc7Weights[indices[i]] / 64.0f;
+    if (FitEndpoints(pixels, weights, 4, first, second))
+    {
+        Bc7Endpoints refined;
+        int refinedIndices[16];
+        if (BestBc7Quantization(pixels, first, second, refined, refinedIndices) < error)
+        {
+            endpoints = refined;
+            memcpy(indices, refinedIndices, sizeof(indices));
+        }
+    }
+
+    // the first index is stored without its top bit, so it must be below 8
+    if (indices[0] >= 8)
+    {
+        std::swap(endpoints.quantized[0], endpoints.quantized[1]);
+        std::swap(endpoints.pbits[0], endpoints.pbits[1]);
+        for (int i = 0; i < 16; ++i)
+            indices[i] = 15 - indices[i];
+    }
+
+    BitWriter writer;
+    writer.Write(1u << 6, 7); // mode 6
+    for (int k = 0; k < 4; ++k)
+    {
+        writer.Write(endpoints.quantized[0][k], 7);
+        writer.Write(endpoints.quantized[1][k], 7);
+    }
+    writer.Write(endpoints.pbits[0], 1);
+    writer.Write(endpoints.pbits[1], 1);
+    writer.Write(indices[0], 3);
+    for (int i = 1; i < 16; ++i)
+        writer.Write(indices[i], 4);
+    for (int b = 0; b < 16; ++b)
+        out[b] = (unsigned char)(writer.bits[b >> 3] >> (8 * (b & 7)));
+}
+
+// Encodes a whole RGBA image, appending it to out; partial blocks at the right and top edges repeat the last
+// row and column
+inline void CompressImage(const unsigned char* rgba, int width, int height, TextureCompression compression, ThreadPool* pool,
+    std::vector<unsigned char>& out)
+{
+    int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    size_t blockBytes = TextureCompressionBlockBytes(compression);
+    size_t start = out.size();
+    out.resize(start + (size_t)blocksX * blocksY * blockBytes);
+    unsigned char* blocks = &out[start];
+    auto encodeRows = [&](size_t begin, size_t end, unsigned)
+    {
+        for (int blockY = (int)begin; blockY < (int)end; ++blockY)
+        {
+            for (int blockX = 0; blockX < blocksX; ++blockX)
+            {
+                float pixels[16][4];
+                texturecache_detail::LoadBlock(rgba, width, height, blockX, blockY, pixels);
+                unsigned char* block = blocks + ((size_t)blockY * blocksX + blockX) * blockBytes;
+                if (compression == TEXTURE_COMPRESSION_BC1)
+                    EncodeBc1Block(pixels, block);
+                else
+                    EncodeBc7Block(pixels, block);
+            }
+        }
+    };
+    if (pool)
+        pool->ParallelFor((size_t)blocksY, encodeRows);
+    else
+        encodeRows(0, (size_t)blocksY, 0);
+}
+
+// Encodes an RGBA image whose rows are already bottom-up and the mip levels below it
+inline void BuildCompressedTexture(const unsigned char* rgba, int width, int height, const std::vector<MipLevel>& mips,
+    TextureCompression compression, MipFilter mipFilter, ThreadPool* pool, TextureLevels& texture)
+{
+    texture.compression = compression;
+    texture.mipFilter = mipFilter;
+    texture.layout = IMAGE_LAYOUT_RGBA;
+    texture.width = width;
+    texture.height = height;
+    texture.data.clear();
+    texture.mapped = nullptr;
+    texture.levelOffsets.clear();
+    texture.levelSizes.clear();
+
+    for (size_t level = 0; level <= mips.size(); ++level)
+    {
+        size_t offset = texture.data.size();
+        if (level == 0)
+            CompressImage(rgba, width, height, compression, pool, texture.data);
+        else
+            CompressImage(mips[level - 1].pixels.data(), mips[level - 1].width, mips[level - 1].height, compression, pool, texture.data);
+        texture.levelOffsets.push_back(offset);
+        texture.levelSizes.push_back(texture.data.size() - offset);
+    }
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------
+// Cache files
+
+// FNV-1a of the file's bytes; false when it cannot be read
+inline bool HashFile(const std::string& path, uint64_t& hash)
+{
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file)
+        return false;
+    hash = 14695981039346656037ull;
+    unsigned char buffer[65536];
+    size_t count;
+    while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        for (size_t i = 0; i < count; ++i)
+            hash = (hash ^ buffer[i]) * 1099511628211ull;
+    }
+    fclose(file);
+    return true;
+}
+
+// wood.jpg -> wood.jpg.bc7, or wood.jpg.1024x1024.bc7 for levels resampled to a size of their own
+inline std::string TextureCachePath(const std::string& source, TextureCompression compression, int width = 0, int height = 0)
+{
+    std::string size = width > 0 ? "." + std::to_string(width) + "x" + std::to_string(height) : "";
+    return source + size + "." + TextureCompressionName(compression);
+}
+
+namespace texturecache_detail
+{
+    const char CacheMagic[4] = { 'D', 'T', 'E', 'X' };
+    const uint32_t CacheVersion = 5;
+    const uint32_t MaxCacheDimension = 16384;    // largest width or height a cache file may claim
+
+    struct CacheHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t compression;
+        uint32_t mipFilter;
+        uint32_t layout;
+        uint32_t premultipliedAlpha;
+        uint32_t width, height, levels;
+        uint32_t padding;
+        uint64_t sourceHash;
+    };
+
+    inline bool ValidHeader(const CacheHeader& header)
+    {
+        return memcmp(header.magic, CacheMagic, 4) == 0 && header.version == CacheVersion
+            && header.compression <= TEXTURE_COMPRESSION_BC7 && header.mipFilter <= MIP_FILTER_LANCZOS
+            && header.layout <= IMAGE_LAYOUT_BGRA && header.premultipliedAlpha <= 1 && header.levels > 0 && header.levels <= 32
+            && header.width > 0 && header.width <= MaxCacheDimension && header.height > 0 && header.height <= MaxCacheDimension;
+    }
+
+    // level sizes follow the header; the levels themselves start on a 64-byte boundary
+    inline size_t LevelDataOffset(uint32_t levels)
+    {
+        return (sizeof(CacheHeader) + levels * sizeof(uint32_t) + 63) & ~(size_t)63;
+    }
+
+    // false when a stored level size is not the one its dimensions and format imply, since uploads read the latter
+    inline bool SetLevels(const CacheHeader& header, const uint32_t* sizes, TextureLevels& texture)
+    {
+        texture.compression = (TextureCompression)header.compression;
+        texture.mipFilter = (MipFilter)header.mipFilter;
+        texture.layout = (ImageLayout)header.layout;
+        texture.premultipliedAlpha = header.premultipliedAlpha != 0;
+        texture.width = (int)header.width;
+        texture.height = (int)header.height;
+        texture.levelOffsets.clear();
+        texture.levelSizes.clear();
+        size_t total = 0;
+        for (uint32_t level = 0; level < header.levels; ++level)
+        {
+            if (sizes[level] != texture.ExpectedLevelSize((int)level))
+                return false;
+            texture.levelOffsets.push_back(total);
+            texture.levelSizes.push_back(sizes[level]);
+            total += sizes[level];
+        }
+        return true;
+    }
+}
+
+// The form cache files and asset packs store textures in: a header, the level sizes, then every level
+inline void SerializeTextureLevels(const TextureLevels& texture, uint64_t sourceHash, std::vector<unsigned char>& bytes)
+{
+    using namespace texturecache_detail;
+    CacheHeader header = {};
+    memcpy(header.magic, CacheMagic, 4);
+    header.version = CacheVersion;
+    header.compression = (uint32_t)texture.compression;
+    header.mipFilter = (uint32_t)texture.mipFilter;
+    header.layout = (uint32_t)texture.layout;
+    header.premultipliedAlpha = texture.premultipliedAlpha ? 1 : 0;
+    header.width = (uint32_t)texture.width;
+    header.height = (uint32_t)texture.height;
+    header.levels = (uint32_t)texture.LevelCount();
+    header.sourceHash = sourceHash;
+
+    size_t dataOffset = LevelDataOffset(header.levels);
+    bytes.assign(dataOffset + texture.ByteCount(), 0);
+    memcpy(bytes.data(), &header, sizeof(header));
+    for (int level = 0; level < texture.LevelCount(); ++level)
+    {
+        uint32_t size = (uint32_t)texture.levelSizes[level];
+        memcpy(&bytes[sizeof(header) + level * sizeof(uint32_t)], &size, sizeof(size));
+        memcpy(&bytes[dataOffset + texture.levelOffsets[level]], texture.LevelData(level), size);
+    }
+}
+
+// Points texture at serialized levels in memory that outlives it (a mapped asset pack) without copying them;
+// false when bytes do not hold a complete texture
+inline bool MapTextureLevels(const unsigned char* bytes, size_t size, TextureLevels& texture)
+{
+    using namespace texturecache_detail;
+    CacheHeader header;
+    if (size < sizeof(header))
+        return false;
+    memcpy(&header, bytes, sizeof(header));
+    if (!ValidHeader(header) || size < LevelDataOffset(header.levels))
+        return false;
+    uint32_t sizes[32];
+    memcpy(sizes, bytes + sizeof(header), header.levels * sizeof(uint32_t));
+    if (!SetLevels(header, sizes, texture) || texture.ByteCount() > size - LevelDataOffset(header.levels))
+        return false;
+    texture.data.clear();
+    texture.mapped = bytes + LevelDataOffset(header.levels);
+    return true;
+}
+
+// Reads a cache file written for this source hash, compression and mip filter; false when missing or stale
+inline bool ReadTextureCache(const std::string& path, uint64_t sourceHash, TextureCompression compression, MipFilter mipFilter,
+    bool premultipliedAlpha, TextureLevels& texture)
+{
+    using namespace texturecache_detail;
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file)
+        return false;
+
+    CacheHeader header;
+    bool valid = fread(&header, sizeof(header), 1, file) == 1 && ValidHeader(header)
+        && header.compression == (uint32_t)compression && header.mipFilter == (uint32_t)mipFilter
+        && header.premultipliedAlpha == (premultipliedAlpha ? 1u : 0u) && header.sourceHash == sourceHash;
+    std::vector<uint32_t> sizes(valid ? header.levels : 0);
+    valid = valid && fread(sizes.data(), sizeof(uint32_t), sizes.size(), file) == sizes.size()
+        && fseek(file, (long)LevelDataOffset(header.levels), SEEK_SET) == 0;
+    valid = valid && SetLevels(header, sizes.data(), texture);
+    if (valid)
+    {
+        texture.mapped = nullptr;
+        texture.data.resize(texture.ByteCount());
+        valid = fread(texture.data.data(), 1, texture.data.size(), file) == texture.data.size();
+    }
+    fclose(file);
+    return valid;
+}
+
+// Writes path + ".tmp" and renames it over path, so an interrupted run never leaves a truncated file behind a
+// matching source hash
+inline bool WriteTextureCache(const std::string& path, uint64_t sourceHash, const TextureLevels& texture)
+{
+    std::string temporary = path + ".tmp";
+    FILE* file = fopen(temporary.c_str(), "wb");
+    if (!file)
+        return false;
+
+    std::vector<unsigned char> bytes;
+    SerializeTextureLevels(texture, sourceHash, bytes);
+    bool written = fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    written = fclose(file) == 0 && written;
+#ifdef _WIN32
+    if (written)
+        remove(path.c_str()); // rename does not replace an existing file on Windows
+#endif
+    if (!written || rename(temporary.c_str(), path.c_str()) != 0)
+    {
+        remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+#endif
@@ -0,0 +1,590 @@
+#pragma once
+/* Asynchronous texture streaming.
+
+TextureStreamer loads image files without stalling the GL thread. Each
+texture goes through four stages:
+  1. a worker decodes the file (stbi_load) and prepares every level:
+     - it converts the image in one pass per row (imageops.h): rows flipped
+       for OpenGL, RGB expanded to 4 bytes in the layout the driver reported
+       as preferred for GL_RGBA8 (glGetInternalformativ), alpha premultiplied
+       in linear light when SetPremultiplyAlpha() asked for it
+     - it builds the mip chain in linear light (mipgen.h), its passes split
+       across the pool
+     - with compression set, it reads the block compressed levels from the
+       texture's cache file instead, building and writing the cache first
+       when it is missing or stale (texturecache.h)
+  2. the GL thread reserves room for the levels in a staging ring, one
+     persistently mapped GL_PIXEL_UNPACK_BUFFER (glBufferStorage)
+  3. a worker copies the levels into the ring
+  4. the GL thread creates immutable storage (glTexStorage2D), uploads each
+     level from its ring offset (glTexSubImage2D or
+     glCompressedTexSubImage2D) and fences the copy; the ring space is
+     recycled once the fence signals
+No mipmaps are generated on the GL thread, so the filtering is the same on
+every driver.
+
+Update() advances every texture as far as it can without waiting and
+uploads at most one per call, so it can run once per frame and textures
+arrive while the scene is already rendering. Finish() waits for everything,
+for runs that need all textures in place.
+
+Without GL 4.4 / ARB_buffer_storage, and for textures larger than the ring,
+stage 3 is skipped and stage 4 uploads from client memory.
+
+With a texture array or atlas set (texturearray.h), stage 1 resamples each
+image to the array's layer size first, and stage 4 uploads into the layer
+or atlas region of the texture's slot instead of creating a texture; atlas
+uploads always come from client memory, since the gutter around each
+region is filled on the way.
+
+Textures mapped from an asset pack (assetpack.h) skip stages 1 to 3: their
+levels are already prepared, so stage 4 uploads them straight from the
+mapping.
+*/
+
+#ifndef TEXTURESTREAM_H
+#define TEXTURESTREAM_H
+
+#include <GL/glew.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "imageops.h"
+#include "mipgen.h"
+#include "stb_image.h"
+#include "texturearray.h"
+#include "texturecache.h"
+#include "threadpool.h"
+
+
+// A texture that finished streaming; texture is 0 when the file could not be loaded, the array or atlas
+// texture when there is one
+struct StreamedTexture
+{
+    int slot;
+    GLuint texture;
+};
+
+class TextureStreamer
+{
+public:
+    // stagingBytes is the size of the persistently mapped ring; returns false when there is no ring
+    // (no buffer storage, or it could not be mapped) and every texture takes the client memory path
+    bool Create(ThreadPool& pool, size_t stagingBytes)
+    {
+        mPool = &pool;
+        mCapacity = 0;
+
+        // uploads in the driver's own order skip a swizzle on its side; BGRA is common on desktop drivers
+        GLint format = GL_RGBA, type = GL_UNSIGNED_BYTE;
+        if (GLEW_VERSION_4_3 || GLEW_ARB_internalformat_query2)
+        {
+            glGetInternalformativ(GL_TEXTURE_2D, GL_RGBA8, GL_TEXTURE_IMAGE_FORMAT, 1, &format);
+            glGetInternalformativ(GL_TEXTURE_2D, GL_RGBA8, GL_TEXTURE_IMAGE_TYPE, 1, &type);
+        }
+        mUploadLayout = format == GL_BGRA ? IMAGE_LAYOUT_BGRA : IMAGE_LAYOUT_RGBA;
+        // both keep the bytes in memory order on little-endian machines
+        mUploadType = type == GL_UNSIGNED_INT_8_8_8_8_REV ? GL_UNSIGNED_INT_8_8_8_8_REV : GL_UNSIGNED_BYTE;
+
+        if (!(GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage) || stagingBytes == 0)
+            return false;
+
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glGenBuffers(1, &mBuffer);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, mBuffer);
+        glBufferStorage(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)stagingBytes, nullptr, flags);
+        mMapped = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)stagingBytes, flags);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        if (!mMapped)
+        {
+            std::cout << "ERROR::TEXTURE_STREAMER::STAGING_BUFFER_MAP_FAILED" << std::endl;
+            glDeleteBuffers(1, &mBuffer);
+            mBuffer = 0;
+            return false;
+        }
+        mCapacity = stagingBytes;
+        return true;
+    }
+
+    // block compression for the textures requested from now on; the GL must support the format
+    void SetCompression(TextureCompression compression) { mCompression = compression; }
+    // filter that reduces the mip levels of the textures requested from now on
+    void SetMipFilter(MipFilter filter) { mMipFilter = filter; }
+    // premultiplies the color of RGBA files requested from now on by their alpha; off for opaque scenes
+    void SetPremultiplyAlpha(bool premultiply) { mPremultiplyAlpha = premultiply; }
+    // textures requested from now on become layers of array, their slot is the layer; nullptr for textures of their own
+    void SetArray(TextureArray* array) { mArray = array; }
+    // textures requested from now on are packed into atlas at their own size, in their slot's region
+    void SetAtlas(TextureAtlas* atlas) { mAtlas = atlas; }
+
+    // queues a file for streaming; slot comes back in StreamedTexture
+    void Request(int slot, const std::string& filename)
+    {
+        std::shared_ptr<Job> job = std::make_shared<Job>();
+        job->slot = slot;
+        job->filename = filename;
+        job->compression = mCompression;
+        job->mipFilter = mMipFilter;
+        job->premultiplyAlpha = mPremultiplyAlpha;
+        job->layout = mUploadLayout;
+        SetTargetSize(*job);
+        Job* decoding = job.get();
+        ThreadPool* pool = mPool;
+        job->work = mPool->Submit([decoding, pool]() { Load(*decoding, *pool); });
+        mJobs.push_back(job);
+    }
+
+    // queues a texture whose levels are serialized at bytes (texturecache.h), which must stay mapped until it is
+    // uploaded; false when they are not compressed and filtered as set here, and the file should be requested instead
+    bool RequestMapped(int slot, const std::string& filename, const unsigned char* bytes, size_t size)
+    {
+        std::shared_ptr<Job> job = std::make_shared<Job>();
+        if (!MapTextureLevels(bytes, size, job->levels) || job->levels.compression != mCompression || job->levels.mipFilter != mMipFilter
+            || job->levels.premultipliedAlpha != mPremultiplyAlpha
+            || (mArray && !mArray->Accepts(job->levels)))
+            return false;
+        job->slot = slot;
+        job->filename = filename;
+        job->compression = mCompression;
+        job->mipFilter = mMipFilter;
+        job->premultiplyAlpha = mPremultiplyAlpha;
+        job->layout = job->levels.layout;
+        job->channels = 4;
+        job->bytes = job->levels.ByteCount();
+        job->stage = STAGE_COPYING;
+        mJobs.push_back(job);
+        return true;
+    }
+
+    // stage 1 on the calling thread: every level of the file as it would be uploaded, e.g. to write an asset pack;
+    // false when the file could not be loaded
+    bool LoadLevels(const std::string& filename, TextureLevels& levels)
+    {
+        Job job;
+        job.filename = filename;
+        job.compression = mCompression;
+        job.mipFilter = mMipFilter;
+        job.premultiplyAlpha = mPremultiplyAlpha;
+        job.layout = mUploadLayout;
+        SetTargetSize(job);
+        Load(job, *mPool);
+        levels = std::move(job.levels);
+        return levels.LevelCount() > 0;
+    }
+
+    // advances every texture without blocking and uploads at most one, appending it to finished once ready
+    void Update(std::vector<StreamedTexture>& finished)
+    {
+        auto start = std::chrono::steady_clock::now();
+        RecycleStaging(false);
+
+        bool uploaded = false;
+        for (size_t i = 0; i < mJobs.size();)
+        {
+            Job& job = *mJobs[i];
+            bool busy = job.work.valid() && job.work.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+            if (busy || (job.stage == STAGE_COPYING && uploaded))
+            {
+                ++i;
+                continue;
+            }
+            if (job.work.valid())
+                job.work.get();
+
+            if (job.stage == STAGE_DECODING)
+            {
+                if (!Stage(job))
+                {
+                    ++i; // no room in the ring yet, try again next update
+                    continue;
+                }
+            }
+            else
+            {
+                finished.push_back({ job.slot, Upload(job) });
+                uploaded = true;
+                mJobs.erase(mJobs.begin() + i);
+                continue;
+            }
+            ++i;
+        }
+
+        mLongestUpdate = std::max(mLongestUpdate, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    // streams everything still queued, waiting on the workers and the GPU as needed
+    void Finish(std::vector<StreamedTexture>& finished)
+    {
+        while (!mJobs.empty())
+        {
+            Update(finished);
+            if (mJobs.empty())
+                break;
+            // a staged job may be waiting for ring space held by an unsignaled fence
+            RecycleStaging(true);
+            for (const std::shared_ptr<Job>& job : mJobs)
+            {
+                if (job->work.valid())
+                    job->work.wait();
+            }
+        }
+    }
+
+    bool Idle() const { return mJobs.empty(); }
+
+    // textures uploaded, how many went through the ring, bytes uploaded and the slowest Update() so far
+    size_t TexturesStreamed() const { return mTexturesStreamed; }
+    size_t TexturesStaged() const { return mTexturesStaged; }
+    // compressed textures read from their cache files and those encoded because the cache was missing or stale
+    size_t TexturesFromCache() const { return mTexturesFromCache; }
+    size_t TexturesEncoded() const { return mTexturesEncoded; }
+    // textures uploaded straight from an asset pack's mapping
+    size_t TexturesMapped() const { return mTexturesMapped; }
+    size_t BytesStreamed() const { return mBytesStreamed; }
+    size_t StagingCapacity() const { return mCapacity; }
+    ImageLayout UploadLayout() const { return mUploadLayout; }
+    double LongestUpdateMilliseconds() const { return mLongestUpdate; }
+
+    // waits for outstanding work, then releases the ring
+    void Destroy()
+    {
+        for (const std::shared_ptr<Job>& job : mJobs)
+        {
+            if (job->work.valid())
+                job->work.wait();
+        }
+        mJobs.clear();
+        RecycleStaging(true);
+        // regions whose wait timed out, or that were never fenced, still hold a fence or ring space; deleting a
+        // fence that has not signalled is fine, GL keeps the buffer until the copies reading it are done
+        for (const StagingRegion& region : mRegions)
+        {
+            if (region.fence)
+                glDeleteSync(region.fence);
+        }
+        mRegions.clear();
+        mHead = 0;
+        if (mBuffer)
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, mBuffer);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            glDeleteBuffers(1, &mBuffer);
+        }
+        mBuffer = 0;
+        mMapped = nullptr;
+        mCapacity = 0;
+    }
+
+private:
+    enum JobStage { STAGE_DECODING, STAGE_COPYING };
+
+    struct Job
+    {
+        int slot = 0;
+        std::string filename;
+        TextureCompression compression = TEXTURE_COMPRESSION_NONE;
+        MipFilter mipFilter = MIP_FILTER_BOX;
+        bool premultiplyAlpha = false;
+        ImageLayout layout = IMAGE_LAYOUT_RGBA;
+        int targetWidth = 0, targetHeight = 0;   // base level size to resample to, 0 keeps the file's
+        int channels = 0;                   // of the decoded file, 0 when it could not be read
+        TextureLevels levels;               // bottom row first; data is emptied once copied into the ring
+        size_t bytes = 0;
+        bool fromCache = false;
+        bool cacheWriteFailed = false;
+        JobStage stage = STAGE_DECODING;
+        bool staged = false;                // the levels live in the ring at stagingOffset
+        size_t stagingOffset = 0;
+        std::future<void> work;             // the decode or the copy running on the pool
+    };
+
+    // ring space in use, oldest first; freed in order once its upload's fence signaled
+    struct StagingRegion
+    {
+        size_t offset;
+        size_t size;
+        GLsync fence;   // 0 while the copy has not been uploaded yet
+    };
+
+    ThreadPool* mPool = nullptr;
+    GLuint mBuffer = 0;
+    unsigned char* mMapped = nullptr;
+    size_t mCapacity = 0;
+    size_t mHead = 0;
+    std::deque<StagingRegion> mRegions;
+    std::vector<std::shared_ptr<Job>> mJobs;
+
+    TextureCompression mCompression = TEXTURE_COMPRESSION_NONE;
+    MipFilter mMipFilter = MIP_FILTER_KAISER;
+    bool mPremultiplyAlpha = false;
+    ImageLayout mUploadLayout = IMAGE_LAYOUT_RGBA;
+    TextureArray* mArray = nullptr;
+    TextureAtlas* mAtlas = nullptr;
+    GLenum mUploadType = GL_UNSIGNED_BYTE;
+
+    size_t mTexturesStreamed = 0;
+    size_t mTexturesStaged = 0;
+    size_t mTexturesFromCache = 0;
+    size_t mTexturesEncoded = 0;
+    size_t mTexturesMapped = 0;
+    size_t mBytesStreamed = 0;
+    double mLongestUpdate = 0.0;
+
+    // worker side of stage 1: every level of the texture in job.levels, or none when it could not be loaded
+    static void Load(Job& job, ThreadPool& pool)
+    {
+        uint64_t hash = 0;
+        std::string cachePath = TextureCachePath(job.filename, job.compression, job.targetWidth, job.targetHeight);
+        if (job.compression != TEXTURE_COMPRESSION_NONE && HashFile(job.filename, hash)
+            && ReadTextureCache(cachePath, hash, job.compression, job.mipFilter, job.premultiplyAlpha, job.levels))
+        {
+            job.fromCache = true;
+            job.channels = 4;
+            return;
+        }
+
+        int width, height;
+        unsigned char* pixels = stbi_load(job.filename.c_str(), &width, &height, &job.channels, 0);
+        if (!pixels)
+        {
+            job.channels = 0;
+            return;
+        }
+        if (job.channels != 3 && job.channels != 4)
+        {
+            stbi_image_free(pixels);
+            return;
+        }
+
+        // compressed textures are encoded from RGBA whatever the driver prefers for uploads
+        ImageLayout layout = job.compression == TEXTURE_COMPRESSION_NONE ? job.layout : IMAGE_LAYOUT_RGBA;
+        std::vector<unsigned char> base((size_t)width * height * 4);
+        ConvertImageRows(base.data(), pixels, width, height, job.channels, layout, job.premultiplyAlpha);
+        stbi_image_free(pixels);
+        if (job.targetWidth > 0 && (width != job.targetWidth || height != job.targetHeight))
+        {
+            std::vector<unsigned char> resampled;
+            ResampleImage(base.data(), width, height, job.targetWidth, job.targetHeight, job.mipFilter, &pool, resampled);
+            base.swap(resampled);
+            width = job.targetWidth;
+            height = job.targetHeight;
+        }
+        std::vector<MipLevel> mips;
+        BuildMipChain(base.data(), width, height, job.mipFilter, &pool, mips);
+
+        if (job.compression != TEXTURE_COMPRESSION_NONE)
+        {
+            BuildCompressedTexture(base.data(), width, height, mips, job.compression, job.mipFilter, &pool, job.levels);
+            job.levels.premultipliedAlpha = job.premultiplyAlpha;
+            job.cacheWriteFailed = !WriteTextureCache(cachePath, hash, job.levels);
+            return;
+        }
+
+        TextureLevels& levels = job.levels;
+        levels.compression = TEXTURE_COMPRESSION_NONE;
+        levels.mipFilter = job.mipFilter;
+        levels.premultipliedAlpha = job.premultiplyAlpha;
+        levels.layout = job.layout;
+        levels.width = width;
+        levels.height = height;
+        levels.data.swap(base);
+        levels.levelOffsets.assign(1, 0);
+        levels.levelSizes.assign(1, levels.data.size());
+        for (const MipLevel& mip : mips)
+        {
+            levels.levelOffsets.push_back(levels.data.size());
+            levels.levelSizes.push_back(mip.pixels.size());
+            levels.data.insert(levels.data.end(), mip.pixels.begin(), mip.pixels.end());
+        }
+    }
+
+    // reserves ring space for a loaded texture and starts copying its levels into it; false when the ring is full
+    bool Stage(Job& job)
+    {
+        job.stage = STAGE_COPYING;
+        job.bytes = job.levels.data.size();
+        if (job.levels.LevelCount() == 0 || mCapacity == 0 || job.bytes > mCapacity || mAtlas)
+            return true; // nothing to stage, or client memory path
+
+        size_t offset;
+        if (!Allocate(job.bytes, offset))
+        {
+            job.stage = STAGE_DECODING;
+            return false;
+        }
+        job.staged = true;
+        job.stagingOffset = offset;
+        Job* copying = &job;
+        unsigned char* destination = mMapped + offset;
+        job.work = mPool->Submit([copying, destination]()
+        {
+            memcpy(destination, copying->levels.data.data(), copying->bytes);
+            std::vector<unsigned char>().swap(copying->levels.data);
+        });
+        return true;
+    }
+
+    // creates the texture and uploads every level from the ring, from client memory or from the mapping; 0 on failure
+    GLuint Upload(Job& job)
+    {
+        const TextureLevels& levels = job.levels;
+        if (levels.LevelCount() == 0)
+        {
+            if (job.channels == 0)
+                std::cout << "Failed to load texture " << job.filename << std::endl;
+            else
+                std::cout << "Not implemented to handle image with " << job.channels << " channels" << std::endl;
+            return 0;
+        }
+        if (job.cacheWriteFailed)
+            std::cout << "Failed to write texture cache "
+                << TextureCachePath(job.filename, job.compression, job.targetWidth, job.targetHeight) << std::endl;
+
+        bool compressed = levels.compression != TEXTURE_COMPRESSION_NONE;
+        GLenum internalFormat = compressed ? TextureCompressionFormat(levels.compression) : GL_RGBA8;
+        GLuint texture = 0;
+        if (mArray && mArray->Accepts(levels))
+            texture = mArray->Texture();
+        else if (mAtlas && !compressed && mAtlas->Place(job.slot, levels.width, levels.height))
+            texture = mAtlas->Texture();
+        else if (mArray || mAtlas)
+        {
+            std::cout << "Failed to fit texture " << job.filename << " into the texture " << (mArray ? "array" : "atlas") << std::endl;
+            if (job.staged)
+                FenceStaging(job.stagingOffset);
+            return 0;
+        }
+        else
+        {
+            glGenTextures(1, &texture);
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glTexStorage2D(GL_TEXTURE_2D, levels.LevelCount(), internalFormat, levels.width, levels.height);
+            // set the texture wrapping parameters
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            // set texture filtering parameters; minification blends the two nearest levels of the uploaded chain
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        }
+
+        if (job.staged)
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, mBuffer);
+        int levelCount = mAtlas ? std::min(levels.LevelCount(), ATLAS_LEVELS) : levels.LevelCount();
+        for (int level = 0; level < levelCount; ++level)
+        {
+            const unsigned char* data = job.staged ? (const unsigned char*)(uintptr_t)(job.stagingOffset + levels.levelOffsets[level])
+                : levels.LevelData(level);
+            if (mArray)
+                mArray->UploadLevel(job.slot, level, levels, data, mUploadType);
+            else if (mAtlas)
+                mAtlas->UploadLevel(job.slot, level, levels, data, mUploadType);
+            else if (compressed)
+                glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, levels.LevelWidth(level), levels.LevelHeight(level),
+                    internalFormat, (GLsizei)levels.levelSizes[level], data);
+            else
+                glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, levels.LevelWidth(level), levels.LevelHeight(level),
+                    levels.layout == IMAGE_LAYOUT_BGRA ? GL_BGRA : GL_RGBA, mUploadType, data);
+        }
+        // a texture smaller than ATLAS_ALIGNMENT runs out of levels first; its 1x1 level fills the rest of its
+        // region's levels, which the atlas sampler still reads
+        if (mAtlas && levelCount > 0 && levels.LevelWidth(levelCount - 1) == 1 && levels.LevelHeight(levelCount - 1) == 1)
+        {
+            for (int level = levelCount; level < ATLAS_LEVELS; ++level)
+                mAtlas->UploadLevel(job.slot, level, levels, levels.LevelData(levelCount - 1), mUploadType);
+        }
+        if (job.staged)
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            FenceStaging(job.stagingOffset);
+            ++mTexturesStaged;
+        }
+        if (!mArray && !mAtlas)
+            glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
+
+        ++mTexturesStreamed;
+        if (levels.mapped)
+            ++mTexturesMapped;
+        else if (compressed && job.fromCache)
+            ++mTexturesFromCache;
+        else if (compressed)
+            ++mTexturesEncoded;
+        mBytesStreamed += job.bytes;
+        std::vector<unsigned char>().swap(job.levels.data);
+        return texture;
+    }
+
+    // resample to the array's layer size when there is one
+    void SetTargetSize(Job& job) const
+    {
+        job.targetWidth = mArray ? mArray->Width() : 0;
+        job.targetHeight = mArray ? mArray->Height() : 0;
+    }
+
+    // ring ranges are handed out in order; a reservation never straddles the end of the ring
+    bool Allocate(size_t bytes, size_t& offset)
+    {
+        bytes = (bytes + 63) & ~(size_t)63;
+        if (mRegions.empty())
+            mHead = 0;
+        else
+        {
+            size_t tail = mRegions.front().offset;
+            if (mHead > tail)
+            {
+                if (mHead + bytes > mCapacity)
+                {
+                    if (bytes > tail)
+                        return false;
+                    mHead = 0; // wrap
+                }
+            }
+            else if (mHead + bytes > tail)
+                return false;
+        }
+        if (mHead + bytes > mCapacity)
+            return false;
+
+        offset = mHead;
+        mRegions.push_back({ offset, bytes, 0 });
+        mHead += bytes;
+        return true;
+    }
+
+    // marks the region at offset free once the commands issued so far completed
+    void FenceStaging(size_t offset)
+    {
+        for (StagingRegion& region : mRegions)
+        {
+            if (region.offset == offset && !region.fence)
+            {
+                region.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+                break;
+            }
+        }
+    }
+
+    // frees ring space whose uploads completed; wait blocks on the GPU for every fenced region
+    void RecycleStaging(bool wait)
+    {
+        while (!mRegions.empty() && mRegions.front().fence)
+        {
+            GLsync fence = mRegions.front().fence;
+            GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? 1000000000ull : 0);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+                break;
+            glDeleteSync(fence);
+            mRegions.pop_front();
+        }
+    }
+};
+#endif
@@ -0,0 +1,150 @@
+#pragma once
+/* Fixed pool of worker threads.
+
+Submit() queues one job and returns a future for its result. ParallelFor()
+splits an index range into one chunk per thread, runs the chunks on the
+workers and on the calling thread, and returns once all of them finished.
+The queue is first in, first out, so a chunk may sit behind long jobs
+queued earlier (texture decodes, for instance). The caller therefore never
+waits for a chunk no worker has started: it claims such chunks back and runs
+them itself, and only waits for chunks already running. The render thread's
+loops cost at worst their own work, and nested parallel loops cannot end up
+waiting on chunks no thread is free to run. A chunk the caller took back is
+skipped when a worker reaches its queued job.
+A pool created with zero workers runs everything on the calling thread.
+*/
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+
+class ThreadPool
+{
+public:
+    // workers == -1 uses one worker per hardware thread besides the caller
+    explicit ThreadPool(int workers = -1)
+    {
+        if (workers < 0)
+            workers = std::max(1, (int)std::thread::hardware_concurrency()) - 1;
+        for (int i = 0; i < workers; ++i)
+            mWorkers.emplace_back([this]() { WorkerLoop(); });
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStopping = true;
+        }
+        mWake.notify_all();
+        for (std::thread& worker : mWorkers)
+            worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // threads that take part in ParallelFor, the caller included
+    unsigned ThreadCount() const { return (unsigned)mWorkers.size() + 1; }
+
+    template <typename Job>
+    auto Submit(Job job) -> std::future<decltype(job())>
+    {
+        typedef decltype(job()) Result;
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::move(job));
+        std::future<Result> result = task->get_future();
+        if (mWorkers.empty())
+        {
+            (*task)();
+            return result;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mJobs.push([task]() { (*task)(); });
+        }
+        mWake.notify_one();
+        return result;
+    }
+
+    // calls body(begin, end, chunk) for consecutive chunks of [0, count), chunk < ThreadCount()
+    void ParallelFor(size_t count, const std::function<void(size_t, size_t, unsigned)>& body)
+    {
+        unsigned chunks = (unsigned)std::min<size_t>(ThreadCount(), count);
+        if (chunks <= 1)
+        {
+            if (count > 0)
+                body(0, count, 0);
+            return;
+        }
+
+        // whoever flips a chunk's flag first runs it, a worker that picks up its job or the caller taking it back
+        std::shared_ptr<std::atomic<bool>> claimed(new std::atomic<bool>[chunks], std::default_delete<std::atomic<bool>[]>());
+        for (unsigned chunk = 0; chunk < chunks; ++chunk)
+            claimed.get()[chunk] = false;
+
+        std::vector<std::future<void>> pending(chunks);
+        size_t chunkSize = (count + chunks - 1) / chunks;
+        for (unsigned chunk = 1; chunk < chunks; ++chunk)
+        {
+            size_t begin = chunk * chunkSize;
+            size_t end = std::min(count, begin + chunkSize);
+            if (begin < end)
+            {
+                // body is only touched after winning the claim, while the caller is still waiting for it
+                pending[chunk] = Submit([&body, claimed, begin, end, chunk]()
+                {
+                    if (!claimed.get()[chunk].exchange(true))
+                        body(begin, end, chunk);
+                });
+            }
+        }
+        body(0, std::min(count, chunkSize), 0);
+        for (unsigned chunk = 1; chunk < chunks; ++chunk)
+        {
+            size_t begin = chunk * chunkSize;
+            size_t end = std::min(count, begin + chunkSize);
+            if (begin >= end)
+                continue;
+            if (!claimed.get()[chunk].exchange(true))
+                body(begin, end, chunk);
+            else
+                pending[chunk].get(); // a worker is running it
+        }
+    }
+
+private:
+    std::vector<std::thread> mWorkers;
+    std::queue<std::function<void()>> mJobs;
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    bool mStopping = false;
+
+    void WorkerLoop()
+    {
+        for (;;)
+        {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mWake.wait(lock, [this]() { return mStopping || !mJobs.empty(); });
+                if (mStopping && mJobs.empty())
+                    return;
+                job = std::move(mJobs.front());
+                mJobs.pop();
+            }
+            job();
+        }
+    }
+};
+#endif
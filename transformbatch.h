@@ -0,0 +1,460 @@
+#pragma once
+/* Batch transform kernels for many objects at once.
+
+Local transforms are stored structure-of-arrays (TransformSoA), so one SIMD
+register holds the same component of 4 (SSE) or 8 (AVX2) objects. Matrices
+are regular column-major glm::mat4 arrays, so results can be copied straight
+into GPU buffers.
+
+    ComposeLocalMatrices    translation * rotation * scale from SoA TRS
+    MultiplyMatrices        out[i] = a[i] * b[i]        (parent * local)
+    PremultiplyMatrices     out[i] = m * b[i]           (viewProjection * world)
+    ComputeNormalMatrices   out[i] = transpose(inverse(mat3(world[i])))
+
+The instruction set is picked at compile time (see simd.h). The ...Scalar
+versions are always available for reference and benchmarking.
+*/
+
+#ifndef TRANSFORMBATCH_H
+#define TRANSFORMBATCH_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#include "simd.h"
+
+
+// Local translation/rotation/scale of many objects, one array per component
+struct TransformSoA
+{
+    std::vector<float> px, py, pz;
+    std::vector<float> qx, qy, qz, qw;
+    std::vector<float> sx, sy, sz;
+
+    size_t Size() const { return px.size(); }
+
+    void Resize(size_t count)
+    {
+        px.resize(count); py.resize(count); pz.resize(count);
+        qx.resize(count); qy.resize(count); qz.resize(count); qw.resize(count, 1.0f);
+        sx.resize(count, 1.0f); sy.resize(count, 1.0f); sz.resize(count, 1.0f);
+    }
+
+    void Set(size_t i, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale)
+    {
+        px[i] = position.x; py[i] = position.y; pz[i] = position.z;
+        qx[i] = rotation.x; qy[i] = rotation.y; qz[i] = rotation.z; qw[i] = rotation.w;
+        sx[i] = scale.x; sy[i] = scale.y; sz[i] = scale.z;
+    }
+
+    void Push(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale)
+    {
+        Resize(Size() + 1);
+        Set(Size() - 1, position, rotation, scale);
+    }
+
+    glm::vec3 Position(size_t i) const { return glm::vec3(px[i], py[i], pz[i]); }
+    glm::quat Rotation(size_t i) const { return glm::quat(qw[i], qx[i], qy[i], qz[i]); }
+    glm::vec3 Scale(size_t i) const { return glm::vec3(sx[i], sy[i], sz[i]); }
+};
+
+// mat3 as laid out by std140/std430: three vec4 columns, w unused
+struct NormalMatrix
+{
+    glm::vec4 columns[3];
+};
+
+
+// Scalar reference kernels, also used for the tail of the SIMD loops
+
+inline void ComposeLocalMatricesScalar(const TransformSoA& trs, size_t first, size_t count, glm::mat4* out)
+{
+    for (size_t n = 0; n < count; ++n)
+    {
+        size_t i = first + n;
+        float x = trs.qx[i], y = trs.qy[i], z = trs.qz[i], w = trs.qw[i];
+        float* m = &out[n][0][0];
+        m[0] = (1.0f - 2.0f * (y * y + z * z)) * trs.sx[i];
+        m[1] = 2.0f * (x * y + w * z) * trs.sx[i];
+        m[2] = 2.0f * (x * z - w * y) * trs.sx[i];
+        m[3] = 0.0f;
+        m[4] = 2.0f * (x * y - w * z) * trs.sy[i];
+        m[5] = (1.0f - 2.0f * (x * x + z * z)) * trs.sy[i];
+        m[6] = 2.0f * (y * z + w * x) * trs.sy[i];
+        m[7] = 0.0f;
+        m[8] = 2.0f * (x * z + w * y) * trs.sz[i];
+        m[9] = 2.0f * (y * z - w * x) * trs.sz[i];
+        m[10] = (1.0f - 2.0f * (x * x + y * y)) * trs.sz[i];
+        m[11] = 0.0f;
+        m[12] = trs.px[i];
+        m[13] = trs.py[i];
+        m[14] = trs.pz[i];
+        m[15] = 1.0f;
+    }
+}
+
+inline void MultiplyMatrixScalar(const float* a, const float* b, float* out)
+{
+    for (int column = 0; column < 4; ++column)
+    {
+        const float* bc = b + column * 4;
+        for (int row = 0; row < 4; ++row)
+            out[column * 4 + row] = a[row] * bc[0] + a[4 + row] * bc[1] + a[8 + row] * bc[2] + a[12 + row] * bc[3];
+    }
+}
+
+inline void MultiplyMatricesScalar(const glm::mat4* a, const glm::mat4* b, glm::mat4* out, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        float result[16];
+        MultiplyMatrixScalar(&a[i][0][0], &b[i][0][0], result);
+        memcpy(&out[i][0][0], result, sizeof(result));
+    }
+}
+
+inline void PremultiplyMatricesScalar(const glm::mat4& m, const glm::mat4* b, glm::mat4* out, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        float result[16];
+        MultiplyMatrixScalar(&m[0][0], &b[i][0][0], result);
+        memcpy(&out[i][0][0], result, sizeof(result));
+    }
+}
+
+// columns of the inverse transpose are the cross products of the other two columns over the determinant
+inline void ComputeNormalMatricesScalar(const glm::mat4* world, NormalMatrix* out, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        const float* m = &world[i][0][0];
+        glm::vec3 c0(m[0], m[1], m[2]), c1(m[4], m[5], m[6]), c2(m[8], m[9], m[10]);
+        glm::vec3 r0 = glm::cross(c1, c2), r1 = glm::cross(c2, c0), r2 = glm::cross(c0, c1);
+        float determinant = glm::dot(c0, r0);
+        float inverse = determinant != 0.0f ? 1.0f / determinant : 0.0f;
+        out[i].columns[0] = glm::vec4(r0 * inverse, 0.0f);
+        out[i].columns[1] = glm::vec4(r1 * inverse, 0.0f);
+        out[i].columns[2] = glm::vec4(r2 * inverse, 0.0f);
+    }
+}
+
+
+#if defined(SIMD_AVX2)
+
+// 4x4 transposes within each 128-bit half: half 0 holds objects 0..3, half 1 objects 4..7
+#define TRANSFORM_BATCH_TRANSPOSE(r0, r1, r2, r3)                       \
+    {                                                                   \
+        __m256 t0 = _mm256_unpacklo_ps(r0, r1);                         \
+        __m256 t1 = _mm256_unpackhi_ps(r0, r1);                         \
+        __m256 t2 = _mm256_unpacklo_ps(r2, r3);                         \
+        __m256 t3 = _mm256_unpackhi_ps(r2, r3);                         \
+        r0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));        \
+        r1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));        \
+        r2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));        \
+        r3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));        \
+    }
+
+#if defined(__FMA__)
+#define TRANSFORM_BATCH_MADD(a, b, c) _mm256_fmadd_ps(a, b, c)
+#else
+#define TRANSFORM_BATCH_MADD(a, b, c) _mm256_add_ps(_mm256_mul_ps(a, b), c)
+#endif
+
+// stores transposed rows as column `column` of objects out[0..3] and out[4..7]
+inline void StoreColumns(glm::mat4* out, int column, __m256 r0, __m256 r1, __m256 r2, __m256 r3)
+{
+    _mm_storeu_ps(&out[0][column][0], _mm256_castps256_ps128(r0));
+    _mm_storeu_ps(&out[1][column][0], _mm256_castps256_ps128(r1));
+    _mm_storeu_ps(&out[2][column][0], _mm256_castps256_ps128(r2));
+    _mm_storeu_ps(&out[3][column][0], _mm256_castps256_ps128(r3));
+    _mm_storeu_ps(&out[4][column][0], _mm256_extractf128_ps(r0, 1));
+    _mm_storeu_ps(&out[5][column][0], _mm256_extractf128_ps(r1, 1));
+    _mm_storeu_ps(&out[6][column][0], _mm256_extractf128_ps(r2, 1));
+    _mm_storeu_ps(&out[7][column][0], _mm256_extractf128_ps(r3, 1));
+}
+
+// loads column `column` of objects in[0..3] into half 0 and in[4..7] into half 1
+inline __m256 LoadColumnPair(const glm::mat4* in, size_t lane, int column)
+{
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(&in[lane][column][0])), _mm_loadu_ps(&in[lane + 4][column][0]), 1);
+}
+
+inline void ComposeLocalMatrices(const TransformSoA& trs, size_t first, size_t count, glm::mat4* out)
+{
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 two = _mm256_set1_ps(2.0f);
+    const __m256 zero = _mm256_setzero_ps();
+
+    size_t n = 0;
+    for (; n + 8 <= count; n += 8)
+    {
+        size_t i = first + n;
+        __m256 x = _mm256_loadu_ps(&trs.qx[i]), y = _mm256_loadu_ps(&trs.qy[i]);
+        __m256 z = _mm256_loadu_ps(&trs.qz[i]), w = _mm256_loadu_ps(&trs.qw[i]);
+        __m256 sx = _mm256_loadu_ps(&trs.sx[i]), sy = _mm256_loadu_ps(&trs.sy[i]), sz = _mm256_loadu_ps(&trs.sz[i]);
+
+        __m256 xx = _mm256_mul_ps(x, x), yy = _mm256_mul_ps(y, y), zz = _mm256_mul_ps(z, z);
+        __m256 xy = _mm256_mul_ps(x, y), xz = _mm256_mul_ps(x, z), yz = _mm256_mul_ps(y, z);
+        __m256 wx = _mm256_mul_ps(w, x), wy = _mm256_mul_ps(w, y), wz = _mm256_mul_ps(w, z);
+
+        __m256 m00 = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(yy, zz))), sx);
+        __m256 m01 = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xy, wz)), sx);
+        __m256 m02 = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xz, wy)), sx);
+        __m256 m10 = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xy, wz)), sy);
+        __m256 m11 = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, zz))), sy);
+        __m256 m12 = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(yz, wx)), sy);
+        __m256 m20 = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xz, wy)), sz);
+        __m256 m21 = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(yz, wx)), sz);
+        __m256 m22 = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, yy))), sz);
+        __m256 tx = _mm256_loadu_ps(&trs.px[i]), ty = _mm256_loadu_ps(&trs.py[i]), tz = _mm256_loadu_ps(&trs.pz[i]);
+        __m256 w0 = zero, w1 = zero, w2 = zero, w3 = one;
+
+        TRANSFORM_BATCH_TRANSPOSE(m00, m01, m02, w0);
+        StoreColumns(out + n, 0, m00, m01, m02, w0);
+        TRANSFORM_BATCH_TRANSPOSE(m10, m11, m12, w1);
+        StoreColumns(out + n, 1, m10, m11, m12, w1);
+        TRANSFORM_BATCH_TRANSPOSE(m20, m21, m22, w2);
+        StoreColumns(out + n, 2, m20, m21, m22, w2);
+        TRANSFORM_BATCH_TRANSPOSE(tx, ty, tz, w3);
+        StoreColumns(out + n, 3, tx, ty, tz, w3);
+    }
+    ComposeLocalMatricesScalar(trs, first + n, count - n, out + n);
+}
+
+// two columns of b per register; a's columns are broadcast to both halves
+inline void MultiplyColumns(const __m256 a[4], const float* b, float* out)
+{
+    for (int column = 0; column < 4; column += 2)
+    {
+        __m256 bc = _mm256_loadu_ps(b + column * 4);
+        __m256 result = _mm256_mul_ps(a[0], _mm256_permute_ps(bc, 0x00));
+        result = TRANSFORM_BATCH_MADD(a[1], _mm256_permute_ps(bc, 0x55), result);
+        result = TRANSFORM_BATCH_MADD(a[2], _mm256_permute_ps(bc, 0xAA), result);
+        result = TRANSFORM_BATCH_MADD(a[3], _mm256_permute_ps(bc, 0xFF), result);
+        _mm256_storeu_ps(out + column * 4, result);
+    }
+}
+
+inline void MultiplyMatrices(const glm::mat4* a, const glm::mat4* b, glm::mat4* out, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        const float* am = &a[i][0][0];
+        __m256 columns[4] = { _mm256_broadcast_ps((const __m128*)(am)), _mm256_broadcast_ps((const __m128*)(am + 4)),
+            _mm256_broadcast_ps((const __m128*)(am + 8)), _mm256_broadcast_ps((const __m128*)(am + 12)) };
+        MultiplyColumns(columns, &b[i][0][0], &out[i][0][0]);
+    }
+}
+
+inline void PremultiplyMatrices(const glm::mat4& m, const glm::mat4* b, glm::mat4* out, size_t count)
+{
+    const float* mm = &m[0][0];
+    __m256 columns[4] = { _mm256_broadcast_ps((const __m128*)(mm)), _mm256_broadcast_ps((const __m128*)(mm + 4)),
+        _mm256_broadcast_ps((const __m128*)(mm + 8)), _mm256_broadcast_ps((const __m128*)(mm + 12)) };
+    for (size_t i = 0; i < count; ++i)
+        MultiplyColumns(columns, &b[i][0][0], &out[i][0][0]);
+}
+
+inline void ComputeNormalMatrices(const glm::mat4* world, NormalMatrix* out, size_t count)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        // gather the upper 3x3 of 8 matrices as SoA: aXY is row Y of column X
+        __m256 a00 = LoadColumnPair(world, i, 0), a01 = LoadColumnPair(world, i + 1, 0);
+        __m256 a02 = LoadColumnPair(world, i + 2, 0), a03 = LoadColumnPair(world, i + 3, 0);
+        __m256 a10 = LoadColumnPair(world, i, 1), a11 = LoadColumnPair(world, i + 1, 1);
+        __m256 a12 = LoadColumnPair(world, i + 2, 1), a13 = LoadColumnPair(world, i + 3, 1);
+        __m256 a20 = LoadColumnPair(world, i, 2), a21 = LoadColumnPair(world, i + 1, 2);
+        __m256 a22 = LoadColumnPair(world, i + 2, 2), a23 = LoadColumnPair(world, i + 3, 2);
+        TRANSFORM_BATCH_TRANSPOSE(a00, a01, a02, a03);
+        TRANSFORM_BATCH_TRANSPOSE(a10, a11, a12, a13);
+        TRANSFORM_BATCH_TRANSPOSE(a20, a21, a22, a23);
+
+        // r0 = c1 x c2, r1 = c2 x c0, r2 = c0 x c1
+        __m256 r00 = _mm256_sub_ps(_mm256_mul_ps(a11, a22), _mm256_mul_ps(a12, a21));
+        __m256 r01 = _mm256_sub_ps(_mm256_mul_ps(a12, a20), _mm256_mul_ps(a10, a22));
+        __m256 r02 = _mm256_sub_ps(_mm256_mul_ps(a10, a21), _mm256_mul_ps(a11, a20));
+        __m256 r10 = _mm256_sub_ps(_mm256_mul_ps(a21, a02), _mm256_mul_ps(a22, a01));
+        __m256 r11 = _mm256_sub_ps(_mm256_mul_ps(a22, a00), _mm256_mul_ps(a20, a02));
+        __m256 r12 = _mm256_sub_ps(_mm256_mul_ps(a20, a01), _mm256_mul_ps(a21, a00));
+        __m256 r20 = _mm256_sub_ps(_mm256_mul_ps(a01, a12), _mm256_mul_ps(a02, a11));
+        __m256 r21 = _mm256_sub_ps(_mm256_mul_ps(a02, a10), _mm256_mul_ps(a00, a12));
+        __m256 r22 = _mm256_sub_ps(_mm256_mul_ps(a00, a11), _mm256_mul_ps(a01, a10));
+
+        __m256 determinant = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a00, r00), _mm256_mul_ps(a01, r01)), _mm256_mul_ps(a02, r02));
+        __m256 singular = _mm256_cmp_ps(determinant, zero, _CMP_EQ_OQ);
+        __m256 inverse = _mm256_andnot_ps(singular, _mm256_div_ps(one, determinant));
+
+        r00 = _mm256_mul_ps(r00, inverse); r01 = _mm256_mul_ps(r01, inverse); r02 = _mm256_mul_ps(r02, inverse);
+        r10 = _mm256_mul_ps(r10, inverse); r11 = _mm256_mul_ps(r11, inverse); r12 = _mm256_mul_ps(r12, inverse);
+        r20 = _mm256_mul_ps(r20, inverse); r21 = _mm256_mul_ps(r21, inverse); r22 = _mm256_mul_ps(r22, inverse);
+
+        __m256 w0 = zero, w1 = zero, w2 = zero;
+        TRANSFORM_BATCH_TRANSPOSE(r00, r01, r02, w0);
+        TRANSFORM_BATCH_TRANSPOSE(r10, r11, r12, w1);
+        TRANSFORM_BATCH_TRANSPOSE(r20, r21, r22, w2);
+        __m256 columns[3][4] = { { r00, r01, r02, w0 }, { r10, r11, r12, w1 }, { r20, r21, r22, w2 } };
+        for (int c = 0; c < 3; ++c)
+        {
+            for (int k = 0; k < 4; ++k)
+            {
+                _mm_storeu_ps(&out[i + k].columns[c][0], _mm256_castps256_ps128(columns[c][k]));
+                _mm_storeu_ps(&out[i + 4 + k].columns[c][0], _mm256_extractf128_ps(columns[c][k], 1));
+            }
+        }
+    }
+    ComputeNormalMatricesScalar(world + i, out + i, count - i);
+}
+
+#undef TRANSFORM_BATCH_TRANSPOSE
+#undef TRANSFORM_BATCH_MADD
+
+#elif defined(SIMD_SSE)
+
+inline void ComposeLocalMatrices(const TransformSoA& trs, size_t first, size_t count, glm::mat4* out)
+{
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 two = _mm_set1_ps(2.0f);
+    const __m128 zero = _mm_setzero_ps();
+
+    size_t n = 0;
+    for (; n + 4 <= count; n += 4)
+    {
+        size_t i = first + n;
+        __m128 x = _mm_loadu_ps(&trs.qx[i]), y = _mm_loadu_ps(&trs.qy[i]);
+        __m128 z = _mm_loadu_ps(&trs.qz[i]), w = _mm_loadu_ps(&trs.qw[i]);
+        __m128 sx = _mm_loadu_ps(&trs.sx[i]), sy = _mm_loadu_ps(&trs.sy[i]), sz = _mm_loadu_ps(&trs.sz[i]);
+
+        __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+        __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+        __m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+        __m128 c0[4] = { _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx),
+            _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx), _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx), zero };
+        __m128 c1[4] = { _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy),
+            _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy), _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy), zero };
+        __m128 c2[4] = { _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz),
+            _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz), _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz), zero };
+        __m128 c3[4] = { _mm_loadu_ps(&trs.px[i]), _mm_loadu_ps(&trs.py[i]), _mm_loadu_ps(&trs.pz[i]), one };
+
+        __m128* columns[4] = { c0, c1, c2, c3 };
+        for (int c = 0; c < 4; ++c)
+        {
+            __m128* r = columns[c];
+            _MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+            for (int k = 0; k < 4; ++k)
+                _mm_storeu_ps(&out[n + k][c][0], r[k]);
+        }
+    }
+    ComposeLocalMatricesScalar(trs, first + n, count - n, out + n);
+}
+
+inline void MultiplyColumns(const __m128 a[4], const float* b, float* out)
+{
+    for (int column = 0; column < 4; ++column)
+    {
+        __m128 bc = _mm_loadu_ps(b + column * 4);
+        __m128 result = _mm_mul_ps(a[0], _mm_shuffle_ps(bc, bc, 0x00));
+        result = _mm_add_ps(result, _mm_mul_ps(a[1], _mm_shuffle_ps(bc, bc, 0x55)));
+        result = _mm_add_ps(result, _mm_mul_ps(a[2], _mm_shuffle_ps(bc, bc, 0xAA)));
+        result = _mm_add_ps(result, _mm_mul_ps(a[3], _mm_shuffle_ps(bc, bc, 0xFF)));
+        _mm_storeu_ps(out + column * 4, result);
+    }
+}
+
+inline void MultiplyMatrices(const glm::mat4* a, const glm::mat4* b, glm::mat4* out, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        const float* am = &a[i][0][0];
+        __m128 columns[4] = { _mm_loadu_ps(am), _mm_loadu_ps(am + 4), _mm_loadu_ps(am + 8), _mm_loadu_ps(am + 12) };
+        MultiplyColumns(columns, &b[i][0][0], &out[i][0][0]);
+    }
+}
+
+inline void PremultiplyMatrices(const glm::mat4& m, const glm::mat4* b, glm::mat4* out, size_t count)
+{
+    const float* mm = &m[0][0];
+    __m128 columns[4] = { _mm_loadu_ps(mm), _mm_loadu_ps(mm + 4), _mm_loadu_ps(mm + 8), _mm_loadu_ps(mm + 12) };
+    for (size_t i = 0; i < count; ++i)
+        MultiplyColumns(columns, &b[i][0][0], &out[i][0][0]);
+}
+
+inline void ComputeNormalMatrices(const glm::mat4* world, NormalMatrix* out, size_t count)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        // a[X][Y] is row Y of column X for 4 matrices
+        __m128 a[3][4];
+        for (int c = 0; c < 3; ++c)
+        {
+            for (int k = 0; k < 4; ++k)
+                a[c][k] = _mm_loadu_ps(&world[i + k][c][0]);
+            _MM_TRANSPOSE4_PS(a[c][0], a[c][1], a[c][2], a[c][3]);
+        }
+
+        __m128 r[3][4];
+        r[0][0] = _mm_sub_ps(_mm_mul_ps(a[1][1], a[2][2]), _mm_mul_ps(a[1][2], a[2][1]));
+        r[0][1] = _mm_sub_ps(_mm_mul_ps(a[1][2], a[2][0]), _mm_mul_ps(a[1][0], a[2][2]));
+        r[0][2] = _mm_sub_ps(_mm_mul_ps(a[1][0], a[2][1]), _mm_mul_ps(a[1][1], a[2][0]));
+        r[1][0] = _mm_sub_ps(_mm_mul_ps(a[2][1], a[0][2]), _mm_mul_ps(a[2][2], a[0][1]));
+        r[1][1] = _mm_sub_ps(_mm_mul_ps(a[2][2], a[0][0]), _mm_mul_ps(a[2][0], a[0][2]));
+        r[1][2] = _mm_sub_ps(_mm_mul_ps(a[2][0], a[0][1]), _mm_mul_ps(a[2][1], a[0][0]));
+        r[2][0] = _mm_sub_ps(_mm_mul_ps(a[0][1], a[1][2]), _mm_mul_ps(a[0][2], a[1][1]));
+        r[2][1] = _mm_sub_ps(_mm_mul_ps(a[0][2], a[1][0]), _mm_mul_ps(a[0][0], a[1][2]));
+        r[2][2] = _mm_sub_ps(_mm_mul_ps(a[0][0], a[1][1]), _mm_mul_ps(a[0][1], a[1][0]));
+
+        __m128 determinant = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a[0][0], r[0][0]), _mm_mul_ps(a[0][1], r[0][1])), _mm_mul_ps(a[0][2], r[0][2]));
+        __m128 singular = _mm_cmpeq_ps(determinant, zero);
+        __m128 inverse = _mm_andnot_ps(singular, _mm_div_ps(one, determinant));
+
+        for (int c = 0; c < 3; ++c)
+        {
+            for (int k = 0; k < 3; ++k)
+                r[c][k] = _mm_mul_ps(r[c][k], inverse);
+            r[c][3] = zero;
+            _MM_TRANSPOSE4_PS(r[c][0], r[c][1], r[c][2], r[c][3]);
+            for (int k = 0; k < 4; ++k)
+                _mm_storeu_ps(&out[i + k].columns[c][0], r[c][k]);
+        }
+    }
+    ComputeNormalMatricesScalar(world + i, out + i, count - i);
+}
+
+#else
+
+inline void ComposeLocalMatrices(const TransformSoA& trs, size_t first, size_t count, glm::mat4* out)
+{
+    ComposeLocalMatricesScalar(trs, first, count, out);
+}
+
+inline void MultiplyMatrices(const glm::mat4* a, const glm::mat4* b, glm::mat4* out, size_t count)
+{
+    MultiplyMatricesScalar(a, b, out, count);
+}
+
+inline void PremultiplyMatrices(const glm::mat4& m, const glm::mat4* b, glm::mat4* out, size_t count)
+{
+    PremultiplyMatricesScalar(m, b, out, count);
+}
+
+inline void ComputeNormalMatrices(const glm::mat4* world, NormalMatrix* out, size_t count)
+{
+    ComputeNormalMatricesScalar(world, out, count);
+}
+
+#endif
+#endif
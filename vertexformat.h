@@ -0,0 +1,267 @@
+#pragma once
+/* Vertex formats a MeshBuffer can store.
+
+VERTEX_FORMAT_FLOAT  32 bytes: float position, float normal, float uv
+VERTEX_FORMAT_PACKED 16 bytes: unorm16 position relative to the mesh's bounding
+                     box, octahedral snorm16 normal, half float uv
+
+The packed format is chosen per mesh when its measured round-trip error stays
+within a tolerance; the vertex shader applies the box offset/scale and decodes
+the octahedral normal.
+*/
+
+#ifndef VERTEXFORMAT_H
+#define VERTEXFORMAT_H
+
+#include <GL/glew.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+
+enum VertexFormat
+{
+    VERTEX_FORMAT_FLOAT,
+    VERTEX_FORMAT_PACKED,
+    VERTEX_FORMAT_COUNT
+};
+
+struct PackedVertex
+{
+    uint16_t position[4];   // unorm16 within the mesh bounds, w unused
+    int16_t normal[2];      // octahedral, snorm16
+    uint16_t uv[2];         // half float
+};
+
+inline GLuint VertexStride(VertexFormat format)
+{
+    return format == VERTEX_FORMAT_PACKED ? sizeof(PackedVertex) : sizeof(float) * 8;
+}
+
+
+// IEEE 754 binary16 conversion, round to nearest even
+inline uint16_t FloatToHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000u;
+    int32_t exponent = (int32_t)((bits >> 23) & 0xff) - 127 + 15;
+    uint32_t mantissa = bits & 0x7fffffu;
+
+    if (((bits >> 23) & 0xff) == 0xff)
+        return (uint16_t)(sign | 0x7c00u | (mantissa ? 0x200u : 0u)); // inf / nan
+    if (exponent >= 31)
+        return (uint16_t)(sign | 0x7c00u); // overflow to inf
+    if (exponent <= 0)
+    {
+        if (exponent < -10)
+            return (uint16_t)sign; // underflow to zero
+        // denormal
+        mantissa |= 0x800000u;
+        uint32_t shift = (uint32_t)(14 - exponent);
+        uint32_t half = mantissa >> shift;
+        uint32_t rest = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half & 1)))
+            ++half;
+        return (uint16_t)(sign | half);
+    }
+
+    uint32_t half = sign | ((uint32_t)exponent << 10) | (mantissa >> 13);
+    uint32_t rest = mantissa & 0x1fffu;
+    if (rest > 0x1000u || (rest == 0x1000u && (half & 1)))
+        ++half; // may carry into the exponent, which is still correct
+    return (uint16_t)half;
+}
+
+inline float HalfToFloat(uint16_t half)
+{
+    uint32_t sign = (uint32_t)(half & 0x8000u) << 16;
+    uint32_t exponent = (half >> 10) & 0x1f;
+    uint32_t mantissa = half & 0x3ffu;
+    uint32_t bits;
+
+    if (exponent == 0)
+    {
+        if (mantissa == 0)
+            bits = sign;
+        else
+        {
+            // renormalize the denormal
+            exponent = 127 - 15 + 1;
+            while ((mantissa & 0x400u) == 0)
+            {
+                mantissa <<= 1;
+                --exponent;
+            }
+            bits = sign | (exponent << 23) | ((mantissa & 0x3ffu) << 13);
+        }
+    }
+    else if (exponent == 31)
+        bits = sign | 0x7f800000u | (mantissa << 13);
+    else
+        bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+
+// Octahedral normal encoding (Cigolle et al. 2014) into two snorm16 values
+inline void OctEncode(const float* normal, int16_t* encoded)
+{
+    float length = fabsf(normal[0]) + fabsf(normal[1]) + fabsf(normal[2]);
+    float x = length > 0.0f ? normal[0] / length : 0.0f;
+    float y = length > 0.0f ? normal[1] / length : 0.0f;
+    if (length > 0.0f && normal[2] < 0.0f)
+    {
+        float foldedX = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        float foldedY = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = foldedX;
+        y = foldedY;
+    }
+    encoded[0] = (int16_t)lroundf(std::min(std::max(x, -1.0f), 1.0f) * 32767.0f);
+    encoded[1] = (int16_t)lroundf(std::min(std::max(y, -1.0f), 1.0f) * 32767.0f);
+}
+
+// Mirrors OctDecode in the vertex shader, including GL's snorm conversion
+inline void OctDecode(const int16_t* encoded, float* normal)
+{
+    float x = std::max(encoded[0] / 32767.0f, -1.0f);
+    float y = std::max(encoded[1] / 32767.0f, -1.0f);
+    float z = 1.0f - fabsf(x) - fabsf(y);
+    float t = std::max(-z, 0.0f);
+    x += x >= 0.0f ? -t : t;
+    y += y >= 0.0f ? -t : t;
+    float length = sqrtf(x * x + y * y + z * z);
+    normal[0] = length > 0.0f ? x / length : 0.0f;
+    normal[1] = length > 0.0f ? y / length : 0.0f;
+    normal[2] = length > 0.0f ? z / length : 1.0f;
+}
+
+
+// Largest round-trip errors of packing a float mesh
+struct QuantizationError
+{
+    float position = 0.0f;  // object units
+    float normal = 0.0f;    // degrees
+    float uv = 0.0f;        // uv units
+};
+
+// Axis aligned bounds of the position attribute (floats 0..2 of every vertex)
+inline void ComputePositionBounds(const float* vertices, uint32_t vertexCount, uint32_t floatsPerVertex, float* minimum, float* maximum)
+{
+    for (int k = 0; k < 3; ++k)
+    {
+        minimum[k] = vertexCount ? vertices[k] : 0.0f;
+        maximum[k] = vertexCount ? vertices[k] : 0.0f;
+    }
+    for (uint32_t v = 1; v < vertexCount; ++v)
+    {
+        const float* p = vertices + (size_t)v * floatsPerVertex;
+        for (int k = 0; k < 3; ++k)
+        {
+            minimum[k] = std::min(minimum[k], p[k]);
+            maximum[k] = std::max(maximum[k], p[k]);
+        }
+    }
+}
+
+// Packs one float vertex (position, normal, uv) given the mesh bounds
+inline PackedVertex PackVertex(const float* vertex, const float* offset, const float* scale)
+{
+    PackedVertex packed;
+    for (int k = 0; k < 3; ++k)
+    {
+        float t = scale[k] > 0.0f ? (vertex[k] - offset[k]) / scale[k] : 0.0f;
+        packed.position[k] = (uint16_t)lroundf(std::min(std::max(t, 0.0f), 1.0f) * 65535.0f);
+    }
+    packed.position[3] = 0;
+    OctEncode(vertex + 3, packed.normal);
+    packed.uv[0] = FloatToHalf(vertex[6]);
+    packed.uv[1] = FloatToHalf(vertex[7]);
+    return packed;
+}
+
+// Measures what packing would cost for an interleaved position/normal/uv mesh
+inline QuantizationError MeasurePackedError(const float* vertices, uint32_t vertexCount, const float* offset, const float* scale)
+{
+    QuantizationError error;
+    for (uint32_t v = 0; v < vertexCount; ++v)
+    {
+        const float* vertex = vertices + (size_t)v * 8;
+        PackedVertex packed = PackVertex(vertex, offset, scale);
+
+        for (int k = 0; k < 3; ++k)
+        {
+            float decoded = offset[k] + packed.position[k] / 65535.0f * scale[k];
+            error.position = std::max(error.position, fabsf(decoded - vertex[k]));
+        }
+
+        float length = sqrtf(vertex[3] * vertex[3] + vertex[4] * vertex[4] + vertex[5] * vertex[5]);
+        if (length > 0.0f)
+        {
+            float decoded[3];
+            OctDecode(packed.normal, decoded);
+            float cosine = (decoded[0] * vertex[3] + decoded[1] * vertex[4] + decoded[2] * vertex[5]) / length;
+            float degrees = acosf(std::min(std::max(cosine, -1.0f), 1.0f)) * 57.2957795f;
+            error.normal = std::max(error.normal, degrees);
+        }
+
+        error.uv = std::max(error.uv, fabsf(HalfToFloat(packed.uv[0]) - vertex[6]));
+        error.uv = std::max(error.uv, fabsf(HalfToFloat(packed.uv[1]) - vertex[7]));
+    }
+    return error;
+}
+
+
+// Largest errors a mesh may pick up from packing
+struct VertexTolerance
+{
+    float position = 0.001f;        // object units
+    float normal = 0.5f;            // degrees
+    float uv = 1.0f / 4096.0f;      // a quarter texel of a 1024 texture
+};
+
+// Picks the packed format when packing this float mesh stays within the tolerance
+inline VertexFormat ChooseVertexFormat(const float* vertices, uint32_t vertexCount, const VertexTolerance& tolerance, QuantizationError* measured = nullptr)
+{
+    float minimum[3], maximum[3], scale[3];
+    ComputePositionBounds(vertices, vertexCount, 8, minimum, maximum);
+    for (int k = 0; k < 3; ++k)
+        scale[k] = maximum[k] - minimum[k];
+
+    QuantizationError error = MeasurePackedError(vertices, vertexCount, minimum, scale);
+    if (measured)
+        *measured = error;
+
+    bool fits = error.position <= tolerance.position && error.normal <= tolerance.normal && error.uv <= tolerance.uv;
+    return fits ? VERTEX_FORMAT_PACKED : VERTEX_FORMAT_FLOAT;
+}
+
+
+// Describes the attributes of a format on the currently bound VAO and GL_ARRAY_BUFFER
+inline void SetupVertexAttributes(VertexFormat format)
+{
+    GLint stride = VertexStride(format);
+    if (format == VERTEX_FORMAT_PACKED)
+    {
+        glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)offsetof(PackedVertex, position));
+        glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride, (void*)offsetof(PackedVertex, normal));
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(PackedVertex, uv));
+    }
+    else
+    {
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, 0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * 3));
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * 6));
+    }
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+}
+#endif